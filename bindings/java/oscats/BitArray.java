@@ -72,6 +72,22 @@ public final class BitArray extends Object
         return GBitArray.reset(this, val);
     }
 
+    public BitArray bitAnd(BitArray rhs) {
+        return GBitArray.bitAnd(this, rhs);
+    }
+
+    public BitArray bitOr(BitArray rhs) {
+        return GBitArray.bitOr(this, rhs);
+    }
+
+    public BitArray bitAndnot(BitArray rhs) {
+        return GBitArray.bitAndnot(this, rhs);
+    }
+
+    public BitArray bitXor(BitArray rhs) {
+        return GBitArray.bitXor(this, rhs);
+    }
+
     public void iterReset() {
         GBitArray.iterReset(this);
     }
@@ -0,0 +1,126 @@
+/* OSCATS: Open-Source Computerized Adaptive Testing System
+ * Copyright 2011 Michael Culbertson <culbert1@illinois.edu>
+ *
+ * Example 5
+ *
+ * 400 Items: 1PL, b ~ N(0,1)
+ * 5000 Examinees: theta ~ N(0,1)
+ * Item selection:
+ *  - pick randomly
+ *  - match theta with b, exactly
+ * Test length: 30
+ * Report:
+ *  - Time to administer each test when the built-in algorithms are
+ *    called directly, and when they are connected to the test's signals
+ *    (OscatsTest:native-handlers set to FALSE), so that every stage goes
+ *    through GSignal emission as it did before native handlers.
+ */
+
+#include <stdio.h>
+#include <glib.h>
+#include <oscats.h>
+
+#define N_EXAMINEES 5000
+#define N_ITEMS 400
+#define LEN 30
+
+OscatsItemBank * gen_items(OscatsSpace *space)
+{
+  OscatsModel *model;
+  OscatsItem *item;
+  OscatsItemBank *bank = g_object_new(OSCATS_TYPE_ITEM_BANK,
+                                      "sizeHint", N_ITEMS, NULL);
+  guint i;
+  for (i=0; i < N_ITEMS; i++)
+  {
+    model = g_object_new(OSCATS_TYPE_MODEL_L1P, "space", space, NULL);
+    oscats_model_set_param_by_index(model, 0, oscats_rnd_normal(1));
+    item = oscats_item_new(OSCATS_DEFAULT_KEY, model);
+    oscats_item_bank_add_item(bank, OSCATS_ADMINISTRAND(item));
+    g_object_unref(item);
+  }
+  return bank;
+}
+
+OscatsExaminee ** gen_examinees(OscatsSpace *space)
+{
+  OscatsExaminee ** ret = g_new(OscatsExaminee*, N_EXAMINEES);
+  OscatsPoint *theta;
+  OscatsDim dim = OSCATS_DIM_CONT + 0;
+  guint i;
+
+  for (i=0; i < N_EXAMINEES; i++)
+  {
+    theta = oscats_point_new_from_space(space);
+    oscats_point_set_cont(theta, dim, oscats_rnd_normal(1));
+    ret[i] = g_object_new(OSCATS_TYPE_EXAMINEE, NULL);
+    oscats_examinee_set_sim_theta(ret[i], theta);
+    oscats_examinee_set_est_theta(ret[i], oscats_point_new_from_space(space));
+  }
+
+  return ret;
+}
+
+static gdouble run(OscatsTest *test, OscatsExaminee **examinees)
+{
+  OscatsDim dim = OSCATS_DIM_CONT + 0;
+  GTimer *timer = g_timer_new();
+  gdouble elapsed;
+  guint i;
+  for (i=0; i < N_EXAMINEES; i++)
+  {
+    oscats_point_set_cont(oscats_examinee_get_est_theta(examinees[i]),
+                          dim, 0);
+    oscats_test_administer(test, examinees[i]);
+  }
+  elapsed = g_timer_elapsed(timer, NULL);
+  g_timer_destroy(timer);
+  return elapsed;
+}
+
+int main()
+{
+  OscatsSpace *space;
+  OscatsExaminee **examinees;
+  OscatsItemBank *bank;
+  const guint num_tests = 2;
+  const gchar *test_names[] = { "random", "matched" };
+  OscatsTest *test;
+  gdouble t_native = 0, t_signal = 0;
+  guint i, j, k;
+
+  g_type_init();
+  space = g_object_new(OSCATS_TYPE_SPACE, "numCont", 1, NULL);
+  examinees = gen_examinees(space);
+  bank = gen_items(space);
+
+  printf("Test\tnative\tsignals\n");
+  for (j=0; j < num_tests; j++)
+  {
+    for (k=0; k < 2; k++)
+    {
+      test = g_object_new(OSCATS_TYPE_TEST, "id", test_names[j],
+                          "itembank", bank, "length_hint", LEN,
+                          "native-handlers", k == 0, NULL);
+      oscats_algorithm_register(g_object_new(OSCATS_TYPE_ALG_SIMULATE, NULL), test);
+      oscats_algorithm_register(g_object_new(OSCATS_TYPE_ALG_FIXED_LENGTH,
+                                             "len", LEN, NULL), test);
+      if (j == 0)
+        oscats_algorithm_register(g_object_new(OSCATS_TYPE_ALG_PICK_RAND, NULL), test);
+      else
+        oscats_algorithm_register(g_object_new(OSCATS_TYPE_ALG_CLOSEST_DIFF, NULL), test);
+      if (k == 0) t_native = run(test, examinees);
+      else t_signal = run(test, examinees);
+      g_object_unref(test);
+    }
+    printf("%s\t%g\t%g\n", test_names[j], t_native, t_signal);
+  }
+
+  g_object_unref(bank);
+  for (i=0; i < N_EXAMINEES; i++)
+    g_object_unref(examinees[i]);
+  g_free(examinees);
+  g_object_unref(space);
+
+  return 0;
+}
@@ -30,12 +30,61 @@ static void null_register (OscatsAlgorithm *alg_data, OscatsTest *test)
 {
   g_critical("Abstract CAT Algorithm should be overloaded.");
 }
+
+// Default: construct a new instance with the same property values
+static OscatsAlgorithm * copy_properties (OscatsAlgorithm *alg_data)
+{
+  OscatsAlgorithm *clone;
+  GParamSpec **pspecs;
+  const gchar **names;
+  GValue *values;
+  guint i, num, n = 0;
+
+  pspecs = g_object_class_list_properties(G_OBJECT_GET_CLASS(alg_data), &num);
+  names = g_new(const gchar*, num);
+  values = g_new0(GValue, num);
+  for (i=0; i < num; i++)
+    if ((pspecs[i]->flags & G_PARAM_READWRITE) == G_PARAM_READWRITE)
+    {
+      names[n] = pspecs[i]->name;
+      g_value_init(values+n, G_PARAM_SPEC_VALUE_TYPE(pspecs[i]));
+      g_object_get_property(G_OBJECT(alg_data), pspecs[i]->name, values+n);
+      n++;
+    }
+#if GLIB_CHECK_VERSION(2,54,0)
+  clone = OSCATS_ALGORITHM(g_object_new_with_properties(
+            G_OBJECT_TYPE(alg_data), n, names, values));
+#else
+  {
+    GParameter *params = g_new(GParameter, n);
+    for (i=0; i < n; i++)
+    {
+      params[i].name = names[i];
+      params[i].value = values[i];
+    }
+    clone = g_object_newv(G_OBJECT_TYPE(alg_data), n, params);
+    g_free(params);
+  }
+#endif
+  for (i=0; i < n; i++)
+    g_value_unset(values+i);
+  g_free(values);
+  g_free(names);
+  g_free(pspecs);
+  return clone;
+}
+
+static void null_merge (OscatsAlgorithm *alg_data, OscatsAlgorithm *other)
+{
+}
                    
 static void oscats_algorithm_class_init (OscatsAlgorithmClass *klass)
 {
 //  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
 
   klass->reg = null_register;
+  klass->clone = copy_properties;
+  klass->merge = null_merge;
 }
 
 static void oscats_algorithm_init (OscatsAlgorithm *self)
@@ -60,16 +109,99 @@ OscatsAlgorithm * oscats_algorithm_register(OscatsAlgorithm *alg_data, OscatsTes
   g_return_val_if_fail(OSCATS_IS_ALGORITHM(alg_data) && OSCATS_IS_TEST(test), NULL);
   g_object_ref_sink(alg_data);
   klass->reg(alg_data, test);
+  g_ptr_array_add(test->algorithms, g_object_ref(alg_data));
   return alg_data;
 }
 
+/**
+ * oscats_algorithm_clone:
+ * @alg_data: the #OscatsAlgorithm descendant to copy
+ *
+ * Creates a new, unregistered algorithm object of the same type as
+ * @alg_data with the same settings, but with its own working space.  This
+ * is used by oscats_test_administer_batch() to give each worker thread an
+ * independent copy of the test's algorithms.  By default, the clone is
+ * constructed with the values of all readable and writable properties of
+ * @alg_data, and nothing else is copied.  Subclasses that hold state set
+ * through other API calls (such as the items taken out of the strata with
+ * oscats_alg_astrat_remove_item()) must override
+ * #OscatsAlgorithmClass.clone, chaining up to build the clone and then
+ * copying that state.  Tabulated statistics are not copied; they are
+ * gathered by oscats_algorithm_merge().
+ *
+ * Returns: (transfer full): a new floating #OscatsAlgorithm
+ */
+OscatsAlgorithm * oscats_algorithm_clone(OscatsAlgorithm *alg_data)
+{
+  g_return_val_if_fail(OSCATS_IS_ALGORITHM(alg_data), NULL);
+  return OSCATS_ALGORITHM_GET_CLASS(alg_data)->clone(alg_data);
+}
+
+/**
+ * oscats_algorithm_merge:
+ * @alg_data: the #OscatsAlgorithm to update
+ * @other: a clone of @alg_data [see oscats_algorithm_clone()]
+ *
+ * Adds any statistics tabulated by @other into @alg_data.  Algorithms that
+ * do not tabulate statistics ignore this call.  @other is not modified.
+ */
+void oscats_algorithm_merge(OscatsAlgorithm *alg_data, OscatsAlgorithm *other)
+{
+  g_return_if_fail(OSCATS_IS_ALGORITHM(alg_data));
+  g_return_if_fail(G_TYPE_CHECK_INSTANCE_TYPE(other, G_OBJECT_TYPE(alg_data)));
+  OSCATS_ALGORITHM_GET_CLASS(alg_data)->merge(alg_data, other);
+}
+
 /**
  * oscats_algorithm_closure_finalize:
  * @alg_data: data to free
  * @closure: signal handler
  *
  * Calls g_object_unref(alg_data).  Should not be invoked directly, but
- * is supplied as the destroy_notifier at signal connection.
+ * is supplied as the destroy_notifier at signal connection or to
+ * oscats_test_connect_native().
  */
 void oscats_algorithm_closure_finalize(gpointer alg_data, GClosure *closure)
 { g_object_unref(alg_data); }
+
+// Set once the default examinee id warning has been logged
+static gint default_id_warned = 0;
+
+/**
+ * oscats_algorithm_examinee_rng:
+ * @alg_data: an #OscatsAlgorithm
+ * @rng: the generator supplied to @alg_data
+ * @stream: (allow-none): @alg_data's working generator, or %NULL
+ * @e: the #OscatsExaminee starting the test
+ *
+ * For algorithms that take an #OscatsRng: restarts @stream (creating it,
+ * if %NULL) as the substream of @rng belonging to @alg_data's type and
+ * the id of examinee @e.  Drawing from @stream during the test then gives
+ * the same results for @e whatever the order in which examinees are
+ * tested and however many threads are used.  Should be called from a
+ * #OscatsTest::initialize handler.
+ *
+ * Since the default #OscatsExaminee:id is based on the examinee's address,
+ * examinees must be given explicit ids for results to be reproducible
+ * between runs.  A warning is logged the first time an examinee with the
+ * default id is seen.
+ *
+ * Returns: @stream
+ */
+OscatsRng * oscats_algorithm_examinee_rng (OscatsAlgorithm *alg_data,
+                                           const OscatsRng *rng,
+                                           OscatsRng *stream,
+                                           const OscatsExaminee *e)
+{
+  g_return_val_if_fail(OSCATS_IS_ALGORITHM(alg_data) && OSCATS_IS_RNG(rng),
+                       stream);
+  g_return_val_if_fail(OSCATS_IS_EXAMINEE(e), stream);
+  if (g_str_has_prefix(e->id, "[Examinee ") &&
+      g_atomic_int_compare_and_exchange(&default_id_warned, 0, 1))
+    g_warning("Examinee %s has the default id, so its random substream is not reproducible between runs.", e->id);
+  if (!stream) stream = oscats_rng_new(0);
+  oscats_rng_set_substream(stream, rng,
+                 oscats_rng_hash_string(G_OBJECT_TYPE_NAME(alg_data)));
+  oscats_rng_set_substream(stream, stream, oscats_rng_hash_string(e->id));
+  return stream;
+}
@@ -20,6 +20,7 @@
 #define _LIBOSCATS_ALGORITHM_H_
 #include <glib.h>
 #include <test.h>
+#include <random.h>
 G_BEGIN_DECLS
 
 #define OSCATS_TYPE_ALGORITHM		(oscats_algorithm_get_type())
@@ -39,14 +40,22 @@ struct _OscatsAlgorithm {
 struct _OscatsAlgorithmClass {
   GInitiallyUnownedClass parent_class;
   void (*reg) (OscatsAlgorithm *alg_data, OscatsTest *test);
+  OscatsAlgorithm * (*clone) (OscatsAlgorithm *alg_data);
+  void (*merge) (OscatsAlgorithm *alg_data, OscatsAlgorithm *other);
 };
 
 GType oscats_algorithm_get_type();
 
 OscatsAlgorithm * oscats_algorithm_register(OscatsAlgorithm *alg_data, OscatsTest *test);
+OscatsAlgorithm * oscats_algorithm_clone(OscatsAlgorithm *alg_data);
+void oscats_algorithm_merge(OscatsAlgorithm *alg_data, OscatsAlgorithm *other);
 
 // Protected
 void oscats_algorithm_closure_finalize (gpointer alg_data, GClosure *closure);
+OscatsRng * oscats_algorithm_examinee_rng (OscatsAlgorithm *alg_data,
+                                           const OscatsRng *rng,
+                                           OscatsRng *stream,
+                                           const OscatsExaminee *e);
 
 
 /* Programming checks with error reporting */
@@ -5,6 +5,7 @@
 #include  <algorithms/closest_diff.h>
 #include  <algorithms/max_fisher.h>
 #include  <algorithms/max_kl.h>
+#include  <algorithms/max_pw_fisher.h>
 
 // Administration
 #include  <algorithms/simulate.h>
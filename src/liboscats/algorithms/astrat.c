@@ -87,6 +87,7 @@ static void oscats_alg_astrat_set_property(GObject *object,
 static void oscats_alg_astrat_get_property(GObject *object,
               guint prop_id, GValue *value, GParamSpec *pspec);
 static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test);
+static OscatsAlgorithm * alg_clone (OscatsAlgorithm *alg_data);
 
 static void oscats_alg_astrat_class_init (OscatsAlgAstratClass *klass)
 {
@@ -103,6 +104,7 @@ static void oscats_alg_astrat_class_init (OscatsAlgAstratClass *klass)
   gobject_class->get_property = oscats_alg_astrat_get_property;
 
   OSCATS_ALGORITHM_CLASS(klass)->reg = alg_register;
+  OSCATS_ALGORITHM_CLASS(klass)->clone = alg_clone;
 
 /**
  * OscatsAlgAstrat:equal:
@@ -251,7 +253,13 @@ static void oscats_alg_astrat_dispose (GObject *object)
   OscatsAlgAstrat *self = OSCATS_ALG_ASTRAT(object);
   G_OBJECT_CLASS(oscats_alg_astrat_parent_class)->dispose(object);
   if (self->stratify) g_object_unref(self->stratify);
+  if (self->excluded) g_object_unref(self->excluded);
+  if (self->test)
+    g_object_remove_weak_pointer(G_OBJECT(self->test),
+                                 (gpointer*)&self->test);
   self->stratify = NULL;
+  self->excluded = NULL;
+  self->test = NULL;
 }
 
 static void oscats_alg_astrat_finalize (GObject *object)
@@ -464,12 +472,42 @@ static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test)
   self->stratify = g_object_new(OSCATS_TYPE_ALG_STRATIFY,
                                 "itembank", test->itembank, NULL);
   oscats_alg_astrat_restratify(self);
+  if (self->excluded)
+  {
+    gint i;
+    g_bit_array_iter_reset(self->excluded);
+    while ((i = g_bit_array_iter_next(self->excluded)) >= 0)
+      oscats_alg_stratify_remove_item(self->stratify, i);
+    g_object_unref(self->excluded);
+    self->excluded = NULL;
+  }
+  self->test = test;
+  g_object_add_weak_pointer(G_OBJECT(test), (gpointer*)&self->test);
 
-  g_signal_connect_data(test, "initialize", G_CALLBACK(initialize),
-                        alg_data, oscats_algorithm_closure_finalize, 0);
+  oscats_test_connect_native(test, "initialize", G_CALLBACK(initialize),
+                             alg_data, oscats_algorithm_closure_finalize);
   g_object_ref(alg_data);
-  g_signal_connect_data(test, "administered", G_CALLBACK(administered),
-                        alg_data, oscats_algorithm_closure_finalize, 0);
+  oscats_test_connect_native(test, "administered", G_CALLBACK(administered),
+                             alg_data, oscats_algorithm_closure_finalize);
+}
+
+// Copy the settings, and remember which items have been taken out of the
+// strata, since registering the clone stratifies the whole bank again
+static OscatsAlgorithm * alg_clone (OscatsAlgorithm *alg_data)
+{
+  OscatsAlgAstrat *self = OSCATS_ALG_ASTRAT(alg_data);
+  OscatsAlgAstrat *clone = OSCATS_ALG_ASTRAT(
+    OSCATS_ALGORITHM_CLASS(oscats_alg_astrat_parent_class)->clone(alg_data));
+  guint i, n;
+  if (self->stratify)
+  {
+    n = oscats_item_bank_num_items(self->stratify->bank);
+    clone->excluded = g_bit_array_new(n);
+    for (i=0; i < n; i++)
+      if (!oscats_alg_stratify_has_item(self->stratify, i))
+        g_bit_array_set_bit(clone->excluded, i);
+  }
+  return OSCATS_ALGORITHM(clone);
 }
                    
 /**
@@ -527,3 +565,51 @@ void oscats_alg_astrat_restratify(OscatsAlgAstrat *alg_data)
     alg_data->rem = alg_data->n_items[0];
   }
 }
+
+// The current stratum has changed in place, so pass it on to the test again
+static void update_hint(OscatsAlgAstrat *alg_data)
+{
+  if (alg_data->test && !alg_data->flag)
+    oscats_test_set_hint(alg_data->test,
+      oscats_alg_stratify_get_stratum(alg_data->stratify, alg_data->cur));
+}
+
+/**
+ * oscats_alg_astrat_remove_item:
+ * @alg_data: the #OscatsAlgAstrat algorithm data
+ * @item: the index of the item in the test's item bank
+ *
+ * Takes @item out of the strata, for example to retire an item that has
+ * become overexposed, without restratifying the whole bank [see
+ * oscats_alg_stratify_remove_item()].  The strata are rebalanced as if
+ * @item had not been in the bank, which moves at most a few items between
+ * neighboring strata.  This may be called from a handler during a test
+ * (e.g. for #OscatsTest::administered); the examinee stays in the same
+ * stratum, whose new contents take effect for the next item selected.
+ */
+void oscats_alg_astrat_remove_item(OscatsAlgAstrat *alg_data, guint item)
+{
+  g_return_if_fail(OSCATS_IS_ALG_ASTRAT(alg_data));
+  g_return_if_fail(OSCATS_IS_ALG_STRATIFY(alg_data->stratify));
+  oscats_alg_stratify_remove_item(alg_data->stratify, item);
+  update_hint(alg_data);
+}
+
+/**
+ * oscats_alg_astrat_add_item:
+ * @alg_data: the #OscatsAlgAstrat algorithm data
+ * @item: the index of the item in the test's item bank
+ *
+ * Puts @item (back) into the strata according to its current
+ * discrimination and difficulty, as for oscats_alg_astrat_remove_item().
+ * Items that should only become available later (such as pretest items)
+ * may be included in the bank, removed from the strata after the algorithm
+ * is registered, and added when needed.
+ */
+void oscats_alg_astrat_add_item(OscatsAlgAstrat *alg_data, guint item)
+{
+  g_return_if_fail(OSCATS_IS_ALG_ASTRAT(alg_data));
+  g_return_if_fail(OSCATS_IS_ALG_STRATIFY(alg_data->stratify));
+  oscats_alg_stratify_add_item(alg_data->stratify, item);
+  update_hint(alg_data);
+}
@@ -116,6 +116,8 @@ struct _OscatsAlgAstrat {
   // Working space
   guint cur, rem;
   gboolean flag;		// Reached end of last stratum
+  OscatsTest *test;		// Not referenced
+  GBitArray *excluded;		// Items to take out on registration (clones)
 };
 
 struct _OscatsAlgAstratClass {
@@ -133,6 +135,8 @@ void oscats_alg_astrat_register_model(GType model,
                                       OscatsAlgAstratCriterion a,
                                       OscatsAlgAstratCriterion b);
 void oscats_alg_astrat_restratify(OscatsAlgAstrat *alg_data);
+void oscats_alg_astrat_remove_item(OscatsAlgAstrat *alg_data, guint item);
+void oscats_alg_astrat_add_item(OscatsAlgAstrat *alg_data, guint item);
 
 G_END_DECLS
 #endif
@@ -16,6 +16,7 @@
  *  along with OSCATS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
 #include "random.h"
 #include "algorithms/chooser.h"
 
@@ -23,8 +24,12 @@ enum {
   PROP_0,
   PROP_NUM,
   PROP_BANK,
+  PROP_THREADS,
 };
 
+// Eligible items per thread below which the criterion is evaluated serially
+#define MIN_ITEMS_PER_THREAD 64
+
 G_DEFINE_TYPE(OscatsAlgChooser, oscats_alg_chooser, G_TYPE_OBJECT);
 
 static void oscats_alg_chooser_dispose(GObject *object);
@@ -72,10 +77,39 @@ static void oscats_alg_chooser_class_init (OscatsAlgChooserClass *klass)
                               G_PARAM_STATIC_BLURB);
   g_object_class_install_property(gobject_class, PROP_BANK, pspec);
 
+/**
+ * OscatsAlgChooser:threads:
+ *
+ * Number of threads among which the eligible items are divided when
+ * evaluating the criterion.  Each thread keeps its own best items, and
+ * these are merged afterwards, so the selection is the same as with one
+ * thread.  Small sets of eligible items are always evaluated serially.
+ * The helper threads are started when this property is set and kept until
+ * the chooser is finalized.
+ */
+  pspec = g_param_spec_uint("threads", "Threads",
+                            "Number of threads for criterion evaluation",
+                            1, 1024, 1,
+                            G_PARAM_READWRITE |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_THREADS, pspec);
+
 }
 
 static void oscats_alg_chooser_init (OscatsAlgChooser *self)
 {
+  self->threads = 1;
+}
+
+static void clear_workspaces(OscatsAlgChooser *chooser)
+{
+  guint i;
+  if (!chooser->workspaces) return;
+  if (chooser->ws_free)
+    for (i=0; i < chooser->workspaces->len; i++)
+      chooser->ws_free(g_ptr_array_index(chooser->workspaces, i));
+  g_ptr_array_set_size(chooser->workspaces, 0);
 }
 
 static void oscats_alg_chooser_dispose (GObject *object)
@@ -86,14 +120,82 @@ static void oscats_alg_chooser_dispose (GObject *object)
   self->bank = NULL;
 }
 
+static void free_pool(OscatsAlgChooser *chooser)
+{
+  if (chooser->pool) g_thread_pool_free(chooser->pool, FALSE, TRUE);
+  if (chooser->done) g_async_queue_unref(chooser->done);
+  chooser->pool = NULL;
+  chooser->done = NULL;
+}
+
 static void oscats_alg_chooser_finalize (GObject *object)
 {
   OscatsAlgChooser *self = OSCATS_ALG_CHOOSER(object);
+  free_pool(self);
+  if (self->jobs) g_array_free(self->jobs, TRUE);
+  if (self->scan_index) g_array_free(self->scan_index, TRUE);
+  if (self->scan_dists) g_array_free(self->scan_dists, TRUE);
+  if (self->scan_items) g_array_free(self->scan_items, TRUE);
   if (self->dists) g_array_free(self->dists, TRUE);
   if (self->items) g_array_free(self->items, TRUE);
+  if (self->workspaces)
+  {
+    clear_workspaces(self);
+    g_ptr_array_free(self->workspaces, TRUE);
+  }
   G_OBJECT_CLASS(oscats_alg_chooser_parent_class)->finalize(object);
 }
 
+typedef struct {
+  OscatsAlgChooser *chooser;
+  const OscatsExaminee *e;
+  gpointer data;
+  const guint *index;
+  guint num_index, k, n;
+  gdouble *dists;
+  guint *items;
+} ScanJob;
+
+static void scan_worker(gpointer job_data, gpointer user_data);
+
+// Starts (or resizes) the pool of helper threads for chooser->threads
+static void set_threads(OscatsAlgChooser *chooser)
+{
+  GError *error = NULL;
+  if (chooser->threads < 2)
+  {
+    free_pool(chooser);
+    return;
+  }
+  if (chooser->pool)
+  {
+    g_thread_pool_set_max_threads(chooser->pool, chooser->threads-1, NULL);
+    return;
+  }
+
+#if !GLIB_CHECK_VERSION(2,32,0)
+  if (!g_thread_supported()) g_thread_init(NULL);
+#endif
+
+  chooser->done = g_async_queue_new();
+  chooser->pool = g_thread_pool_new(scan_worker, chooser->done,
+                                    chooser->threads-1, FALSE, &error);
+  if (error)
+  {
+    g_warning("Unable to start threads for item selection: %s",
+              error->message);
+    g_error_free(error);
+    free_pool(chooser);
+  }
+  if (!chooser->jobs)
+  {
+    chooser->jobs = g_array_new(FALSE, FALSE, sizeof(ScanJob));
+    chooser->scan_index = g_array_new(FALSE, FALSE, sizeof(guint));
+    chooser->scan_dists = g_array_new(FALSE, FALSE, sizeof(gdouble));
+    chooser->scan_items = g_array_new(FALSE, FALSE, sizeof(guint));
+  }
+}
+
 static void oscats_alg_chooser_set_property(GObject *object,
               guint prop_id, const GValue *value, GParamSpec *pspec)
 {
@@ -102,11 +204,8 @@ static void oscats_alg_chooser_set_property(GObject *object,
   {
     case PROP_NUM:			// construction only
       self->num = g_value_get_uint(value);
-      if (self->num > 1)
-      {
-        self->dists = g_array_sized_new(FALSE, FALSE, sizeof(gdouble), self->num);
-        self->items = g_array_sized_new(FALSE, FALSE, sizeof(guint), self->num);
-      }
+      self->dists = g_array_sized_new(FALSE, FALSE, sizeof(gdouble), self->num);
+      self->items = g_array_sized_new(FALSE, FALSE, sizeof(guint), self->num);
       break;
 
     case PROP_BANK:
@@ -114,6 +213,11 @@ static void oscats_alg_chooser_set_property(GObject *object,
       self->bank = g_value_dup_object(value);
       break;
     
+    case PROP_THREADS:
+      self->threads = g_value_get_uint(value);
+      set_threads(self);
+      break;
+    
     default:
       // Unknown property
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -135,6 +239,10 @@ static void oscats_alg_chooser_get_property(GObject *object,
       g_value_set_object(value, self->bank);
       break;
     
+    case PROP_THREADS:
+      g_value_set_uint(value, self->threads);
+      break;
+    
     default:
       // Unknown property
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -158,7 +266,260 @@ void oscats_alg_chooser_set_c_criterion(OscatsAlgChooser *chooser,
   g_return_if_fail(OSCATS_IS_ALG_CHOOSER(chooser) && f != NULL);
   chooser->criterion = f;
 }
+
+/**
+ * oscats_alg_chooser_set_workspace:
+ * @chooser: an #OscatsAlgChooser object
+ * @ws_new: (allow-none): function creating a workspace from the user data
+ * @ws_free: (allow-none): function freeing a workspace
+ *
+ * Gives each thread evaluating the criterion its own workspace.  If
+ * @ws_new is not %NULL, the criterion receives a workspace created by
+ * @ws_new from the user data passed to oscats_alg_chooser_choose() in
+ * place of the user data itself.  Workspaces are kept between calls and
+ * created afresh whenever the user data changes.  Calling this function
+ * again discards any existing workspaces, for example when the user data
+ * has been reallocated.
+ */
+void oscats_alg_chooser_set_workspace(OscatsAlgChooser *chooser,
+                                      OscatsAlgChooserWorkspaceNew ws_new,
+                                      GDestroyNotify ws_free)
+{
+  g_return_if_fail(OSCATS_IS_ALG_CHOOSER(chooser));
+  clear_workspaces(chooser);
+  chooser->ws_new = ws_new;
+  chooser->ws_free = ws_free;
+  chooser->ws_data = NULL;
+}
+
+// Returns the criterion data for thread t
+static gpointer get_workspace(OscatsAlgChooser *chooser, guint t,
+                              gpointer data)
+{
+  if (!chooser->ws_new) return data;
+  if (!chooser->workspaces) chooser->workspaces = g_ptr_array_new();
+  if (data != chooser->ws_data)
+  {
+    clear_workspaces(chooser);
+    chooser->ws_data = data;
+  }
+  while (chooser->workspaces->len <= t)
+    g_ptr_array_add(chooser->workspaces, chooser->ws_new(data));
+  return g_ptr_array_index(chooser->workspaces, t);
+}
                                       
+/*
+ * The best items found so far are kept in a max-heap of at most k items,
+ * whose root is the worst of them.  Ties are broken by item index, so the
+ * result does not depend on the order in which items are visited.
+ */
+#define WORSE(d1, i1, d2, i2) ((d1) > (d2) || ((d1) == (d2) && (i1) > (i2)))
+
+static void heap_sift_down(gdouble *dists, guint *items, guint n, guint j)
+{
+  gdouble d = dists[j];
+  guint item = items[j], c;
+  while ((c = 2*j+1) < n)
+  {
+    if (c+1 < n && WORSE(dists[c+1], items[c+1], dists[c], items[c])) c++;
+    if (!WORSE(dists[c], items[c], d, item)) break;
+    dists[j] = dists[c];
+    items[j] = items[c];
+    j = c;
+  }
+  dists[j] = d;
+  items[j] = item;
+}
+
+static void heap_push(gdouble *dists, guint *items, guint n,
+                      gdouble d, guint item)
+{
+  guint j = n, p;
+  while (j > 0)
+  {
+    p = (j-1)/2;
+    if (!WORSE(d, item, dists[p], items[p])) break;
+    dists[j] = dists[p];
+    items[j] = items[p];
+    j = p;
+  }
+  dists[j] = d;
+  items[j] = item;
+}
+
+// Offers an item to a heap of capacity k holding n items; returns new n
+static guint heap_offer(gdouble *dists, guint *items, guint n, guint k,
+                        gdouble d, guint item)
+{
+  if (n < k)
+  {
+    heap_push(dists, items, n, d, item);
+    return n+1;
+  }
+  if (WORSE(dists[0], items[0], d, item))
+  {
+    dists[0] = d;
+    items[0] = item;
+    heap_sift_down(dists, items, n, 0);
+  }
+  return n;
+}
+
+// Sorts the heap in place, best item first
+static void heap_sort(gdouble *dists, guint *items, guint n)
+{
+  gdouble d;
+  guint item;
+  while (n > 1)
+  {
+    n--;
+    d = dists[0];  dists[0] = dists[n];  dists[n] = d;
+    item = items[0];  items[0] = items[n];  items[n] = item;
+    heap_sift_down(dists, items, n, 0);
+  }
+}
+
+// Keeps the best job->k of the job's items in the job's own heap, then
+// reports to the queue user_data, if given
+static void scan_worker(gpointer job_data, gpointer user_data)
+{
+  ScanJob *job = (ScanJob*)job_data;
+  OscatsAlgChooserCriterion criterion = job->chooser->criterion;
+  gpointer *items = job->chooser->bank->items->pdata;
+  guint i, n = 0;
+  for (i=0; i < job->num_index; i++)
+    n = heap_offer(job->dists, job->items, n, job->k,
+                   criterion(items[job->index[i]], job->e, job->data),
+                   job->index[i]);
+  job->n = n;
+  if (user_data) g_async_queue_push((GAsyncQueue*)user_data, job);
+}
+
+// Number of threads among which to divide the eligible items
+static guint num_jobs(OscatsAlgChooser *chooser, GBitArray *eligible)
+{
+  guint n = eligible->num_set / MIN_ITEMS_PER_THREAD;
+  if (!chooser->pool) return 1;
+  return (n < chooser->threads ? (n > 0 ? n : 1) : chooser->threads);
+}
+
+/*
+ * Divides the eligible items into contiguous blocks of equal size, one per
+ * thread, and finds the best k of each block.  The calling thread does the
+ * first block itself and waits for the pool to report the others.  Since
+ * ties are broken by index, merging the blocks' heaps gives the same items
+ * as a serial scan.
+ */
+static guint top_k_parallel(OscatsAlgChooser *chooser,
+                            const OscatsExaminee *e, GBitArray *eligible,
+                            gpointer data, guint k, guint num_threads,
+                            gdouble *heap_dists, guint *heap_items)
+{
+  ScanJob *jobs;
+  guint *index, *best;
+  gdouble *dists;
+  guint num_index = 0, start, stop, n = 0, t, j;
+  gint i;
+
+  g_array_set_size(chooser->jobs, num_threads);
+  g_array_set_size(chooser->scan_index, eligible->num_set);
+  g_array_set_size(chooser->scan_dists, k*num_threads);
+  g_array_set_size(chooser->scan_items, k*num_threads);
+  jobs = (ScanJob*)chooser->jobs->data;
+  index = (guint*)chooser->scan_index->data;
+  dists = (gdouble*)chooser->scan_dists->data;
+  best = (guint*)chooser->scan_items->data;
+
+  g_bit_array_iter_reset(eligible);
+  while ((i = g_bit_array_iter_next(eligible)) >= 0)
+    index[num_index++] = i;
+
+  for (t=0; t < num_threads; t++)
+  {
+    start = (guint)((guint64)num_index * t / num_threads);
+    stop = (guint)((guint64)num_index * (t+1) / num_threads);
+    jobs[t].chooser = chooser;
+    jobs[t].e = e;
+    // Workspaces are created here, since the workers must not do so
+    jobs[t].data = get_workspace(chooser, t, data);
+    jobs[t].index = index + start;
+    jobs[t].num_index = stop - start;
+    jobs[t].k = k;
+    jobs[t].n = 0;
+    jobs[t].dists = dists + k*t;
+    jobs[t].items = best + k*t;
+  }
+
+  for (t=1; t < num_threads; t++)
+    g_thread_pool_push(chooser->pool, jobs+t, NULL);
+  scan_worker(jobs, NULL);
+  for (t=1; t < num_threads; t++)
+    g_async_queue_pop(chooser->done);
+
+  for (t=0; t < num_threads; t++)
+    for (j=0; j < jobs[t].n; j++)
+      n = heap_offer(heap_dists, heap_items, n, k,
+                     jobs[t].dists[j], jobs[t].items[j]);
+  return n;
+}
+
+/*
+ * Evaluates the criterion for every eligible item and leaves the best
+ * k of them, best first, in chooser->dists and chooser->items.
+ * Returns the number of items found (less than k if fewer are eligible).
+ */
+static guint top_k(OscatsAlgChooser *chooser, const OscatsExaminee *e,
+                   GBitArray *eligible, gpointer data, guint k)
+{
+  OscatsAlgChooserCriterion criterion = chooser->criterion;
+  gpointer *items = chooser->bank->items->pdata;
+  gdouble *heap_dists;
+  guint *heap_items, n = 0, num_threads = num_jobs(chooser, eligible);
+  gint i;
+
+  g_array_set_size(chooser->dists, k);
+  g_array_set_size(chooser->items, k);
+  heap_dists = (gdouble*)chooser->dists->data;
+  heap_items = (guint*)chooser->items->data;
+  if (num_threads > 1)
+    n = top_k_parallel(chooser, e, eligible, data, k, num_threads,
+                       heap_dists, heap_items);
+  else
+  {
+    data = get_workspace(chooser, 0, data);
+    g_bit_array_iter_reset(eligible);
+    while ((i = g_bit_array_iter_next(eligible)) >= 0)
+      n = heap_offer(heap_dists, heap_items, n, k,
+                     criterion(items[i], e, data), i);
+  }
+  heap_sort(heap_dists, heap_items, n);
+  g_array_set_size(chooser->dists, n);
+  g_array_set_size(chooser->items, n);
+  return n;
+}
+
+// Picks an eligible item uniformly at random
+static gint pick_eligible(OscatsAlgChooser *chooser, GBitArray *eligible)
+{
+  gint i, item_index = -1;
+  i = ( chooser->rng ?
+        oscats_rng_uniform_int_range(chooser->rng, 1, eligible->num_set) :
+        oscats_rnd_uniform_int_range(1, eligible->num_set) );
+  g_bit_array_iter_reset(eligible);
+  for (; i; i--) item_index = g_bit_array_iter_next(eligible);
+  return item_index;
+}
+
+// Picks one of the n best items left by top_k() at random
+static gint pick_best(OscatsAlgChooser *chooser, guint n)
+{
+  gint i;
+  if (chooser->num == 1) return g_array_index(chooser->items, guint, 0);
+  i = ( chooser->rng ? oscats_rng_uniform_int_range(chooser->rng, 0, n-1) :
+                       oscats_rnd_uniform_int_range(0, n-1) );
+  return g_array_index(chooser->items, guint, i);
+}
+
 /**
  * oscats_alg_chooser_choose:
  * @chooser: an #OscatsAlgChooser with criterion set
@@ -166,7 +527,11 @@ void oscats_alg_chooser_set_c_criterion(OscatsAlgChooser *chooser,
  * @eligible: a #GBitArray indicating which items in the bank are eligible
  * @data: optional user data for the criterion function
  *
- * Chooses an item that minimizes the given criterion for examinee @e.
+ * Chooses an item that minimizes the given criterion for examinee @e.  If
+ * #OscatsAlgChooser:num is greater than one, the best items are kept in a
+ * heap, so that choosing among the best k of n items takes O(n log k)
+ * time.  Items with equal criteria are ranked by their index in the bank.
+ * See #OscatsAlgChooser:threads for evaluating the criterion in parallel.
  *
  * Returns: the index of the selected item, or -1 if no item is available
  */
@@ -189,16 +554,17 @@ gint oscats_alg_chooser_choose(OscatsAlgChooser *chooser,
   items = chooser->bank->items;
   num = chooser->num;
 
-  if (num == 1)
+  if (num == 1 && num_jobs(chooser, eligible) == 1)
   {
     gdouble min;
 
+    data = get_workspace(chooser, 0, data);
     g_bit_array_iter_reset(eligible);
     item_index = g_bit_array_iter_next(eligible);
     item = g_ptr_array_index(items, item_index);
     min = (*(chooser->criterion))(item, e, data);
 
-    while((i=g_bit_array_iter_next(eligible)) > 0)
+    while((i=g_bit_array_iter_next(eligible)) >= 0)
     {
       item = g_ptr_array_index(items, i);
       dist = (*(chooser->criterion))(item, e, data);
@@ -213,56 +579,95 @@ gint oscats_alg_chooser_choose(OscatsAlgChooser *chooser,
   }
 
   if (eligible->num_set < num)
-  {
-    i = oscats_rnd_uniform_int_range(1, eligible->num_set);
-    g_bit_array_iter_reset(eligible);
-    for (; i; i--) item_index = g_bit_array_iter_next(eligible);
-    return item_index;
-  }
+    return pick_eligible(chooser, eligible);
+
+  num = top_k(chooser, e, eligible, data, num);
+  return pick_best(chooser, num);
+}
+
+/**
+ * oscats_alg_chooser_choose_values:
+ * @chooser: an #OscatsAlgChooser
+ * @eligible: a #GBitArray indicating which items in the bank are eligible
+ * @values: the criterion for each item, indexed by position in the bank
+ *
+ * Chooses an item as oscats_alg_chooser_choose() does, but from criterion
+ * values already computed for the bank, for algorithms that evaluate the
+ * criterion for all items in one pass (e.g. from a table).  Only the
+ * values of eligible items are read.  The criterion function is not used.
+ *
+ * Returns: the index of the selected item, or -1 if no item is available
+ */
+gint oscats_alg_chooser_choose_values(OscatsAlgChooser *chooser,
+                                      GBitArray *eligible,
+                                      const gdouble *values)
+{
+  gdouble *heap_dists;
+  guint *heap_items, n = 0;
+  gint i, item_index;
+  g_return_val_if_fail(OSCATS_IS_ALG_CHOOSER(chooser) && values != NULL, -1);
+  g_return_val_if_fail(G_IS_BIT_ARRAY(eligible), -1);
+  g_return_val_if_fail(oscats_item_bank_num_items(chooser->bank) ==
+                       eligible->bit_len, -1);
+  g_return_val_if_fail(eligible->num_set > 0, -1);
 
-  // Sort first num items
-  g_array_set_size(chooser->dists, 0);
-  g_array_set_size(chooser->items, 0);
   g_bit_array_iter_reset(eligible);
-  for (i=0; i < num; i++)
+  if (chooser->num == 1)
   {
-    guint j;
-    gboolean inserted = FALSE;
     item_index = g_bit_array_iter_next(eligible);
-    item = g_ptr_array_index(items, item_index);
-    dist = (*(chooser->criterion))(item, e, data);
-    for (j=0; j < i; j++)
-      if (dist < g_array_index(chooser->dists, gdouble, j))
-      {
-        g_array_insert_val(chooser->dists, j, dist);
-        g_array_insert_val(chooser->items, j, item_index);
-        inserted = TRUE;
-        break;
-      }
-    if (!inserted)
-    {
-      g_array_append_val(chooser->dists, dist);
-      g_array_append_val(chooser->items, item_index);
-    }
-  }
-  // Insert any remaining items closer than first num items
-  while ((item_index = g_bit_array_iter_next(eligible)) > 0)
-  {
-    item = g_ptr_array_index(items, item_index);
-    dist = (*(chooser->criterion))(item, e, data);
-    for (i=0; i < num; i++)
-      if (dist < g_array_index(chooser->dists, gdouble, i))
-      {
-        // Remove last element
-        g_array_set_size(chooser->dists, num-1);
-        g_array_set_size(chooser->items, num-1);
-        // Insert new element
-        g_array_insert_val(chooser->dists, i, dist);
-        g_array_insert_val(chooser->items, i, item_index);
-        break;
-      }
+    while ((i = g_bit_array_iter_next(eligible)) >= 0)
+      if (values[i] < values[item_index]) item_index = i;
+    return item_index;
   }
-  // Select a random item
-  i = oscats_rnd_uniform_range(0, num-1);
-  return g_array_index(chooser->items, gint, i);
+
+  if (eligible->num_set < chooser->num)
+    return pick_eligible(chooser, eligible);
+
+  g_array_set_size(chooser->dists, chooser->num);
+  g_array_set_size(chooser->items, chooser->num);
+  heap_dists = (gdouble*)chooser->dists->data;
+  heap_items = (guint*)chooser->items->data;
+  while ((i = g_bit_array_iter_next(eligible)) >= 0)
+    n = heap_offer(heap_dists, heap_items, n, chooser->num, values[i], i);
+  heap_sort(heap_dists, heap_items, n);
+  g_array_set_size(chooser->dists, n);
+  g_array_set_size(chooser->items, n);
+  return pick_best(chooser, n);
+}
+
+/**
+ * oscats_alg_chooser_rank:
+ * @chooser: an #OscatsAlgChooser with criterion set
+ * @e: the #OscatsExaminee for which to rank the items
+ * @eligible: a #GBitArray indicating which items in the bank are eligible
+ * @data: optional user data for the criterion function
+ * @ranked: (element-type guint): return location for the ranked items
+ *
+ * Finds the #OscatsAlgChooser:num eligible items with the smallest
+ * criterion for examinee @e, as for oscats_alg_chooser_choose(), but
+ * returns all of them, best first, instead of picking one at random.  This
+ * is useful for exposure control algorithms that need to look past the
+ * best item.  The indices of the items are stored in @ranked, which must
+ * be a #GArray of #guint and is resized as necessary.
+ *
+ * Returns: the number of items in @ranked (less than
+ * #OscatsAlgChooser:num if fewer items are eligible)
+ */
+guint oscats_alg_chooser_rank(OscatsAlgChooser *chooser,
+                              const OscatsExaminee *e,
+                              GBitArray *eligible,
+                              gpointer data, GArray *ranked)
+{
+  guint n;
+  g_return_val_if_fail(OSCATS_IS_ALG_CHOOSER(chooser) &&
+                       chooser->criterion != NULL, 0);
+  g_return_val_if_fail(OSCATS_IS_EXAMINEE(e) && G_IS_BIT_ARRAY(eligible), 0);
+  g_return_val_if_fail(oscats_item_bank_num_items(chooser->bank) ==
+                       eligible->bit_len, 0);
+  g_return_val_if_fail(ranked != NULL &&
+                       g_array_get_element_size(ranked) == sizeof(guint), 0);
+  n = top_k(chooser, e, eligible, data, chooser->num);
+  g_array_set_size(ranked, n);
+  memcpy(ranked->data, chooser->items->data, n*sizeof(guint));
+  return n;
 }
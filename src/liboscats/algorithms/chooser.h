@@ -21,6 +21,7 @@
 #include <glib-object.h>
 #include <itembank.h>
 #include <examinee.h>
+#include <random.h>
 G_BEGIN_DECLS
 
 #define OSCATS_TYPE_ALG_CHOOSER	(oscats_alg_chooser_get_type())
@@ -36,14 +37,20 @@ typedef struct _OscatsAlgChooserClass OscatsAlgChooserClass;
 typedef gdouble (*OscatsAlgChooserCriterion) (const OscatsItem *item,
                                               const OscatsExaminee *e,
                                               gpointer data);
+typedef gpointer (*OscatsAlgChooserWorkspaceNew) (gpointer data);
 
 /**
  * OscatsAlgChooser
  *
  * Support algorithm (for item selection):
  * Picks an optimal item based on a supplied criterion function.
- * Note: This algorithm won't work correctly if there are
- * multiple items with exactly the optimality metric.
+ * Items with exactly the same criterion are ranked by their index in the
+ * item bank.
+ *
+ * If #OscatsAlgChooser:threads is greater than one, the criterion is
+ * evaluated for large sets of eligible items in parallel, so the criterion
+ * function must not modify shared state.  Per-thread scratch space can be
+ * supplied with oscats_alg_chooser_set_workspace().
  */
 struct _OscatsAlgChooser {
   GObject parent_instance;
@@ -52,6 +59,15 @@ struct _OscatsAlgChooser {
   OscatsAlgChooserCriterion criterion;
   guint num;
   GArray *dists, *items;
+  OscatsRng *rng;     // Not owned; NULL for library-wide generator
+  guint threads;
+  OscatsAlgChooserWorkspaceNew ws_new;
+  GDestroyNotify ws_free;
+  gpointer ws_data;
+  GPtrArray *workspaces;
+  GThreadPool *pool;
+  GAsyncQueue *done;
+  GArray *jobs, *scan_index, *scan_dists, *scan_items;
 };
 
 struct _OscatsAlgChooserClass {
@@ -62,10 +78,20 @@ GType oscats_alg_chooser_get_type();
 
 void oscats_alg_chooser_set_c_criterion(OscatsAlgChooser *chooser,
                                         OscatsAlgChooserCriterion f);
+void oscats_alg_chooser_set_workspace(OscatsAlgChooser *chooser,
+                                      OscatsAlgChooserWorkspaceNew ws_new,
+                                      GDestroyNotify ws_free);
 gint oscats_alg_chooser_choose(OscatsAlgChooser *chooser,
                                const OscatsExaminee *e,
                                GBitArray *eligible,
                                gpointer data);
+gint oscats_alg_chooser_choose_values(OscatsAlgChooser *chooser,
+                                      GBitArray *eligible,
+                                      const gdouble *values);
+guint oscats_alg_chooser_rank(OscatsAlgChooser *chooser,
+                              const OscatsExaminee *e,
+                              GBitArray *eligible,
+                              gpointer data, GArray *ranked);
 
 G_END_DECLS
 #endif
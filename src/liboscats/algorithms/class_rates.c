@@ -36,6 +36,7 @@ static void oscats_alg_class_rates_set_property(GObject *object,
 static void oscats_alg_class_rates_get_property(GObject *object,
               guint prop_id, GValue *value, GParamSpec *pspec);
 static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test);
+static void alg_merge (OscatsAlgorithm *alg_data, OscatsAlgorithm *other);
 
 static void oscats_alg_class_rates_class_init (OscatsAlgClassRatesClass *klass)
 {
@@ -48,6 +49,7 @@ static void oscats_alg_class_rates_class_init (OscatsAlgClassRatesClass *klass)
   gobject_class->get_property = oscats_alg_class_rates_get_property;
 
   OSCATS_ALGORITHM_CLASS(klass)->reg = alg_register;
+  OSCATS_ALGORITHM_CLASS(klass)->merge = alg_merge;
 
 /**
  * OscatsAlgClassRates:by-pattern:
@@ -231,8 +233,49 @@ static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test)
 {
 //  OscatsAlgClassRates *self = OSCATS_ALG_CLASS_RATES(alg_data);
 
-  g_signal_connect_data(test, "finalize", G_CALLBACK(finalize),
-                        alg_data, oscats_algorithm_closure_finalize, 0);
+  oscats_test_connect_native(test, "finalize", G_CALLBACK(finalize),
+                             alg_data, oscats_algorithm_closure_finalize);
+}
+
+static gboolean merge_pattern(gpointer key, gpointer value, gpointer tree)
+{
+  guint *rhs = value;
+  guint *data = g_tree_lookup(tree, key);
+  if (!data)
+  {
+    GBitArray *attr = g_bit_array_new(g_bit_array_get_len(key));
+    g_bit_array_copy(attr, key);
+    data = g_new0(guint, 2);
+    g_tree_insert(tree, attr, data);
+  }
+  data[0] += rhs[0];
+  data[1] += rhs[1];
+  return FALSE;
+}
+
+static void alg_merge (OscatsAlgorithm *alg_data, OscatsAlgorithm *other)
+{
+  OscatsAlgClassRates *self = OSCATS_ALG_CLASS_RATES(alg_data);
+  OscatsAlgClassRates *rhs = OSCATS_ALG_CLASS_RATES(other);
+  guint i;
+
+  if (rhs->correct_attribute == NULL) return;	// Nothing tabulated
+  if (G_UNLIKELY(self->correct_attribute == NULL))
+  {
+    self->num_attrs = rhs->num_attrs;
+    self->correct_attribute = g_new0(guint, self->num_attrs);
+    self->misclassify_hist = g_new0(guint, self->num_attrs+1);
+  }
+  else g_return_if_fail(self->num_attrs == rhs->num_attrs);
+
+  self->num_examinees += rhs->num_examinees;
+  self->correct_patterns += rhs->correct_patterns;
+  for (i=0; i < self->num_attrs; i++)
+    self->correct_attribute[i] += rhs->correct_attribute[i];
+  for (i=0; i <= self->num_attrs; i++)
+    self->misclassify_hist[i] += rhs->misclassify_hist[i];
+  if (self->rate_by_pattern && rhs->rate_by_pattern)
+    g_tree_foreach(rhs->rate_by_pattern, merge_pattern, self->rate_by_pattern);
 }
 
 /**
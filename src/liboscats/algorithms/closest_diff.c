@@ -24,6 +24,7 @@ enum {
   PROP_NUM,
   PROP_MODEL_KEY,
   PROP_THETA_KEY,
+  PROP_RNG,
 };
 
 G_DEFINE_TYPE(OscatsAlgClosestDiff, oscats_alg_closest_diff, OSCATS_TYPE_ALGORITHM);
@@ -89,6 +90,24 @@ static void oscats_alg_closest_diff_class_init (OscatsAlgClosestDiffClass *klass
                             G_PARAM_STATIC_BLURB);
   g_object_class_install_property(gobject_class, PROP_THETA_KEY, pspec);
 
+/**
+ * OscatsAlgClosestDiff:rng:
+ *
+ * The random number generator used to choose among the
+ * #OscatsAlgClosestDiff:num best items.  If %NULL, the library-wide generator
+ * is used.  Otherwise, each examinee's choices are made with a substream
+ * of @rng determined by the examinee's id
+ * [see oscats_algorithm_examinee_rng()].  The choices are reproducible
+ * between runs only if the examinees are given explicit ids.
+ */
+  pspec = g_param_spec_object("rng", "Random number generator", 
+                            "Generator for choosing among the best items",
+                            OSCATS_TYPE_RNG,
+                            G_PARAM_READWRITE |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_RNG, pspec);
+
 }
 
 static void oscats_alg_closest_diff_init (OscatsAlgClosestDiff *self)
@@ -100,7 +119,10 @@ static void oscats_alg_closest_diff_dispose (GObject *object)
   OscatsAlgClosestDiff *self = OSCATS_ALG_CLOSEST_DIFF(object);
   G_OBJECT_CLASS(oscats_alg_closest_diff_parent_class)->dispose(object);
   if (self->chooser) g_object_unref(self->chooser);
+  if (self->rng) g_object_unref(self->rng);
+  if (self->stream) g_object_unref(self->stream);
   self->chooser = NULL;
+  self->rng = self->stream = NULL;
 }
 
 static void oscats_alg_closest_diff_set_property(GObject *object,
@@ -130,6 +152,11 @@ static void oscats_alg_closest_diff_set_property(GObject *object,
     }
       break;
     
+    case PROP_RNG:
+      if (self->rng) g_object_unref(self->rng);
+      self->rng = g_value_dup_object(value);
+      break;
+    
     default:
       // Unknown property
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -157,6 +184,10 @@ static void oscats_alg_closest_diff_get_property(GObject *object,
                          g_quark_to_string(self->thetaKey) : "");
       break;
     
+    case PROP_RNG:
+      g_value_set_object(value, self->rng);
+      break;
+    
     default:
       // Unknown property
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -175,6 +206,17 @@ static gdouble criterion(const OscatsItem *item, OscatsExaminee *e,
   return oscats_model_distance(model, theta, e->covariates);
 }
 
+static void initialize(OscatsTest *test, OscatsExaminee *e, gpointer alg_data)
+{
+  OscatsAlgClosestDiff *self = OSCATS_ALG_CLOSEST_DIFF(alg_data);
+  if (self->rng)
+  {
+    self->stream = oscats_algorithm_examinee_rng(alg_data, self->rng,
+                                                 self->stream, e);
+    self->chooser->rng = self->stream;
+  }
+}
+
 static gint select (OscatsTest *test, OscatsExaminee *e,
                     GBitArray *eligible, gpointer alg_data)
 {
@@ -194,7 +236,10 @@ static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test)
   OscatsAlgClosestDiff *self = OSCATS_ALG_CLOSEST_DIFF(alg_data);
   self->chooser->bank = g_object_ref(test->itembank);
   self->chooser->criterion = (OscatsAlgChooserCriterion)criterion;
-  g_signal_connect_data(test, "select", G_CALLBACK(select),
-                        alg_data, oscats_algorithm_closure_finalize, 0);
+  oscats_test_connect_native(test, "select", G_CALLBACK(select),
+                             alg_data, oscats_algorithm_closure_finalize);
+  g_object_ref(alg_data);
+  oscats_test_connect_native(test, "initialize", G_CALLBACK(initialize),
+                             alg_data, oscats_algorithm_closure_finalize);
 }
                    
@@ -38,13 +38,14 @@ typedef struct _OscatsAlgClosestDiffClass OscatsAlgClosestDiffClass;
  *
  * Item selection algorithm (#OscatsTest::select).
  * Picks the item whose difficulty parameter is closest to the current
- * estimate of theta.  Note: This algorithm won't work correctly if there
- * are multiple items with exactly the same location metric.
+ * estimate of theta.  Items at exactly the same distance are ranked by
+ * their index in the item bank.
  */
 struct _OscatsAlgClosestDiff {
   OscatsAlgorithm parent_instance;
   /*< private >*/
   OscatsAlgChooser *chooser;
+  OscatsRng *rng, *stream;
   GQuark modelKey, thetaKey;
 };
 
@@ -19,11 +19,22 @@
 #include <math.h>
 #include <gsl/gsl_blas.h>
 #include <gsl/gsl_linalg.h>
+#include <gsl/gsl_eigen.h>
 #include "gsl.h"
 #include "algorithm.h"
 #include "algorithms/estimate.h"
+#include "models/l1p.h"
+#include "models/l2p.h"
+#include "models/l3p.h"
+#include "models/pc.h"
+#include "models/gr.h"
+#include "models/gpc.h"
 
 #define MAX_MLE_ITERS 10
+#define MAX_HALVINGS 10
+#define RECT_RANGE 4		// half-width of rectangular grid, in prior sd's
+#define MAX_CLASS_BITS 20	// largest discrete space to tabulate
+#define MAX_CLASSES (1 << MAX_CLASS_BITS)
 
 enum {
   PROP_0,
@@ -36,6 +47,14 @@ enum {
   PROP_TOL,
   PROP_MODEL_KEY,
   PROP_THETA_KEY,
+  PROP_QUAD_POINTS,
+  PROP_QUAD_RECT,
+  PROP_QUAD_NODES,
+  PROP_QUAD_WEIGHTS,
+  PROP_SCORING,
+  PROP_INTEGRATE_METHOD,
+  PROP_INTEGRATE_SIZE,
+  PROP_INTEGRATE_SEED,
 };
 
 G_DEFINE_TYPE(OscatsAlgEstimate, oscats_alg_estimate, OSCATS_TYPE_ALGORITHM);
@@ -166,6 +185,21 @@ static void oscats_alg_estimate_class_init (OscatsAlgEstimateClass *klass)
                               G_PARAM_STATIC_BLURB);
   g_object_class_install_property(gobject_class, PROP_TOL, pspec);
 
+/**
+ * OscatsAlgEstimate:scoring:
+ *
+ * If %TRUE, use Fisher scoring (the expected information) instead of the
+ * observed Hessian in the Newton-Raphson iterations.  Either way, a step
+ * that decreases the likelihood is halved until it does not.
+ */
+  pspec = g_param_spec_boolean("scoring", "Fisher scoring", 
+                               "Use Fisher scoring for maximization",
+                               FALSE,
+                               G_PARAM_READWRITE |
+                               G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                               G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_SCORING, pspec);
+
 /**
  * OscatsAlgEstimate:modelKey:
  *
@@ -194,6 +228,157 @@ static void oscats_alg_estimate_class_init (OscatsAlgEstimateClass *klass)
                             G_PARAM_STATIC_BLURB);
   g_object_class_install_property(gobject_class, PROP_THETA_KEY, pspec);
 
+/**
+ * OscatsAlgEstimate:quad-points:
+ *
+ * Number of quadrature points per continuous dimension for EAP
+ * estimation.  If zero, the EAP is found by adaptive integration over the
+ * whole space.  Otherwise, the posterior is evaluated once per update on a
+ * fixed tensor-product grid (Gauss-Hermite, unless
+ * #OscatsAlgEstimate:quad-rect is set) centered on the prior, and the
+ * means and posterior covariance for all continuous dimensions are computed
+ * from the same pass [see oscats_alg_estimate_get_variance()].  Note that
+ * the grid has quad-points^D nodes for D continuous dimensions.
+ */
+  pspec = g_param_spec_uint("quad-points", "quadrature points", 
+                            "Quadrature points per dimension for EAP",
+                            0, 1000, 0,
+                            G_PARAM_READWRITE |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_QUAD_POINTS, pspec);
+
+/**
+ * OscatsAlgEstimate:quad-rect:
+ *
+ * Use equally spaced quadrature points over +/- 4 prior standard
+ * deviations, instead of Gauss-Hermite points.  Ignored unless
+ * #OscatsAlgEstimate:quad-points is positive.
+ */
+  pspec = g_param_spec_boolean("quad-rect", "rectangular quadrature", 
+                               "Use a rectangular quadrature grid",
+                               FALSE,
+                               G_PARAM_READWRITE |
+                               G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                               G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_QUAD_RECT, pspec);
+
+/**
+ * OscatsAlgEstimate:quad-nodes:
+ *
+ * User-supplied quadrature nodes for EAP estimation, one node per row, with
+ * one column for each continuous dimension.  Used together with
+ * #OscatsAlgEstimate:quad-weights, and takes precedence over
+ * #OscatsAlgEstimate:quad-points.  (Note: The value is copied.)
+ */
+  pspec = g_param_spec_object("quad-nodes", "quadrature nodes", 
+                              "User-supplied quadrature nodes for EAP",
+                              G_TYPE_GSL_MATRIX,
+                              G_PARAM_READWRITE |
+                              G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                              G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_QUAD_NODES, pspec);
+
+/**
+ * OscatsAlgEstimate:quad-weights:
+ *
+ * Weights for the user-supplied quadrature nodes
+ * #OscatsAlgEstimate:quad-nodes.  The weights must be positive and include
+ * the prior density (i.e. the prior expectation of f is approximated by
+ * sum_g w_g f(x_g)).  The normal prior set by #OscatsAlgEstimate:mu and
+ * #OscatsAlgEstimate:Sigma is not used with user-supplied nodes.
+ * (Note: The value is copied.)
+ */
+  pspec = g_param_spec_object("quad-weights", "quadrature weights", 
+                              "Weights for user-supplied quadrature nodes",
+                              G_TYPE_GSL_VECTOR,
+                              G_PARAM_READWRITE |
+                              G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                              G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_QUAD_WEIGHTS, pspec);
+
+/**
+ * OscatsAlgEstimate:integrate-method:
+ *
+ * The method for EAP integration over the whole space when
+ * #OscatsAlgEstimate:quad-points is zero and no quadrature nodes are
+ * supplied [see oscats_integrate_set_method()].  Adaptive integration
+ * becomes impractical beyond two or three continuous dimensions; the
+ * quasi-Monte Carlo and sparse-grid methods use a fixed number of
+ * evaluations.  The posterior mean and its normalizing constant are
+ * integrated with the same points.
+ */
+  pspec = g_param_spec_enum("integrate-method", "integration method", 
+                            "Method for EAP integration",
+                            OSCATS_TYPE_INTEGRATE_METHOD,
+                            OSCATS_INTEGRATE_ADAPTIVE,
+                            G_PARAM_READWRITE |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_INTEGRATE_METHOD, pspec);
+
+/**
+ * OscatsAlgEstimate:integrate-size:
+ *
+ * The number of points per replicate for quasi-Monte Carlo, or the level
+ * of the sparse grid, for #OscatsAlgEstimate:integrate-method.  Zero
+ * selects the default.
+ */
+  pspec = g_param_spec_uint("integrate-size", "integration size", 
+                            "Points or level for EAP integration",
+                            0, G_MAXUINT, 0,
+                            G_PARAM_READWRITE |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_INTEGRATE_SIZE, pspec);
+
+/**
+ * OscatsAlgEstimate:integrate-seed:
+ *
+ * The seed of the generator for the random shifts of quasi-Monte Carlo
+ * integration.  Clones made by oscats_algorithm_clone() share the seed,
+ * so they integrate with the same points.
+ */
+  pspec = g_param_spec_uint64("integrate-seed", "integration seed", 
+                              "Seed for quasi-Monte Carlo shifts",
+                              0, G_MAXUINT64, 0,
+                              G_PARAM_READWRITE |
+                              G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                              G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_INTEGRATE_SEED, pspec);
+
+}
+
+// Uses the same quasi-Monte Carlo shifts for the EAP and the normalizer
+static void set_integrate_method(OscatsAlgEstimate *self)
+{
+  OscatsRng *rng = NULL;
+  if (self->integ_method != OSCATS_INTEGRATE_ADAPTIVE)
+    rng = oscats_rng_new(self->integ_seed);
+  oscats_integrate_set_method(self->integrator, self->integ_method,
+                              self->integ_size, rng);
+  if (rng)
+  {
+    g_object_unref(rng);
+    rng = oscats_rng_new(self->integ_seed);
+  }
+  oscats_integrate_set_method(self->normalizer, self->integ_method,
+                              self->integ_size, rng);
+  if (rng) g_object_unref(rng);
+}
+
+static void clear_grid(OscatsAlgEstimate *self)
+{
+  if (self->quad_nodes) gsl_matrix_free(self->quad_nodes);
+  if (self->quad_logw) gsl_vector_free(self->quad_logw);
+  if (self->post) gsl_vector_free(self->post);
+  if (self->loglik) gsl_vector_free(self->loglik);
+  if (self->posterior) g_object_unref(self->posterior);
+  self->quad_nodes = NULL;
+  self->quad_logw = self->post = self->loglik = NULL;
+  self->posterior = NULL;
+  self->post_e = NULL;
+  self->post_num = self->num_classes = 0;
 }
 
 static void oscats_alg_estimate_init (OscatsAlgEstimate *self)
@@ -206,20 +391,36 @@ static void oscats_alg_estimate_dispose (GObject *object)
 {
   OscatsAlgEstimate *self = OSCATS_ALG_ESTIMATE(object);
   G_OBJECT_CLASS(oscats_alg_estimate_parent_class)->dispose(object);
-  if (self->mu) g_object_unref(self->mu);
-  if (self->Sigma_half) g_object_unref(self->Sigma_half);
+  if (self->mu) gsl_vector_free(self->mu);
+  if (self->Sigma_half) gsl_matrix_free(self->Sigma_half);
   if (self->Dprior) g_object_unref(self->Dprior);
   if (self->integrator) g_object_unref(self->integrator);
   if (self->normalizer) g_object_unref(self->normalizer);
   if (self->x) g_object_unref(self->x);
-  if (self->tmp) gsl_vector_free(self->tmp);
-  if (self->tmp2) gsl_vector_free(self->tmp2);
+  if (self->user_nodes) gsl_matrix_free(self->user_nodes);
+  if (self->user_weights) gsl_vector_free(self->user_weights);
+  if (self->var) g_object_unref(self->var);
+  if (self->nr_grad) g_object_unref(self->nr_grad);
+  if (self->nr_delta) g_object_unref(self->nr_delta);
+  if (self->nr_hes) g_object_unref(self->nr_hes);
+  if (self->nr_perm) g_object_unref(self->nr_perm);
+  g_free(self->nr_start);
+  g_free(self->batch_buf);
+  clear_grid(self);
   self->mu = NULL;
   self->Sigma_half = NULL;
   self->Dprior = NULL;
   self->integrator = self->normalizer = NULL;
   self->x = NULL;
-  self->tmp = self->tmp2 = NULL;
+  self->batch_buf = NULL;
+  self->batch_size = 0;
+  self->user_nodes = NULL;
+  self->user_weights = NULL;
+  self->var = NULL;
+  self->nr_grad = self->nr_delta = NULL;
+  self->nr_hes = NULL;
+  self->nr_perm = NULL;
+  self->nr_start = NULL;
 }
 
 static void oscats_alg_estimate_set_property(GObject *object,
@@ -250,12 +451,13 @@ static void oscats_alg_estimate_set_property(GObject *object,
           gsl_vector_free(self->mu);
           self->mu = NULL;
         }
-        if (self->mu == NULL) self->mu = gsl_vector_alloc(self->mu->size);
+        if (self->mu == NULL) self->mu = gsl_vector_alloc(mu->v->size);
         gsl_vector_memcpy(self->mu, mu->v);
       } else {
         if (self->mu) gsl_vector_free(self->mu);
         self->mu = NULL;
       }
+      clear_grid(self);
       break;
     }
     
@@ -273,18 +475,77 @@ static void oscats_alg_estimate_set_property(GObject *object,
         if (self->Sigma_half) gsl_matrix_free(self->Sigma_half);
         self->Sigma_half = NULL;
       }
+      clear_grid(self);
       break;
     }
     
     case PROP_DPRIOR:
       if (self->Dprior) g_object_unref(self->Dprior);
-      self->Dprior = g_value_get_object(value);
+      self->Dprior = g_value_dup_object(value);
+      clear_grid(self);
       break;
     
     case PROP_TOL:
       self->tol = g_value_get_double(value);
       break;
 
+    case PROP_SCORING:
+      self->scoring = g_value_get_boolean(value);
+      break;
+
+    case PROP_QUAD_POINTS:
+      self->quad_points = g_value_get_uint(value);
+      clear_grid(self);
+      break;
+
+    case PROP_QUAD_RECT:
+      self->quad_rect = g_value_get_boolean(value);
+      clear_grid(self);
+      break;
+
+    case PROP_QUAD_NODES:
+    {
+      GGslMatrix *nodes = g_value_get_object(value);
+      if (self->user_nodes) gsl_matrix_free(self->user_nodes);
+      self->user_nodes = NULL;
+      if (nodes)
+      {
+        self->user_nodes = gsl_matrix_alloc(nodes->v->size1, nodes->v->size2);
+        gsl_matrix_memcpy(self->user_nodes, nodes->v);
+      }
+      clear_grid(self);
+      break;
+    }
+
+    case PROP_QUAD_WEIGHTS:
+    {
+      GGslVector *weights = g_value_get_object(value);
+      if (self->user_weights) gsl_vector_free(self->user_weights);
+      self->user_weights = NULL;
+      if (weights)
+      {
+        self->user_weights = gsl_vector_alloc(weights->v->size);
+        gsl_vector_memcpy(self->user_weights, weights->v);
+      }
+      clear_grid(self);
+      break;
+    }
+
+    case PROP_INTEGRATE_METHOD:
+      self->integ_method = g_value_get_enum(value);
+      set_integrate_method(self);
+      break;
+
+    case PROP_INTEGRATE_SIZE:
+      self->integ_size = g_value_get_uint(value);
+      set_integrate_method(self);
+      break;
+
+    case PROP_INTEGRATE_SEED:
+      self->integ_seed = g_value_get_uint64(value);
+      set_integrate_method(self);
+      break;
+
     case PROP_MODEL_KEY:
     {
       const gchar *key = g_value_get_string(value);
@@ -363,6 +624,51 @@ static void oscats_alg_estimate_get_property(GObject *object,
       g_value_set_double(value, self->tol);
       break;
     
+    case PROP_SCORING:
+      g_value_set_boolean(value, self->scoring);
+      break;
+    
+    case PROP_QUAD_POINTS:
+      g_value_set_uint(value, self->quad_points);
+      break;
+    
+    case PROP_QUAD_RECT:
+      g_value_set_boolean(value, self->quad_rect);
+      break;
+    
+    case PROP_QUAD_NODES:
+      if (self->user_nodes)
+      {
+        GGslMatrix *nodes = g_gsl_matrix_new(self->user_nodes->size1,
+                                             self->user_nodes->size2);
+        gsl_matrix_memcpy(nodes->v, self->user_nodes);
+        g_value_take_object(value, nodes);
+      } else
+        g_value_set_object(value, NULL);
+      break;
+    
+    case PROP_QUAD_WEIGHTS:
+      if (self->user_weights)
+      {
+        GGslVector *weights = g_gsl_vector_new(self->user_weights->size);
+        gsl_vector_memcpy(weights->v, self->user_weights);
+        g_value_take_object(value, weights);
+      } else
+        g_value_set_object(value, NULL);
+      break;
+    
+    case PROP_INTEGRATE_METHOD:
+      g_value_set_enum(value, self->integ_method);
+      break;
+    
+    case PROP_INTEGRATE_SIZE:
+      g_value_set_uint(value, self->integ_size);
+      break;
+    
+    case PROP_INTEGRATE_SEED:
+      g_value_set_uint64(value, self->integ_seed);
+      break;
+    
     case PROP_MODEL_KEY:
       g_value_set_string(value, self->modelKey ?
                          g_quark_to_string(self->modelKey) : "");
@@ -380,6 +686,22 @@ static void oscats_alg_estimate_get_property(GObject *object,
   }
 }
 
+static void alloc_nr(OscatsAlgEstimate *self, guint dim)
+{
+  if (self->nr_grad && self->nr_grad->v->size == dim) return;
+  if (self->nr_grad) g_object_unref(self->nr_grad);
+  if (self->nr_delta) g_object_unref(self->nr_delta);
+  if (self->nr_hes) g_object_unref(self->nr_hes);
+  if (self->nr_perm) g_object_unref(self->nr_perm);
+  g_free(self->nr_start);
+  self->nr_grad = g_gsl_vector_new(dim);
+  self->nr_delta = g_gsl_vector_new(dim);
+  self->nr_hes = g_gsl_matrix_new(dim, dim);
+  self->nr_perm = g_gsl_permutation_new(dim);
+  self->nr_start = g_new(gdouble, dim);
+}
+
+// Starts from the current value of theta.  On failure, theta is restored.
 // returns TRUE if fails to converge
 static gboolean NR(OscatsExaminee *e, OscatsPoint *theta, OscatsAlgEstimate *alg_data)
 {
@@ -387,9 +709,8 @@ static gboolean NR(OscatsExaminee *e, OscatsPoint *theta, OscatsAlgEstimate *alg
   OscatsModel *model;
   GGslVector *grad, *delta;
   GGslMatrix *hes;
-  GGslPermutation *perm;
-  guint dim, num, i, iters = 0;
-  gdouble diff, x;
+  guint dim, num, i, h, iters = 0;
+  gdouble diff, L, L_new, step, *start;
   gboolean fail = FALSE;
 
   item = g_ptr_array_index(e->items, 0);
@@ -398,11 +719,16 @@ static gboolean NR(OscatsExaminee *e, OscatsPoint *theta, OscatsAlgEstimate *alg
 
   num = e->items->len;
   dim = theta->space->num_cont;
-  grad = g_gsl_vector_new(dim);
-  delta = g_gsl_vector_new(dim);
-  hes = g_gsl_matrix_new(dim, dim);
-  perm = g_gsl_permutation_new(dim);
-  
+  alloc_nr(alg_data, dim);
+  grad = alg_data->nr_grad;
+  delta = alg_data->nr_delta;
+  hes = alg_data->nr_hes;
+  start = alg_data->nr_start;
+  // Step direction: theta - hes^(-1) grad, or theta + I^(-1) grad
+  step = (alg_data->scoring ? 1 : -1);
+
+  for (i=0; i < dim; i++) start[i] = theta->cont[i];
+  L = oscats_examinee_logLik(e, theta, alg_data->modelKey);
   do
   {
     g_gsl_vector_set_all(grad, 0);
@@ -410,44 +736,108 @@ static gboolean NR(OscatsExaminee *e, OscatsPoint *theta, OscatsAlgEstimate *alg
     for (i=0; i < num; i++)
     {
       item = g_ptr_array_index(e->items, i);
-      oscats_model_logLik_dtheta(
-        oscats_administrand_get_model(OSCATS_ADMINISTRAND(item), alg_data->modelKey),
-        e->resp->data[i], theta, e->covariates, grad, hes);
+      model = oscats_administrand_get_model(OSCATS_ADMINISTRAND(item),
+                                            alg_data->modelKey);
+      if (alg_data->scoring)
+      {
+        oscats_model_logLik_dtheta(model, e->resp->data[i], theta,
+                                   e->covariates, grad, NULL);
+        oscats_model_fisher_inf(model, theta, e->covariates, hes);
+      }
+      else
+        oscats_model_logLik_dtheta(model, e->resp->data[i], theta,
+                                   e->covariates, grad, hes);
     }
-    // delta = hes^(-1) * grad
-    g_gsl_matrix_solve(hes, grad, delta, perm);
-    // theta <- theta - delta
+    g_gsl_matrix_solve(hes, grad, delta, alg_data->nr_perm);
+
+    // Take the step, halving it until the likelihood doesn't decrease
+    for (h=0; h <= MAX_HALVINGS; h++)
+    {
+      for (i=0; i < dim; i++)
+        theta->cont[i] += step * gsl_vector_get(delta->v, i);
+      L_new = oscats_examinee_logLik(e, theta, alg_data->modelKey);
+      if (isfinite(L_new) && L_new >= L) break;
+      for (i=0; i < dim; i++)
+        theta->cont[i] -= step * gsl_vector_get(delta->v, i);
+      gsl_vector_scale(delta->v, 0.5);
+    }
+
     diff = 0;
     for (i=0; i < dim; i++)
     {
-      x = gsl_vector_get(delta->v, i);
-      if (fabs(x) > diff) diff = fabs(x);
-      x = (theta->cont[i] -= x);
-      if (!isfinite(x)) fail = TRUE;
+      gdouble x = fabs(gsl_vector_get(delta->v, i));
+      if (x > diff) diff = x;
+      if (!isfinite(theta->cont[i])) fail = TRUE;
+    }
+    if (h > MAX_HALVINGS)     // no ascent possible
+    {
+      fail = fail || diff > alg_data->tol;
+      break;
     }
+    L = L_new;
     if (++iters == MAX_MLE_ITERS) fail = TRUE;
   } while (diff > alg_data->tol && !fail);
 
-  // FIXME: Improve performance by putting persistent instances in alg_data
-  g_object_unref(grad);
-  g_object_unref(delta);
-  g_object_unref(hes);
-  g_object_unref(perm);
+  if (fail)
+    for (i=0; i < dim; i++) theta->cont[i] = start[i];
   return fail;
 }
 
+// TRUE if the categories of model are ordered and each is more likely
+// than the ones below it as any dimension increases: the 1PL and partial
+// credit models, and the 2PL, 3PL, graded response and generalized partial
+// credit models with positive discriminations.  Other models, including
+// subclasses of these, are not assumed to be monotone.
+static gboolean monotone_model(const OscatsModel *model)
+{
+  GType type = G_TYPE_FROM_INSTANCE(model);
+  guint k;
+  if (type == OSCATS_TYPE_MODEL_L1P || type == OSCATS_TYPE_MODEL_PC)
+    return TRUE;
+  if (type != OSCATS_TYPE_MODEL_L2P && type != OSCATS_TYPE_MODEL_L3P &&
+      type != OSCATS_TYPE_MODEL_GR && type != OSCATS_TYPE_MODEL_GPC)
+    return FALSE;
+  for (k=0; k < model->Np; k++)
+    if (g_str_has_prefix(g_quark_to_string(model->names[k]), "Discr.") &&
+        model->params[k] <= 0)
+      return FALSE;
+  return TRUE;
+}
+
+// TRUE if every item is monotone and every response is in the lowest or
+// every response is in the highest category, in which case the MLE is
+// infinite.  For other models, such a pattern may have a finite MLE.
+static gboolean extreme_pattern(OscatsExaminee *e, GQuark modelKey)
+{
+  gboolean low = TRUE, high = TRUE;
+  OscatsModel *model;
+  guint i;
+  for (i=0; i < e->items->len && (low || high); i++)
+  {
+    model = oscats_administrand_get_model(g_ptr_array_index(e->items, i),
+                                          modelKey);
+    if (!monotone_model(model)) return FALSE;
+    if (e->resp->data[i] != 0) low = FALSE;
+    if (e->resp->data[i] != oscats_model_get_max(model)) high = FALSE;
+  }
+  return low || high;
+}
+
+static gboolean discrete_mode(OscatsExaminee *e, OscatsPoint *theta,
+                              OscatsAlgEstimate *self, gboolean map,
+                              gboolean refit);
+
 // returns TRUE if fails to converge
 static gboolean MLE(OscatsExaminee *e, OscatsPoint *theta, OscatsAlgEstimate *alg_data)
 {
-  OscatsPoint *x = alg_data->x;
   guint numCont = theta->space->num_cont;
   guint numBin = theta->space->num_bin;
   guint numNat = theta->space->num_nat;
   gboolean haveDiscr = (numBin + numNat > 0);
   gboolean fail = FALSE;
-  OscatsNatural i, junk=0, *dimMax;
-  gdouble max = -G_MAXDOUBLE, L;
-  guint I, J;
+
+  if (numCont > 0 && !haveDiscr && extreme_pattern(e, alg_data->modelKey))
+    return TRUE;
 
   if (numCont > 0 && (alg_data->independent || !haveDiscr))
   {
@@ -457,70 +847,41 @@ static gboolean MLE(OscatsExaminee *e, OscatsPoint *theta, OscatsAlgEstimate *al
   
   g_return_val_if_fail(haveDiscr, TRUE);
 
-  if (numNat > 0) dimMax = theta->space->max;
-  else  // Fake a natural dimension
+  return discrete_mode(e, theta, alg_data, FALSE,
+                       !alg_data->independent && numCont > 0);
+}
+
+/*
+ * The integrals are taken in the whitened variable z, with x = mu + Lz
+ * and Sigma = LL' stored in Sigma_half, so that the prior quadratic form
+ * is |z|^2 and no solve is needed per node.  Sets self->x from z and
+ * returns |z|^2.  The Jacobian |L| cancels in the EAP.
+ */
+static gdouble prior_whiten(OscatsAlgEstimate *self, const gsl_vector *z)
+{
+  gsl_vector *x = oscats_point_cont_as_vector(self->x)->v;
+  gdouble g;
+  if (z->size == 1)
   {
-    numNat = 1;
-    dimMax = &junk;
+    x->data[0] = (self->mu ? self->mu->data[0] : 0) +
+                 (self->Sigma_half ? self->Sigma_half->data[0] : 1) *
+                 z->data[0];
+    return z->data[0]*z->data[0];
   }
-  
-  oscats_point_copy(x, theta);
-  for (I=0; I < numNat; I++)            // natural dimension
-    for (i=0; i <= dimMax[I]; i++)         // value of this natural dimension
-    {
-      if (theta->nat) theta->nat[I] = i;
-      if (numBin == 0)
-      {
-        if (!alg_data->independent && numCont > 0) fail = NR(e, x, alg_data);
-        if (fail) return TRUE;
-        L = oscats_examinee_logLik(e, x, alg_data->modelKey);
-        if (L > max)
-        {
-          max = L;
-          oscats_point_copy(theta, x);
-        }
-      } else
-        for (J=0; J < numBin; J++)      // binary dimension
-        {
-          // binary dim == 0
-          g_bit_array_clear_bit(x->bin, J);
-          if (!alg_data->independent && numCont > 0) fail = NR(e, x, alg_data);
-          if (fail) return TRUE;
-          L = oscats_examinee_logLik(e, x, alg_data->modelKey);
-          if (L > max)
-          {
-            max = L;
-            oscats_point_copy(theta, x);
-          }
-          
-          // binary dim == 1
-          g_bit_array_set_bit(x->bin, J);
-          if (!alg_data->independent && numCont > 0) fail = NR(e, x, alg_data);
-          if (fail) return TRUE;
-          L = oscats_examinee_logLik(e, x, alg_data->modelKey);
-          if (L > max)
-          {
-            max = L;
-            oscats_point_copy(theta, x);
-          }
-        }
-    }
-
-  return FALSE;
+  gsl_vector_memcpy(x, z);
+  if (self->Sigma_half)
+    gsl_blas_dtrmv(CblasLower, CblasNoTrans, CblasNonUnit,
+                   self->Sigma_half, x);
+  if (self->mu) gsl_vector_add(x, self->mu);
+  gsl_blas_ddot(z, z, &g);
+  return g;
 }
 
 // Note: the normalizing constant for the Normal prior is canceled.
 static gdouble eap_integrand(const GGslVector *x, gpointer data)
 {
   OscatsAlgEstimate *self = OSCATS_ALG_ESTIMATE(data);
-  gdouble g;
-  gsl_vector_memcpy(self->tmp, x->v);
-  if (self->mu) gsl_vector_sub(self->tmp, self->mu);
-  if (self->Sigma_half)
-    gsl_linalg_cholesky_solve(self->Sigma_half, self->tmp, self->tmp2);
-  else
-    gsl_vector_memcpy(self->tmp2, self->tmp);
-  gsl_blas_ddot(self->tmp, self->tmp2, &g);
+  gdouble g = prior_whiten(self, x->v);
   return self->x->cont[self->dim] *
          exp(oscats_examinee_logLik(self->e, self->x, self->modelKey) - g/2);
 }
@@ -528,17 +889,366 @@ static gdouble eap_integrand(const GGslVector *x, gpointer data)
 static gdouble norm_integrand(const GGslVector *x, gpointer data)
 {
   OscatsAlgEstimate *self = OSCATS_ALG_ESTIMATE(data);
-  gdouble g;
-  gsl_vector_memcpy(self->tmp, x->v);
-  if (self->mu) gsl_vector_sub(self->tmp, self->mu);
-  if (self->Sigma_half)
-    gsl_linalg_cholesky_solve(self->Sigma_half, self->tmp, self->tmp2);
-  else
-    gsl_vector_memcpy(self->tmp2, self->tmp);
-  gsl_blas_ddot(self->tmp, self->tmp2, &g);
+  gdouble g = prior_whiten(self, x->v);
   return exp(oscats_examinee_logLik(self->e, self->x, self->modelKey) - g/2);
 }
 
+/*
+ * Batch versions of the integrands, for a purely continuous space.  Maps
+ * the block of n whitened nodes z to theta = mu + Lz and accumulates the
+ * log posterior over the block one item at a time with
+ * oscats_model_P_grid().  Returns theta (n x dims), followed in the
+ * same buffer by the n log posteriors.
+ */
+static const gdouble * batch_post(OscatsAlgEstimate *self, guint n,
+                                  const gdouble *z)
+{
+  OscatsExaminee *e = self->e;
+  guint d = self->x->space->num_cont, g, i, j;
+  gdouble *theta, *logL, *P, s;
+
+  if (n*(d+2) > self->batch_size)
+  {
+    self->batch_size = n*(d+2);
+    self->batch_buf = g_renew(gdouble, self->batch_buf, self->batch_size);
+  }
+  theta = self->batch_buf;
+  logL = theta + n*d;
+  P = logL + n;
+
+  for (g=0; g < n; g++, z += d)
+  {
+    for (i=0, s=0; i < d; i++) s += z[i]*z[i];
+    logL[g] = -s/2;
+    for (i=0; i < d; i++)
+    {
+      s = (self->mu ? gsl_vector_get(self->mu, i) : 0);
+      if (self->Sigma_half)
+        for (j=0; j <= i; j++)
+          s += gsl_matrix_get(self->Sigma_half, i, j) * z[j];
+      else
+        s += z[i];
+      theta[g*d+i] = s;
+    }
+  }
+
+  for (i=0; i < e->items->len; i++)
+  {
+    oscats_model_P_grid(
+      oscats_administrand_get_model(g_ptr_array_index(e->items, i),
+                                    self->modelKey),
+      e->resp->data[i], theta, n, e->covariates, P);
+    for (g=0; g < n; g++) logL[g] += log(P[g]);
+  }
+  return theta;
+}
+
+static void eap_batch(guint n, const gdouble *z, gdouble *f, gpointer data)
+{
+  OscatsAlgEstimate *self = OSCATS_ALG_ESTIMATE(data);
+  guint d = self->x->space->num_cont, g;
+  const gdouble *theta = batch_post(self, n, z), *logL = theta + n*d;
+  for (g=0; g < n; g++)
+    f[g] = theta[g*d+self->dim] * exp(logL[g]);
+}
+
+static void norm_batch(guint n, const gdouble *z, gdouble *f, gpointer data)
+{
+  OscatsAlgEstimate *self = OSCATS_ALG_ESTIMATE(data);
+  guint d = self->x->space->num_cont, g;
+  const gdouble *logL = batch_post(self, n, z) + n*d;
+  for (g=0; g < n; g++)
+    f[g] = exp(logL[g]);
+}
+
+// One-dimensional rule for the standard normal: sum_i w[i] f(z[i])
+static void quad_rule(guint n, gboolean rect, gdouble *z, gdouble *w)
+{
+  guint i;
+  if (n == 1)
+  {
+    z[0] = 0;
+    w[0] = 1;
+  }
+  else if (rect)
+  {
+    gdouble sum = 0;
+    for (i=0; i < n; i++)
+    {
+      z[i] = -RECT_RANGE + 2*RECT_RANGE*i/(gdouble)(n-1);
+      sum += (w[i] = exp(-z[i]*z[i]/2));
+    }
+    for (i=0; i < n; i++) w[i] /= sum;
+  }
+  else
+  {
+    // Golub-Welsch: nodes are the eigenvalues of the Jacobi matrix for the
+    // probabilists' Hermite polynomials; weights are the squared first
+    // components of the normalized eigenvectors.
+    gsl_matrix *J = gsl_matrix_calloc(n, n);
+    gsl_matrix *evec = gsl_matrix_alloc(n, n);
+    gsl_vector_view eval = gsl_vector_view_array(z, n);
+    gsl_eigen_symmv_workspace *ws = gsl_eigen_symmv_alloc(n);
+    for (i=1; i < n; i++)
+    {
+      gsl_matrix_set(J, i-1, i, sqrt(i));
+      gsl_matrix_set(J, i, i-1, sqrt(i));
+    }
+    gsl_eigen_symmv(J, &eval.vector, evec, ws);
+    for (i=0; i < n; i++)
+      w[i] = gsl_matrix_get(evec, 0, i) * gsl_matrix_get(evec, 0, i);
+    gsl_eigen_symmv_free(ws);
+    gsl_matrix_free(evec);
+    gsl_matrix_free(J);
+  }
+}
+
+// Sets up quad_nodes/quad_logw for dims continuous dimensions
+static gboolean build_grid(OscatsAlgEstimate *self, guint dims)
+{
+  guint n = self->quad_points, G = 1, g, i, j, k;
+  
+  clear_grid(self);
+  if (self->user_nodes || self->user_weights)
+  {
+    g_return_val_if_fail(self->user_nodes && self->user_weights, FALSE);
+    G = self->user_nodes->size1;
+    g_return_val_if_fail(self->user_nodes->size2 == dims &&
+                         self->user_weights->size == G, FALSE);
+    for (g=0; g < G; g++)
+      g_return_val_if_fail(gsl_vector_get(self->user_weights, g) > 0, FALSE);
+    self->quad_nodes = gsl_matrix_alloc(G, dims);
+    self->quad_logw = gsl_vector_alloc(G);
+    gsl_matrix_memcpy(self->quad_nodes, self->user_nodes);
+    for (g=0; g < G; g++)
+      gsl_vector_set(self->quad_logw, g,
+                     log(gsl_vector_get(self->user_weights, g)));
+  }
+  else
+  {
+    gdouble z[n], w[n];
+    gsl_vector *x;
+    for (i=0; i < dims; i++)
+    {
+      g_return_val_if_fail(G <= G_MAXUINT/n, FALSE);
+      G *= n;
+    }
+    if (self->mu) g_return_val_if_fail(self->mu->size == dims, FALSE);
+    if (self->Sigma_half)
+      g_return_val_if_fail(self->Sigma_half->size1 == dims, FALSE);
+    quad_rule(n, self->quad_rect, z, w);
+    x = gsl_vector_alloc(dims);
+    self->quad_nodes = gsl_matrix_alloc(G, dims);
+    self->quad_logw = gsl_vector_alloc(G);
+    for (g=0; g < G; g++)
+    {
+      // theta = mu + Sigma_half z
+      gdouble logw = 0;
+      for (i=0, k=g; i < dims; i++, k /= n)
+      {
+        j = k % n;
+        gsl_vector_set(x, i, z[j]);
+        logw += log(w[j]);
+      }
+      if (self->Sigma_half)
+        gsl_blas_dtrmv(CblasLower, CblasNoTrans, CblasNonUnit,
+                       self->Sigma_half, x);
+      if (self->mu) gsl_vector_add(x, self->mu);
+      gsl_matrix_set_row(self->quad_nodes, g, x);
+      gsl_vector_set(self->quad_logw, g, logw);
+    }
+    gsl_vector_free(x);
+  }
+  self->post = gsl_vector_alloc(G);
+  if (self->var && self->var->v->size1 != dims)
+  {
+    g_object_unref(self->var);
+    self->var = NULL;
+  }
+  if (!self->var) self->var = g_gsl_matrix_new(dims, dims);
+  return TRUE;
+}
+
+// Sets up quad_logw over all latent classes of a purely discrete space.
+// Returns FALSE if the space is too large to tabulate.
+static gboolean build_classes(OscatsAlgEstimate *self, const OscatsSpace *space)
+{
+  guint C, c, i;
+
+  clear_grid(self);
+  if (space->num_bin > MAX_CLASS_BITS) return FALSE;
+  C = 1 << space->num_bin;
+  for (i=0; i < space->num_nat; i++)
+  {
+    if (C > MAX_CLASSES/(space->max[i]+1)) return FALSE;
+    C *= space->max[i]+1;
+  }
+  self->quad_logw = gsl_vector_alloc(C);
+  if (self->Dprior && self->Dprior->v->size == C)
+    for (c=0; c < C; c++)
+      gsl_vector_set(self->quad_logw, c, log(gsl_vector_get(self->Dprior->v, c)));
+  else
+  {
+    if (self->Dprior)
+      g_warning("Dprior has %d patterns, but the space has %d.  Using a uniform prior.",
+                (int)self->Dprior->v->size, C);
+    gsl_vector_set_all(self->quad_logw, 0);
+  }
+  self->post = gsl_vector_alloc(C);
+  self->num_classes = C;
+  return TRUE;
+}
+
+// Sets the discrete dimensions of x to latent class c, using the ordering
+// of #OscatsAlgEstimate:Dprior
+static void set_class(OscatsPoint *x, guint c)
+{
+  guint i;
+  for (i=0; i < x->space->num_bin; i++, c >>= 1)
+    g_bit_array_set_bit_val(x->bin, i, c & 1);
+  for (i=0; i < x->space->num_nat; i++)
+  {
+    x->nat[i] = c % (x->space->max[i]+1);
+    c /= x->space->max[i]+1;
+  }
+}
+
+// Adds log P for the items e has taken since the last call to the cached
+// log-likelihood.  Returns FALSE if there is no cache for this space.
+static gboolean update_loglik(OscatsAlgEstimate *self, OscatsExaminee *e)
+{
+  OscatsPoint *x = self->x;
+  OscatsModel *model;
+  OscatsResponse resp;
+  gdouble *L, *node;
+  guint G, g, i, n, num = x->space->num_cont;
+
+  if (self->num_classes > 0)
+    G = self->num_classes;
+  else if (self->quad_nodes && x->space->num_bin + x->space->num_nat == 0)
+    G = self->quad_nodes->size1;
+  else
+    return FALSE;
+  g_return_val_if_fail(e->items->len == e->resp->len, FALSE);
+
+  if (!self->loglik)
+  {
+    self->loglik = gsl_vector_alloc(G);
+    self->post_e = NULL;
+  }
+  if (e != self->post_e || e->items->len < self->post_num)
+  {
+    gsl_vector_set_zero(self->loglik);
+    self->post_e = e;
+    self->post_num = 0;
+  }
+  L = self->loglik->data;
+
+  for (n=self->post_num; n < e->items->len; n++)
+  {
+    model = oscats_administrand_get_model(g_ptr_array_index(e->items, n),
+                                          self->modelKey);
+    resp = e->resp->data[n];
+    if (self->num_classes == 0 && model->dimType == OSCATS_DIM_CONT &&
+        self->quad_nodes->tda == num)
+    {
+      oscats_model_P_grid(model, resp, self->quad_nodes->data, G,
+                          e->covariates, self->post->data);
+      for (g=0; g < G; g++)
+        L[g*self->loglik->stride] += log(self->post->data[g]);
+      continue;
+    }
+    if (self->num_classes > 0 && x->space->num_nat == 0)
+    {
+      oscats_model_P_patterns(model, resp, e->covariates, self->post->data);
+      for (g=0; g < G; g++)
+        L[g*self->loglik->stride] += log(self->post->data[g]);
+      continue;
+    }
+    for (g=0; g < G; g++)
+    {
+      if (self->num_classes > 0)
+        set_class(x, g);
+      else
+      {
+        node = gsl_matrix_ptr(self->quad_nodes, g, 0);
+        for (i=0; i < num; i++) x->cont[i] = node[i];
+      }
+      L[g*self->loglik->stride] +=
+        log(oscats_model_P(model, resp, x, e->covariates));
+    }
+  }
+  self->post_num = n;
+  return TRUE;
+}
+
+// Posterior mode over the latent classes (MAP), or likelihood mode (MLE)
+static void mode_classes(OscatsAlgEstimate *self, OscatsPoint *theta,
+                         gboolean map)
+{
+  gdouble max = -G_MAXDOUBLE, L;
+  guint c, best = 0;
+
+  for (c=0; c < self->num_classes; c++)
+  {
+    L = gsl_vector_get(self->loglik, c);
+    if (map) L += gsl_vector_get(self->quad_logw, c);
+    if (L > max)
+    {
+      max = L;
+      best = c;
+    }
+  }
+  set_class(theta, best);
+}
+
+// EAP and posterior covariance on the fixed grid in one pass over the nodes
+static void EAP_grid(OscatsAlgEstimate *alg_data)
+{
+  OscatsPoint *x = alg_data->x;
+  gsl_matrix *nodes = alg_data->quad_nodes;
+  gsl_matrix *var = alg_data->var->v;
+  gdouble *post = alg_data->post->data;
+  guint g, i, j, G = nodes->size1, num = x->space->num_cont;
+  gdouble eap[num], max = -G_MAXDOUBLE, sum = 0, *node;
+
+  for (g=0; g < G; g++)
+  {
+    post[g] = gsl_vector_get(alg_data->quad_logw, g);
+    if (alg_data->loglik)
+      post[g] += gsl_vector_get(alg_data->loglik, g);
+    else
+    {
+      node = gsl_matrix_ptr(nodes, g, 0);
+      for (i=0; i < num; i++) x->cont[i] = node[i];
+      post[g] += oscats_examinee_logLik(alg_data->e, x, alg_data->modelKey);
+    }
+    if (post[g] > max) max = post[g];
+  }
+  for (i=0; i < num; i++) eap[i] = 0;
+  for (g=0; g < G; g++)
+  {
+    node = gsl_matrix_ptr(nodes, g, 0);
+    sum += (post[g] = exp(post[g] - max));
+    for (i=0; i < num; i++) eap[i] += post[g] * node[i];
+  }
+  for (i=0; i < num; i++) eap[i] /= sum;
+  gsl_matrix_set_zero(var);
+  for (g=0; g < G; g++)
+  {
+    node = gsl_matrix_ptr(nodes, g, 0);
+    for (i=0; i < num; i++)
+      for (j=0; j <= i; j++)
+        var->data[i*var->tda+j] +=
+          post[g] * (node[i]-eap[i]) * (node[j]-eap[j]);
+  }
+  for (i=0; i < num; i++)
+    for (j=0; j <= i; j++)
+      var->data[j*var->tda+i] = (var->data[i*var->tda+j] /= sum);
+  for (i=0; i < num; i++)
+    x->cont[i] = eap[i];
+}
+
 // Note: This is only over cont dimensions, given the discr val of alg_data->x
 // Stores the final EAP back in alg_data->x.
 static void EAP(OscatsAlgEstimate *alg_data)
@@ -546,6 +1256,12 @@ static void EAP(OscatsAlgEstimate *alg_data)
   guint i, num = alg_data->x->space->num_cont;
   gdouble norm, eap[num];
 
+  if (alg_data->quad_nodes)
+  {
+    EAP_grid(alg_data);
+    return;
+  }
+
   for (alg_data->dim=0; alg_data->dim < num; alg_data->dim++)
     eap[alg_data->dim] = oscats_integrate_space(alg_data->integrator, alg_data);
   norm = oscats_integrate_space(alg_data->normalizer, alg_data);
@@ -553,6 +1269,163 @@ static void EAP(OscatsAlgEstimate *alg_data)
     alg_data->x->cont[i] = eap[i] / norm;
 }
 
+static gboolean model_uses_dim(const OscatsModel *model, OscatsDim dim)
+{
+  guint i;
+  for (i=0; i < model->Ndims; i++)
+    if (model->dims[i] == dim) return TRUE;
+  return FALSE;
+}
+
+// Objective for the discrete search at alg_data->x: the log-likelihood,
+// after re-estimating the continuous dimensions if refit.
+// Returns TRUE if the Newton-Raphson refit fails to converge.
+static gboolean pattern_score(OscatsExaminee *e, OscatsAlgEstimate *self,
+                              gboolean map, gboolean refit, gdouble *L)
+{
+  gboolean fail = FALSE;
+  if (refit)
+  {
+    if (map) EAP(self);
+    else fail = NR(e, self->x, self);
+  }
+  *L = oscats_examinee_logLik(e, self->x, self->modelKey);
+  return fail;
+}
+
+// Coordinate ascent over the discrete dimensions, for spaces with too many
+// patterns to enumerate.  Starting from theta, each binary dimension is
+// flipped and each natural dimension moved by one as long as that improves
+// the log-likelihood.  Finds a local mode only.
+static gboolean discrete_climb(OscatsExaminee *e, OscatsPoint *theta,
+                               OscatsAlgEstimate *self, gboolean map,
+                               gboolean refit)
+{
+  OscatsPoint *x = self->x;
+  const OscatsSpace *space = theta->space;
+  gboolean improved, fail;
+  gdouble best, L;
+  guint j, d;
+
+  oscats_point_copy(x, theta);
+  fail = pattern_score(e, self, map, refit, &best);
+  oscats_point_copy(theta, x);
+  do
+  {
+    improved = FALSE;
+    for (j=0; j < space->num_bin; j++)
+    {
+      if (g_bit_array_get_bit(x->bin, j)) g_bit_array_clear_bit(x->bin, j);
+      else g_bit_array_set_bit(x->bin, j);
+      fail |= pattern_score(e, self, map, refit, &L);
+      if (L > best)
+      {
+        best = L;
+        improved = TRUE;
+        oscats_point_copy(theta, x);
+      } else
+        oscats_point_copy(x, theta);
+    }
+    for (j=0; j < space->num_nat; j++)
+      for (d=0; d < 2; d++)
+      {
+        if (d == 0 && x->nat[j] < space->max[j]) x->nat[j]++;
+        else if (d == 1 && x->nat[j] > 0) x->nat[j]--;
+        else continue;
+        fail |= pattern_score(e, self, map, refit, &L);
+        if (L > best)
+        {
+          best = L;
+          improved = TRUE;
+          oscats_point_copy(theta, x);
+        } else
+          oscats_point_copy(x, theta);
+      }
+  } while (improved);
+
+  return fail;
+}
+
+// Mode over the discrete dimensions of the likelihood (or, if map, of the
+// posterior with the Dprior) by enumerating every pattern in Gray-code
+// order.  If refit, the continuous dimensions are re-estimated for each
+// pattern (NR for the MLE, EAP for the MAP).  Otherwise they are held at
+// their values in theta, and only the items loading on the dimension that
+// changed are re-evaluated at each step.
+// Returns TRUE if the refit fails to converge.
+static gboolean discrete_mode(OscatsExaminee *e, OscatsPoint *theta,
+                              OscatsAlgEstimate *self, gboolean map,
+                              gboolean refit)
+{
+  OscatsPoint *x = self->x;
+  OscatsModel **models = NULL;
+  gdouble *logP = NULL, *prior = NULL;
+  gdouble max = -G_MAXDOUBLE, L;
+  guint N, num = e->items->len, i, k, c = 0;
+  gboolean fail = FALSE;
+  OscatsDim dim;
+
+  N = oscats_space_num_patterns(theta->space);
+  if (N == 0 || N > MAX_CLASSES)
+    return discrete_climb(e, theta, self, map, refit);
+
+  if (map && self->Dprior)
+  {
+    if (self->Dprior->v->size == N)
+      prior = self->Dprior->v->data;
+    else
+      g_warning("Dprior has length %d, but there are %d patterns.  "
+                "Using uniform prior.", (gint)self->Dprior->v->size, N);
+  }
+
+  oscats_point_copy(x, theta);
+  oscats_point_first_pattern(x);
+  if (!refit)
+  {
+    models = g_new(OscatsModel*, num);
+    logP = g_new(gdouble, num);
+    for (i=0; i < num; i++)
+    {
+      models[i] = oscats_administrand_get_model(
+                    g_ptr_array_index(e->items, i), self->modelKey);
+      logP[i] = log(oscats_model_P(models[i], e->resp->data[i], x,
+                                   e->covariates));
+    }
+  }
+
+  for (k=0; k < N; k++)
+  {
+    if (k > 0)
+    {
+      dim = oscats_point_next_pattern(x, k, &c);
+      if (!refit)
+        for (i=0; i < num; i++)
+          if (model_uses_dim(models[i], dim))
+            logP[i] = log(oscats_model_P(models[i], e->resp->data[i], x,
+                                         e->covariates));
+    }
+    if (refit)
+    {
+      if (pattern_score(e, self, map, refit, &L))
+      {
+        fail = TRUE;
+        break;
+      }
+    } else
+      for (L=0, i=0; i < num; i++) L += logP[i];
+    if (prior) L += log(prior[c*self->Dprior->v->stride]);
+    if (L > max)
+    {
+      max = L;
+      oscats_point_copy(theta, x);
+    }
+  }
+
+  g_free(logP);
+  g_free(models);
+  return fail;
+}
+
 // EAP over continuous dimensions, MAP over discrete dimensions
 static void MAP(OscatsExaminee *e, OscatsPoint *theta, OscatsAlgEstimate *alg_data)
 {
@@ -561,67 +1434,28 @@ static void MAP(OscatsExaminee *e, OscatsPoint *theta, OscatsAlgEstimate *alg_da
   guint numBin = theta->space->num_bin;
   guint numNat = theta->space->num_nat;
   gboolean haveDiscr = (numBin + numNat > 0);
-  OscatsNatural i, junk=0, *dimMax;
-  gdouble max = -G_MAXDOUBLE, L;
-  guint I, J;
 
   oscats_point_copy(x, theta);
   if (numCont > 0 && (alg_data->independent || !haveDiscr))
   {
     EAP(alg_data);
-    if (!haveDiscr)
-    {
-      oscats_point_copy(theta, x);
-      return;
-    }
+    oscats_point_copy(theta, x);
+    if (!haveDiscr) return;
   }
   
   g_return_if_fail(haveDiscr);
 
-  if (numNat > 0) dimMax = theta->space->max;
-  else  // Fake a natural dimension
-  {
-    numNat = 1;
-    dimMax = &junk;
-  }
-  
-  for (I=0; I < numNat; I++)            // natural dimension
-    for (i=0; i <= dimMax[I]; i++)         // value of this natural dimension
-    {
-      if (theta->nat) theta->nat[I] = i;
-      if (numBin == 0)
-      {
-        if (!alg_data->independent && numCont > 0) EAP(alg_data);
-        L = oscats_examinee_logLik(e, x, alg_data->modelKey);
-        if (L > max)
-        {
-          max = L;
-          oscats_point_copy(theta, x);
-        }
-      } else
-        for (J=0; J < numBin; J++)      // binary dimension
-        {
-          // binary dim == 0
-          g_bit_array_clear_bit(x->bin, J);
-          if (!alg_data->independent && numCont > 0) EAP(alg_data);
-          L = oscats_examinee_logLik(e, x, alg_data->modelKey);
-          if (L > max)
-          {
-            max = L;
-            oscats_point_copy(theta, x);
-          }
-          
-          // binary dim == 1
-          g_bit_array_set_bit(x->bin, J);
-          if (!alg_data->independent && numCont > 0) EAP(alg_data);
-          L = oscats_examinee_logLik(e, x, alg_data->modelKey);
-          if (L > max)
-          {
-            max = L;
-            oscats_point_copy(theta, x);
-          }
-        }
-    }
+  discrete_mode(e, theta, alg_data, TRUE,
+                !alg_data->independent && numCont > 0);
+}
+
+// Starts a new cached log-likelihood for e
+static void initialize (OscatsTest *test, OscatsExaminee *e, gpointer alg_data)
+{
+  OscatsAlgEstimate *self = OSCATS_ALG_ESTIMATE(alg_data);
+  if (self->loglik) gsl_vector_set_zero(self->loglik);
+  self->post_e = e;
+  self->post_num = 0;
 }
 
 // FIXME: This isn't quite right for multidimensional tests
@@ -640,25 +1474,39 @@ static void administered (OscatsTest *test, OscatsExaminee *e,
   {
     if (self->x) g_object_unref(self->x);
     self->x = oscats_point_new_from_space(theta->space);
+    clear_grid(self);
     if (dims > 0)
     {
-      oscats_integrate_set_c_function(self->integrator, dims, eap_integrand);
-      oscats_integrate_set_c_function(self->normalizer, dims, norm_integrand);
-      oscats_integrate_link_point(self->integrator, self->x);
-      oscats_integrate_link_point(self->normalizer, self->x);
-      if (self->tmp == NULL || self->tmp->size != dims)
+      if (theta->space->num_bin == 0 && theta->space->num_nat == 0)
       {
-        if (self->tmp) gsl_vector_free(self->tmp);
-        if (self->tmp2) gsl_vector_free(self->tmp2);
-        self->tmp = gsl_vector_alloc(dims);
-        self->tmp2 = gsl_vector_alloc(dims);
+        oscats_integrate_set_c_batch_function(self->integrator, dims,
+                                              eap_batch);
+        oscats_integrate_set_c_batch_function(self->normalizer, dims,
+                                              norm_batch);
+      } else {
+        oscats_integrate_set_c_function(self->integrator, dims,
+                                        eap_integrand);
+        oscats_integrate_set_c_function(self->normalizer, dims,
+                                        norm_integrand);
       }
     }
   }
 
+  if (dims > 0 && !self->quad_nodes &&
+      (self->quad_points > 0 || self->user_nodes || self->user_weights))
+    g_return_if_fail(build_grid(self, dims));
+  if (dims == 0 && self->num_classes == 0 && !self->quad_logw)
+    build_classes(self, theta->space);
+
   if (e->items->len == 0) return;  // First item wasn't recorded
   self->e = e;
 
+  if (update_loglik(self, e) && self->num_classes > 0)
+  {
+    mode_classes(self, theta, self->eap || e->items->len <= self->Nposterior);
+    return;
+  }
+
   if (self->eap || e->items->len <= self->Nposterior)
   {
     MAP(e, theta, self);
@@ -695,6 +1543,66 @@ static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test)
 {
 //  OscatsAlgEstimate *self = OSCATS_ALG_ESTIMATE(alg_data);
 
-  g_signal_connect_data(test, "administered", G_CALLBACK(administered),
-                        alg_data, oscats_algorithm_closure_finalize, 0);
+  oscats_test_connect_native(test, "administered", G_CALLBACK(administered),
+                             alg_data, oscats_algorithm_closure_finalize);
+  oscats_test_connect_native(test, "initialize", G_CALLBACK(initialize),
+                             alg_data, oscats_algorithm_closure_finalize);
+  g_object_ref(alg_data);
+}
+
+/**
+ * oscats_alg_estimate_get_variance:
+ * @alg_data: the #OscatsAlgEstimate data object
+ *
+ * The posterior covariance matrix for the continuous dimensions is
+ * computed along with the EAP when a fixed quadrature grid is used [see
+ * #OscatsAlgEstimate:quad-points and #OscatsAlgEstimate:quad-nodes].  The
+ * value refers to the most recent update and is overwritten by the next.
+ *
+ * Returns: (transfer none): the posterior covariance matrix, or %NULL if
+ * no fixed-grid EAP has been computed
+ */
+GGslMatrix * oscats_alg_estimate_get_variance(OscatsAlgEstimate *alg_data)
+{
+  g_return_val_if_fail(OSCATS_IS_ALG_ESTIMATE(alg_data), NULL);
+  return alg_data->var;
+}
+
+/**
+ * oscats_alg_estimate_get_posterior:
+ * @alg_data: the #OscatsAlgEstimate data object
+ *
+ * The estimator keeps the log-likelihood of the current examinee's
+ * responses at each node of the fixed quadrature grid (for purely
+ * continuous spaces, see #OscatsAlgEstimate:quad-points) or at each latent
+ * class (for purely discrete spaces), adding one item per update.  This
+ * function returns the corresponding normalized posterior weights.  For
+ * the generated grid, the first dimension varies fastest; user-supplied
+ * nodes are in the order of the rows of #OscatsAlgEstimate:quad-nodes;
+ * latent classes are ordered as in #OscatsAlgEstimate:Dprior.  The vector
+ * is overwritten by the next call.
+ *
+ * Returns: (transfer none): the posterior weights, or %NULL if there is
+ * no cached posterior
+ */
+GGslVector * oscats_alg_estimate_get_posterior(OscatsAlgEstimate *alg_data)
+{
+  gdouble max = -G_MAXDOUBLE, sum = 0, *w;
+  guint g, G;
+  g_return_val_if_fail(OSCATS_IS_ALG_ESTIMATE(alg_data), NULL);
+  if (!alg_data->loglik) return NULL;
+  G = alg_data->loglik->size;
+  if (!alg_data->posterior) alg_data->posterior = g_gsl_vector_new(G);
+  w = alg_data->posterior->v->data;
+  for (g=0; g < G; g++)
+  {
+    w[g] = gsl_vector_get(alg_data->quad_logw, g) +
+           gsl_vector_get(alg_data->loglik, g);
+    if (w[g] > max) max = w[g];
+  }
+  for (g=0; g < G; g++)
+    sum += (w[g] = exp(w[g] - max));
+  for (g=0; g < G; g++)
+    w[g] /= sum;
+  return alg_data->posterior;
 }
@@ -53,10 +53,32 @@ struct _OscatsAlgEstimate {
   OscatsExaminee *e;
   // Working space
   OscatsIntegrate *integrator, *normalizer;
+  OscatsIntegrateMethod integ_method;
+  guint integ_size;
+  guint64 integ_seed;
   OscatsPoint *x;
-  gsl_vector *tmp, *tmp2;
   gint flag;
   guint dim;
+  gdouble *batch_buf;		// node block for the batch integrands
+  guint batch_size;
+  // Fixed quadrature grid (continuous dimensions)
+  guint quad_points;
+  gboolean quad_rect;
+  gsl_matrix *user_nodes, *quad_nodes;
+  gsl_vector *user_weights, *quad_logw, *post;
+  GGslMatrix *var;
+  // Log-likelihood over the grid nodes or latent classes, updated one item
+  // at a time.  post_e is held without reference.
+  OscatsExaminee *post_e;
+  guint post_num, num_classes;
+  gsl_vector *loglik;
+  GGslVector *posterior;
+  // Newton-Raphson workspace
+  gboolean scoring;
+  GGslVector *nr_grad, *nr_delta;
+  GGslMatrix *nr_hes;
+  GGslPermutation *nr_perm;
+  gdouble *nr_start;
 };
 
 struct _OscatsAlgEstimateClass {
@@ -65,5 +87,8 @@ struct _OscatsAlgEstimateClass {
 
 GType oscats_alg_estimate_get_type();
 
+GGslMatrix * oscats_alg_estimate_get_variance(OscatsAlgEstimate *alg_data);
+GGslVector * oscats_alg_estimate_get_posterior(OscatsAlgEstimate *alg_data);
+
 G_END_DECLS
 #endif
@@ -24,6 +24,7 @@ G_DEFINE_TYPE(OscatsAlgExposureCounter, oscats_alg_exposure_counter, OSCATS_TYPE
 static void oscats_alg_exposure_counter_constructed (GObject *object);
 static void oscats_alg_exposure_counter_dispose (GObject *object);
 static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test);
+static void alg_merge (OscatsAlgorithm *alg_data, OscatsAlgorithm *other);
 
 static void oscats_alg_exposure_counter_class_init (OscatsAlgExposureCounterClass *klass)
 {
@@ -33,6 +34,7 @@ static void oscats_alg_exposure_counter_class_init (OscatsAlgExposureCounterClas
   gobject_class->dispose = oscats_alg_exposure_counter_dispose;
 
   OSCATS_ALGORITHM_CLASS(klass)->reg = alg_register;
+  OSCATS_ALGORITHM_CLASS(klass)->merge = alg_merge;
 }
 
 static void oscats_alg_exposure_counter_init (OscatsAlgExposureCounter *self)
@@ -78,13 +80,28 @@ static void administered (OscatsTest *test, OscatsExaminee *e,
  */
 static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test)
 {
-  g_signal_connect_data(test, "initialize", G_CALLBACK(initialize),
-                        alg_data, oscats_algorithm_closure_finalize, 0);
-  g_signal_connect_data(test, "administered", G_CALLBACK(administered),
-                        alg_data, oscats_algorithm_closure_finalize, 0);
+  oscats_test_connect_native(test, "initialize", G_CALLBACK(initialize),
+                             alg_data, oscats_algorithm_closure_finalize);
+  oscats_test_connect_native(test, "administered", G_CALLBACK(administered),
+                             alg_data, oscats_algorithm_closure_finalize);
   g_object_ref(alg_data);
 }
 
+static void merge_count(gpointer item, gpointer count, gpointer counts)
+{
+  guint total = GPOINTER_TO_UINT(g_hash_table_lookup(counts, item));
+  g_hash_table_insert(counts, item,
+                      GUINT_TO_POINTER(total + GPOINTER_TO_UINT(count)));
+}
+
+static void alg_merge (OscatsAlgorithm *alg_data, OscatsAlgorithm *other)
+{
+  OscatsAlgExposureCounter *self = OSCATS_ALG_EXPOSURE_COUNTER(alg_data);
+  OscatsAlgExposureCounter *rhs = OSCATS_ALG_EXPOSURE_COUNTER(other);
+  self->num_examinees += rhs->num_examinees;
+  g_hash_table_foreach(rhs->counts, merge_count, self->counts);
+}
+
 /**
  * oscats_alg_exposure_counter_num_examinees:
  * @alg_data: the #OscatsAlgExposureCounter data object
@@ -112,7 +112,7 @@ static gboolean stopcrit (OscatsTest *test, OscatsExaminee *e,
  */
 static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test)
 {
-  g_signal_connect_data(test, "stopcrit", G_CALLBACK(stopcrit),
-                        alg_data, oscats_algorithm_closure_finalize, 0);
+  oscats_test_connect_native(test, "stopcrit", G_CALLBACK(stopcrit),
+                             alg_data, oscats_algorithm_closure_finalize);
 }
 
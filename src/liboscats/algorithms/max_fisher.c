@@ -26,6 +26,10 @@ enum {
   PROP_TYPE,
   PROP_MODEL_KEY,
   PROP_THETA_KEY,
+  PROP_TABLE_POINTS,
+  PROP_TABLE_MIN,
+  PROP_TABLE_MAX,
+  PROP_RNG,
 };
 
 G_DEFINE_TYPE(OscatsAlgMaxFisher, oscats_alg_max_fisher, OSCATS_TYPE_ALGORITHM);
@@ -131,10 +135,136 @@ static void oscats_alg_max_fisher_class_init (OscatsAlgMaxFisherClass *klass)
                             G_PARAM_STATIC_BLURB);
   g_object_class_install_property(gobject_class, PROP_THETA_KEY, pspec);
 
+/**
+ * OscatsAlgMaxFisher:table-points:
+ *
+ * Number of grid points for a precomputed item information table.  If
+ * positive, and every item in the bank has a unidimensional continuous
+ * model without covariates, the information of each item is tabulated
+ * over #OscatsAlgMaxFisher:table-points equally spaced points from
+ * #OscatsAlgMaxFisher:table-min to #OscatsAlgMaxFisher:table-max when the
+ * algorithm is registered, and selection uses linear interpolation in the
+ * table.  Outside of this range, the information is calculated exactly.
+ * Zero (the default) disables the table.
+ */
+  pspec = g_param_spec_uint("table-points", "table points", 
+                            "Number of points in information table",
+                            0, G_MAXUINT, 0,
+                            G_PARAM_READWRITE |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_TABLE_POINTS, pspec);
+
+/**
+ * OscatsAlgMaxFisher:table-min:
+ *
+ * Lower end of the information table grid.
+ */
+  pspec = g_param_spec_double("table-min", "table minimum", 
+                              "Lower end of information table",
+                              -G_MAXDOUBLE, G_MAXDOUBLE, -4,
+                              G_PARAM_READWRITE |
+                              G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                              G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_TABLE_MIN, pspec);
+
+/**
+ * OscatsAlgMaxFisher:table-max:
+ *
+ * Upper end of the information table grid.
+ */
+  pspec = g_param_spec_double("table-max", "table maximum", 
+                              "Upper end of information table",
+                              -G_MAXDOUBLE, G_MAXDOUBLE, 4,
+                              G_PARAM_READWRITE |
+                              G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                              G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_TABLE_MAX, pspec);
+
+/**
+ * OscatsAlgMaxFisher:rng:
+ *
+ * The random number generator used to choose among the
+ * #OscatsAlgMaxFisher:num best items.  If %NULL, the library-wide generator
+ * is used.  Otherwise, each examinee's choices are made with a substream
+ * of @rng determined by the examinee's id
+ * [see oscats_algorithm_examinee_rng()].  The choices are reproducible
+ * between runs only if the examinees are given explicit ids.
+ */
+  pspec = g_param_spec_object("rng", "Random number generator", 
+                            "Generator for choosing among the best items",
+                            OSCATS_TYPE_RNG,
+                            G_PARAM_READWRITE |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_RNG, pspec);
+
 }
 
 static void oscats_alg_max_fisher_init (OscatsAlgMaxFisher *self)
 {
+  self->table_min = -4;
+  self->table_max = 4;
+}
+
+static void clear_table(OscatsAlgMaxFisher *self)
+{
+  g_free(self->table);
+  g_free(self->values);
+  self->table = self->values = NULL;
+  self->table_num = 0;
+}
+
+// Tabulates item information over the theta grid.  Leaves the table empty
+// if the bank is not unidimensional.
+static void build_table(OscatsAlgMaxFisher *self)
+{
+  GPtrArray *items = self->chooser->bank->items;
+  guint num = items->len, P = self->table_points, i, k;
+  OscatsModel *model;
+  OscatsPoint *theta = NULL;
+  GGslMatrix *I;
+
+  clear_table(self);
+  if (P < 2 || num == 0) return;
+  g_return_if_fail(self->table_min < self->table_max);
+  for (i=0; i < num; i++)
+  {
+    model = oscats_administrand_get_model(g_ptr_array_index(items, i),
+                                          self->modelKey);
+    g_return_if_fail(model != NULL && OSCATS_IS_SPACE(model->space));
+    if (model->space->num_cont != 1 || model->space->num_bin > 0 ||
+        model->space->num_nat > 0 || model->Ncov > 0)
+    {
+      g_warning("OscatsAlgMaxFisher: Item bank is not unidimensional.  Information table disabled.");
+      return;
+    }
+  }
+
+  self->table = g_new(gdouble, P*num);
+  self->values = g_new(gdouble, num);
+  self->table_num = num;
+  I = g_gsl_matrix_new(1, 1);
+  for (i=0; i < num; i++)
+  {
+    model = oscats_administrand_get_model(g_ptr_array_index(items, i),
+                                          self->modelKey);
+    if (theta == NULL || !oscats_space_compatible(theta->space, model->space))
+    {
+      if (theta) g_object_unref(theta);
+      theta = oscats_point_new_from_space(model->space);
+    }
+    for (k=0; k < P; k++)
+    {
+      theta->cont[0] = self->table_min +
+                       (self->table_max - self->table_min) * k / (P-1);
+      I->v->data[0] = 0;
+      oscats_model_fisher_inf(model, theta, NULL, I);
+      self->table[k*num+i] = I->v->data[0];
+    }
+  }
+  g_object_unref(I);
+  if (theta) g_object_unref(theta);
 }
 
 static void oscats_alg_max_fisher_dispose (GObject *object)
@@ -142,11 +272,15 @@ static void oscats_alg_max_fisher_dispose (GObject *object)
   OscatsAlgMaxFisher *self = OSCATS_ALG_MAX_FISHER(object);
   G_OBJECT_CLASS(oscats_alg_max_fisher_parent_class)->dispose(object);
   if (self->chooser) g_object_unref(self->chooser);
+  if (self->rng) g_object_unref(self->rng);
+  if (self->stream) g_object_unref(self->stream);
   if (self->base) g_object_unref(self->base);
   if (self->work) g_object_unref(self->work);
   if (self->inv) g_object_unref(self->inv);
   if (self->perm) g_object_unref(self->perm);
+  clear_table(self);
   self->chooser = NULL;
+  self->rng = self->stream = NULL;
   self->base = self->work = self->inv = NULL;
   self->perm = NULL;
 }
@@ -182,6 +316,23 @@ static void oscats_alg_max_fisher_set_property(GObject *object,
     }
       break;
     
+    case PROP_TABLE_POINTS:
+      self->table_points = g_value_get_uint(value);
+      break;
+    
+    case PROP_TABLE_MIN:
+      self->table_min = g_value_get_double(value);
+      break;
+    
+    case PROP_TABLE_MAX:
+      self->table_max = g_value_get_double(value);
+      break;
+    
+    case PROP_RNG:
+      if (self->rng) g_object_unref(self->rng);
+      self->rng = g_value_dup_object(value);
+      break;
+    
     default:
       // Unknown property
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -213,6 +364,22 @@ static void oscats_alg_max_fisher_get_property(GObject *object,
                          g_quark_to_string(self->thetaKey) : "");
       break;
     
+    case PROP_TABLE_POINTS:
+      g_value_set_uint(value, self->table_points);
+      break;
+    
+    case PROP_TABLE_MIN:
+      g_value_set_double(value, self->table_min);
+      break;
+    
+    case PROP_TABLE_MAX:
+      g_value_set_double(value, self->table_max);
+      break;
+    
+    case PROP_RNG:
+      g_value_set_object(value, self->rng);
+      break;
+    
     default:
       // Unknown property
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -225,6 +392,12 @@ static void initialize(OscatsTest *test, OscatsExaminee *e, gpointer alg_data)
   OscatsAlgMaxFisher *self = OSCATS_ALG_MAX_FISHER(alg_data);
   if (self->base) g_gsl_matrix_set_all(self->base, 0);
   self->base_num = 0;
+  if (self->rng)
+  {
+    self->stream = oscats_algorithm_examinee_rng(alg_data, self->rng,
+                                                 self->stream, e);
+    self->chooser->rng = self->stream;
+  }
 }
 
 // This value will be minimized
@@ -279,6 +452,25 @@ static gint select (OscatsTest *test, OscatsExaminee *e,
         oscats_administrand_get_model(g_ptr_array_index(e->items, self->base_num), self->modelKey),
         self->theta, e->covariates, self->base);
 
+  if (self->table && self->theta->space->num_cont == 1 &&
+      self->table_num == eligible->bit_len)
+  {
+    gdouble x = (self->theta->cont[0] - self->table_min) /
+                (self->table_max - self->table_min) * (self->table_points-1);
+    if (x >= 0 && x <= self->table_points-1)
+    {
+      // Interpolate between two rows of the table, for the whole bank
+      guint num = self->table_num, i;
+      guint k = (x < self->table_points-1 ? (guint)x : self->table_points-2);
+      gdouble f = x - k;
+      const gdouble *I0 = self->table + k*num, *I1 = I0 + num;
+      for (i=0; i < num; i++)
+        self->values[i] = -((1-f)*I0[i] + f*I1[i]);
+      return oscats_alg_chooser_choose_values(self->chooser, eligible,
+                                              self->values);
+    }
+  }
+
   return oscats_alg_chooser_choose(self->chooser, e, eligible, alg_data);
 }
 
@@ -295,11 +487,12 @@ static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test)
 
   self->chooser->bank = g_object_ref(test->itembank);
   self->chooser->criterion = criterion;
+  build_table(self);
 
-  g_signal_connect_data(test, "initialize", G_CALLBACK(initialize),
-                        alg_data, oscats_algorithm_closure_finalize, 0);
-  g_signal_connect_data(test, "select", G_CALLBACK(select),
-                        alg_data, oscats_algorithm_closure_finalize, 0);
+  oscats_test_connect_native(test, "initialize", G_CALLBACK(initialize),
+                             alg_data, oscats_algorithm_closure_finalize);
+  oscats_test_connect_native(test, "select", G_CALLBACK(select),
+                             alg_data, oscats_algorithm_closure_finalize);
   g_object_ref(alg_data);
 }
                    
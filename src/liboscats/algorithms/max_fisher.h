@@ -97,11 +97,18 @@ struct _OscatsAlgMaxFisher {
   gboolean A_opt;
   /*< private >*/
   OscatsAlgChooser *chooser;
+  OscatsRng *rng, *stream;
   guint base_num, dim;
   GQuark modelKey, thetaKey;
   OscatsPoint *theta;			// temporary value for criterion
   GGslMatrix *base, *work, *inv;
   GGslPermutation *perm;
+  // Information lookup table for unidimensional banks
+  guint table_points;
+  gdouble table_min, table_max;
+  gdouble *table;			// table_points x number of items
+  guint table_num;			// number of items in table
+  gdouble *values;			// criterion for each item
 };
 
 struct _OscatsAlgMaxFisherClass {
@@ -21,9 +21,10 @@
  *   Set e, Reset base_num, Inf.
  * select():
  *   Set theta_hat
- *   Call chooser(), which calls criterion() for each eligligble item.
+ *   Call chooser(), which calls criterion() for each eligligble item,
+ *   possibly from several threads, each with its own Workspace.
  * criterion():
- *   Set model, max, p, p_sum
+ *   Set the workspace's model, max, p, p_sum
  *   If continuous, call integrator, which calls integrand().
  *   otherwise, call sum().
  * integrand():
@@ -32,11 +33,23 @@
  *   call summand() and tack on a discrete prior, if necessary.
  * summand():
  *   returns KL(theta_hat || theta) { Prod_i P_i(x_i|theta) }
+ * likelihood():
+ *   returns Prod_i P_i(x_i|theta), which does not depend on the candidate
+ *   item, so it is cached by theta for the current selection in a fixed
+ *   table in the workspace.
+ *
+ * grid_values():
+ *   Used instead of criterion() when the grid tables are in use.  select()
+ *   sets quadrature weights for the grid points in the integration region,
+ *   and the KL index of each eligible item is a weighted sum of tabulated
+ *   log probabilities.
  *
  * Currently, the prior has discrete and continuous dimensions as independent,
  * but this restriction will be removed in the future.
  */
 
+#include <math.h>
+#include <string.h>
 #include <gsl/gsl_blas.h>
 #include <gsl/gsl_linalg.h>
 #include "random.h"
@@ -54,8 +67,50 @@ enum {
   PROP_DPRIOR,
   PROP_MODEL_KEY,
   PROP_THETA_KEY,
+  PROP_RNG,
+  PROP_THREADS,
+  PROP_GRID_POINTS,
+  PROP_GRID_MIN,
+  PROP_GRID_MAX,
+  PROP_INTEGRATE_METHOD,
+  PROP_INTEGRATE_SIZE,
+  PROP_INTEGRATE_SEED,
 };
 
+// Relative quadrature weight below which a grid point is skipped
+#define MIN_WEIGHT 1e-12
+
+// Slots in each workspace's likelihood cache (a power of 2).  Once half of
+// them are used in a selection, further nodes are not cached.
+#define CACHE_SIZE 4096
+
+// Scratch space for evaluating the criterion in one thread
+typedef struct {
+  OscatsAlgMaxKl *self;
+  OscatsModel *model;
+  OscatsResponse max;
+  OscatsPoint *theta;
+  gdouble p_sum, *p;
+  guint p_num;
+  OscatsIntegrate *integrator;
+  // Likelihood at each node (and discrete pattern), for posterior
+  gdouble *cache_x, *cache_L;	// cache_x has num_cont coordinates per slot
+  guint *cache_pattern, *cache_step;	// slot is in use if cache_step == step
+  guint cache_n, cache_num, step;
+  gdouble *block;		// for integrand_batch()
+  guint block_size;
+} Workspace;
+
+// First cache slot to probe for a node
+static guint cache_slot(const gdouble *x, guint n, guint pattern)
+{
+  const guchar *b = (const guchar*)x;
+  guint h = 2166136261u ^ pattern, i;
+  for (i=0; i < n*sizeof(gdouble); i++)
+    h = (h ^ b[i]) * 16777619u;
+  return h & (CACHE_SIZE-1);
+}
+
 G_DEFINE_TYPE(OscatsAlgMaxKl, oscats_alg_max_kl, OSCATS_TYPE_ALGORITHM);
 
 static void oscats_alg_max_kl_dispose(GObject *object);
@@ -65,7 +120,64 @@ static void oscats_alg_max_kl_set_property(GObject *object,
 static void oscats_alg_max_kl_get_property(GObject *object,
               guint prop_id, GValue *value, GParamSpec *pspec);
 static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test);
-static gdouble integrand(const GGslVector *theta, gpointer data);
+static gdouble integrand(const GGslVector *x, gpointer data);
+static void integrand_batch(guint n, const gdouble *x, gdouble *f,
+                            gpointer data);
+
+static gpointer workspace_new(gpointer data)
+{
+  OscatsAlgMaxKl *self = OSCATS_ALG_MAX_KL(data);
+  Workspace *ws = g_new0(Workspace, 1);
+  guint num_cont = self->space->num_cont;
+  ws->self = self;
+  ws->theta = oscats_point_new_from_space(self->space);
+  if (self->posterior)
+  {
+    ws->cache_n = num_cont;
+    ws->cache_x = g_new(gdouble, CACHE_SIZE*(num_cont > 0 ? num_cont : 1));
+    ws->cache_L = g_new(gdouble, CACHE_SIZE);
+    ws->cache_pattern = g_new(guint, CACHE_SIZE);
+    ws->cache_step = g_new0(guint, CACHE_SIZE);
+  }
+  if (num_cont > 0)
+  {
+    ws->integrator = g_object_new(OSCATS_TYPE_INTEGRATE, NULL);
+    if (self->numPatterns == 0)
+      oscats_integrate_set_c_batch_function(ws->integrator, num_cont,
+                                            integrand_batch);
+    else
+      oscats_integrate_set_c_function(ws->integrator, num_cont, integrand);
+    // The posterior integrand sets theta from the whitened variable
+    if (!self->posterior)
+      oscats_integrate_link_point(ws->integrator, ws->theta);
+    if (self->integ_method != OSCATS_INTEGRATE_ADAPTIVE)
+    {
+      // Same points in every workspace
+      OscatsRng *rng = ( self->rng ?
+        oscats_rng_substream(self->rng,
+                             oscats_rng_hash_string("integrate-seed")) :
+        oscats_rng_new(self->integ_seed) );
+      oscats_integrate_set_method(ws->integrator, self->integ_method,
+                                  self->integ_size, rng);
+      g_object_unref(rng);
+    }
+  }
+  return ws;
+}
+
+static void workspace_free(gpointer data)
+{
+  Workspace *ws = (Workspace*)data;
+  g_object_unref(ws->theta);
+  if (ws->integrator) g_object_unref(ws->integrator);
+  g_free(ws->cache_x);
+  g_free(ws->cache_L);
+  g_free(ws->cache_pattern);
+  g_free(ws->cache_step);
+  g_free(ws->p);
+  g_free(ws->block);
+  g_free(ws);
+}
 
 static gboolean alloc_workspace(OscatsAlgMaxKl *self, OscatsSpace *space)
 {
@@ -81,27 +193,15 @@ static gboolean alloc_workspace(OscatsAlgMaxKl *self, OscatsSpace *space)
   if (space->num_bin + space->num_nat == 0)
     self->numPatterns = 0;
   else
-    self->numPatterns = 1;
-  if (space->num_bin > 0)
-  {
-    g_return_val_if_fail(space->num_bin < sizeof(guint)*8, FALSE);
-    self->numPatterns = (1 << space->num_bin);
-  }
-  for (i=0; i < space->num_nat; i++)
   {
-    g_return_val_if_fail(self->numPatterns < G_MAXUINT/(space->max[i]+1), FALSE);
-    self->numPatterns *= (space->max[i]+1);
+    self->numPatterns = oscats_space_num_patterns(space);
+    g_return_val_if_fail(self->numPatterns > 0, FALSE);
   }
 
-  if (self->theta) g_object_unref(self->theta);
-  if (self->tmp) gsl_vector_free(self->tmp);
-  if (self->tmp2) gsl_vector_free(self->tmp2);
   if (self->Inf) g_object_unref(self->Inf);
   if (self->Inf_inv) g_object_unref(self->Inf_inv);
-  self->tmp = self->tmp2 = NULL;
-  self->Inf = self->Inf_inv = NULL;
-
-  self->theta = oscats_point_new_from_space(space);
+  if (self->Inf_half) g_object_unref(self->Inf_half);
+  self->Inf = self->Inf_inv = self->Inf_half = NULL;
 
   if (num_cont > 0)
   {
@@ -112,20 +212,21 @@ static gboolean alloc_workspace(OscatsAlgMaxKl *self, OscatsSpace *space)
       if (self->Sigma_half)
         g_return_val_if_fail(self->Sigma_half->size1 == num_cont &&
                              self->Sigma_half->size2 == num_cont, FALSE);
-      self->tmp = gsl_vector_alloc(num_cont);
-      self->tmp2 = gsl_vector_alloc(num_cont);
     } else if (self->inf_bounds) {
       self->Inf = g_gsl_matrix_new(num_cont, num_cont);
       self->Inf_inv = g_gsl_matrix_new(num_cont, num_cont);
+      self->Inf_half = g_gsl_matrix_new(num_cont, num_cont);
     }
-    oscats_integrate_set_c_function(self->integrator, num_cont, integrand);
-    oscats_integrate_link_point(self->integrator, self->theta);
   }
 
   if (self->space) g_object_unref(self->space);
   self->space = space;
   g_object_ref(space);
 
+  // Discard workspaces for the old space
+  oscats_alg_chooser_set_workspace(self->chooser, workspace_new,
+                                   workspace_free);
+
   return TRUE;
 }
 
@@ -174,7 +275,9 @@ static void oscats_alg_max_kl_class_init (OscatsAlgMaxKlClass *klass)
  * OscatsAlgMaxKl:posterior:
  *
  * If true, use posterior-weighted KL index.  (Note: if true, 
- * #OscatsAlgMaxKl:inf-bounds is ignored.)
+ * #OscatsAlgMaxKl:inf-bounds is ignored.)  The likelihood of the
+ * examinee's responses is computed once per integration node in each
+ * selection and reused for every candidate item.
  */
   pspec = g_param_spec_boolean("posterior", "Posterior-weighted", 
                                "Use posterior-weighted KL index",
@@ -271,11 +374,284 @@ static void oscats_alg_max_kl_class_init (OscatsAlgMaxKlClass *klass)
                             G_PARAM_STATIC_BLURB);
   g_object_class_install_property(gobject_class, PROP_THETA_KEY, pspec);
 
+/**
+ * OscatsAlgMaxKl:rng:
+ *
+ * The random number generator used to choose among the
+ * #OscatsAlgMaxKl:num best items.  If %NULL, the library-wide generator
+ * is used.  Otherwise, each examinee's choices are made with a substream
+ * of @rng determined by the examinee's id
+ * [see oscats_algorithm_examinee_rng()].  The choices are reproducible
+ * between runs only if the examinees are given explicit ids.
+ */
+  pspec = g_param_spec_object("rng", "Random number generator", 
+                            "Generator for choosing among the best items",
+                            OSCATS_TYPE_RNG,
+                            G_PARAM_READWRITE |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_RNG, pspec);
+
+/**
+ * OscatsAlgMaxKl:threads:
+ *
+ * Number of threads used to compute the KL index of the eligible items
+ * [see #OscatsAlgChooser:threads].  The selected item does not depend on
+ * the number of threads.
+ */
+  pspec = g_param_spec_uint("threads", "Threads",
+                            "Number of threads for computing the KL index",
+                            1, 1024, 1,
+                            G_PARAM_READWRITE |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_THREADS, pspec);
+
+/**
+ * OscatsAlgMaxKl:grid-points:
+ *
+ * Number of equally spaced points from #OscatsAlgMaxKl:grid-min to
+ * #OscatsAlgMaxKl:grid-max at which each item's log probabilities are
+ * tabulated.  If positive, and every item in the bank has a
+ * unidimensional continuous model without covariates, the KL index is
+ * integrated with fixed weights on this grid (interpolating linearly
+ * between grid points) instead of by adaptive quadrature.  The
+ * integration region is truncated to the grid.  Zero (the default)
+ * disables the grid.
+ */
+  pspec = g_param_spec_uint("grid-points", "grid points",
+                            "Number of points in KL grid",
+                            0, G_MAXUINT, 0,
+                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_GRID_POINTS, pspec);
+
+/**
+ * OscatsAlgMaxKl:grid-min:
+ *
+ * Lower end of the KL grid.
+ */
+  pspec = g_param_spec_double("grid-min", "grid minimum",
+                              "Lower end of KL grid",
+                              -G_MAXDOUBLE, G_MAXDOUBLE, -4,
+                              G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                              G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                              G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_GRID_MIN, pspec);
+
+/**
+ * OscatsAlgMaxKl:grid-max:
+ *
+ * Upper end of the KL grid.
+ */
+  pspec = g_param_spec_double("grid-max", "grid maximum",
+                              "Upper end of KL grid",
+                              -G_MAXDOUBLE, G_MAXDOUBLE, 4,
+                              G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                              G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                              G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_GRID_MAX, pspec);
+
+/**
+ * OscatsAlgMaxKl:integrate-method:
+ *
+ * The method for integrating over continuous dimensions [see
+ * oscats_integrate_set_method()].  Adaptive integration becomes
+ * impractical beyond two or three continuous dimensions; the quasi-Monte
+ * Carlo and sparse-grid methods use a fixed number of evaluations.  All
+ * items are compared with the same integration points.  Not used with
+ * #OscatsAlgMaxKl:grid-points.
+ */
+  pspec = g_param_spec_enum("integrate-method", "integration method",
+                            "Method for KL integration",
+                            OSCATS_TYPE_INTEGRATE_METHOD,
+                            OSCATS_INTEGRATE_ADAPTIVE,
+                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_INTEGRATE_METHOD, pspec);
+
+/**
+ * OscatsAlgMaxKl:integrate-size:
+ *
+ * The number of points per replicate for quasi-Monte Carlo, or the level
+ * of the sparse grid, for #OscatsAlgMaxKl:integrate-method.  Zero selects
+ * the default.
+ */
+  pspec = g_param_spec_uint("integrate-size", "integration size",
+                            "Points or level for KL integration",
+                            0, G_MAXUINT, 0,
+                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_INTEGRATE_SIZE, pspec);
+
+/**
+ * OscatsAlgMaxKl:integrate-seed:
+ *
+ * The seed of the generator for the random shifts of quasi-Monte Carlo
+ * integration.  If #OscatsAlgMaxKl:rng is set, the shifts are instead
+ * drawn from a fixed substream of it.  Either way, clones made by
+ * oscats_algorithm_clone() integrate with the same points.
+ */
+  pspec = g_param_spec_uint64("integrate-seed", "integration seed", 
+                              "Seed for quasi-Monte Carlo shifts",
+                              0, G_MAXUINT64, 0,
+                              G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                              G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                              G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_INTEGRATE_SEED, pspec);
+
 }
 
 static void oscats_alg_max_kl_init (OscatsAlgMaxKl *self)
 {
-  self->integrator = g_object_new(OSCATS_TYPE_INTEGRATE, NULL);
+}
+
+static void clear_grid(OscatsAlgMaxKl *self)
+{
+  g_free(self->grid_logP);
+  g_free(self->grid_offset);
+  g_free(self->grid_logL);
+  g_free(self->grid_w);
+  g_free(self->grid_values);
+  g_free(self->grid_active);
+  self->grid_logP = self->grid_logL = self->grid_w = NULL;
+  self->grid_values = NULL;
+  self->grid_offset = self->grid_active = NULL;
+  self->grid_num_active = 0;
+}
+
+static gdouble grid_point(const OscatsAlgMaxKl *self, guint g)
+{
+  return self->grid_min +
+         (self->grid_max - self->grid_min) * g / (self->grid_points-1);
+}
+
+// Tabulates log P_i(k|x_g) for one item
+static void grid_item(OscatsAlgMaxKl *self, guint i, OscatsModel *model)
+{
+  OscatsPoint *theta = oscats_point_new_from_space(model->space);
+  OscatsResponse k, max = oscats_model_get_max(model);
+  gdouble *logP = self->grid_logP + self->grid_offset[i];
+  guint g;
+  for (g=0; g < self->grid_points; g++)
+  {
+    theta->cont[0] = grid_point(self, g);
+    for (k=0; k <= max; k++)
+      logP[g*(max+1)+k] = log(oscats_model_P(model, k, theta, NULL));
+  }
+  g_object_unref(theta);
+}
+
+// Tabulates log P_i(k|x_g) for the items of a pack, evaluating the models
+// with at least k+1 categories in one batch per grid point.  The items
+// tabulated are marked in done.
+static void grid_pack(OscatsAlgMaxKl *self, const OscatsItemBankPack *pack,
+                      gboolean *done)
+{
+  OscatsModel **models = g_new(OscatsModel*, pack->num);
+  guint *index = g_new(guint, pack->num);
+  gdouble *P = g_new(gdouble, pack->num);
+  OscatsPoint *theta = oscats_point_new_from_space(pack->models[0]->space);
+  OscatsResponse k, max, max_all = 0;
+  guint n, m, g, i;
+
+  for (n=0; n < pack->num; n++)
+    if (oscats_space_compatible(theta->space, pack->models[n]->space))
+    {
+      max = oscats_model_get_max(pack->models[n]);
+      if (max > max_all) max_all = max;
+      done[pack->index[n]] = TRUE;
+    }
+  for (k=0; k <= max_all; k++)
+  {
+    for (n=0, m=0; n < pack->num; n++)
+      if (done[pack->index[n]] &&
+          oscats_model_get_max(pack->models[n]) >= k)
+      {
+        models[m] = pack->models[n];
+        index[m++] = pack->index[n];
+      }
+    for (g=0; g < self->grid_points; g++)
+    {
+      theta->cont[0] = grid_point(self, g);
+      oscats_model_P_batch(models, m, k, theta, NULL, P);
+      for (n=0; n < m; n++)
+      {
+        i = index[n];
+        max = (self->grid_offset[i+1] - self->grid_offset[i]) /
+              self->grid_points - 1;
+        self->grid_logP[self->grid_offset[i] + g*(max+1)+k] = log(P[n]);
+      }
+    }
+  }
+  g_object_unref(theta);
+  g_free(models);
+  g_free(index);
+  g_free(P);
+}
+
+// Tabulates log P_i(k|x_g).  Leaves the tables empty if the bank is not
+// unidimensional.  If the bank is frozen, the items are tabulated a model
+// type at a time from the bank's packs.
+static void build_grid(OscatsAlgMaxKl *self)
+{
+  OscatsItemBank *bank = self->chooser->bank;
+  GPtrArray *items = bank->items;
+  guint num = items->len, G = self->grid_points, i;
+  gboolean frozen = OSCATS_ADMINISTRAND(bank)->freeze_count > 0, *done;
+  const OscatsItemBankPack *pack;
+  OscatsModel *model;
+
+  clear_grid(self);
+  if (G < 2 || num == 0) return;
+  g_return_if_fail(self->grid_min < self->grid_max);
+  for (i=0; i < num; i++)
+  {
+    model = oscats_administrand_get_model(g_ptr_array_index(items, i),
+                                          self->modelKey);
+    g_return_if_fail(model != NULL && OSCATS_IS_SPACE(model->space));
+    if (model->space->num_cont != 1 || model->space->num_bin > 0 ||
+        model->space->num_nat > 0 || model->Ncov > 0)
+    {
+      g_warning("OscatsAlgMaxKl: Item bank is not unidimensional.  KL grid disabled.");
+      return;
+    }
+  }
+
+  self->grid_offset = g_new(guint, num+1);
+  self->grid_offset[0] = 0;
+  for (i=0; i < num; i++)
+  {
+    model = oscats_administrand_get_model(g_ptr_array_index(items, i),
+                                          self->modelKey);
+    self->grid_offset[i+1] = self->grid_offset[i] +
+                             G*(oscats_model_get_max(model)+1);
+  }
+  self->grid_logP = g_new(gdouble, self->grid_offset[num]);
+  done = g_new0(gboolean, num);
+  for (i=0; i < num; i++)
+  {
+    if (done[i]) continue;
+    model = oscats_administrand_get_model(g_ptr_array_index(items, i),
+                                          self->modelKey);
+    pack = ( frozen ? oscats_item_bank_get_pack(bank, self->modelKey,
+                                                G_TYPE_FROM_INSTANCE(model))
+                    : NULL );
+    if (pack) grid_pack(self, pack, done);
+    if (!done[i])
+    {
+      grid_item(self, i, model);
+      done[i] = TRUE;
+    }
+  }
+  g_free(done);
+  self->grid_logL = g_new0(gdouble, G);
+  self->grid_w = g_new(gdouble, G);
+  self->grid_values = g_new(gdouble, num);
+  self->grid_active = g_new(guint, G);
 }
 
 static void oscats_alg_max_kl_dispose (GObject *object)
@@ -283,19 +659,21 @@ static void oscats_alg_max_kl_dispose (GObject *object)
   OscatsAlgMaxKl *self = OSCATS_ALG_MAX_KL(object);
   G_OBJECT_CLASS(oscats_alg_max_kl_parent_class)->dispose(object);
   if (self->chooser) g_object_unref(self->chooser);
+  if (self->rng) g_object_unref(self->rng);
+  if (self->stream) g_object_unref(self->stream);
   if (self->space) g_object_unref(self->space);
   if (self->Dprior) g_object_unref(self->Dprior);
-  if (self->theta) g_object_unref(self->theta);
-  if (self->integrator) g_object_unref(self->integrator);
   if (self->Inf) g_object_unref(self->Inf);
   if (self->Inf_inv) g_object_unref(self->Inf_inv);
+  if (self->Inf_half) g_object_unref(self->Inf_half);
   self->chooser = NULL;
+  self->rng = self->stream = NULL;
   self->space = NULL;
   self->Dprior = NULL;
-  self->theta = NULL;
-  self->integrator = NULL;
   self->Inf = NULL;
   self->Inf_inv = NULL;
+  self->Inf_half = NULL;
+  clear_grid(self);
 }
 
 static void oscats_alg_max_kl_finalize (GObject *object)
@@ -303,9 +681,6 @@ static void oscats_alg_max_kl_finalize (GObject *object)
   OscatsAlgMaxKl *self = OSCATS_ALG_MAX_KL(object);
   if (self->mu) gsl_vector_free(self->mu);
   if (self->Sigma_half) gsl_matrix_free(self->Sigma_half);
-  if (self->p) g_free(self->p);
-  if (self->tmp) gsl_vector_free(self->tmp);
-  if (self->tmp2) gsl_vector_free(self->tmp2);
   G_OBJECT_CLASS(oscats_alg_max_kl_parent_class)->finalize(object);
 }
 
@@ -342,7 +717,7 @@ static void oscats_alg_max_kl_set_property(GObject *object,
           gsl_vector_free(self->mu);
           self->mu = NULL;
         }
-        if (self->mu == NULL) self->mu = gsl_vector_alloc(self->mu->size);
+        if (self->mu == NULL) self->mu = gsl_vector_alloc(mu->v->size);
         gsl_vector_memcpy(self->mu, mu->v);
       } else {
         if (self->mu) gsl_vector_free(self->mu);
@@ -370,7 +745,7 @@ static void oscats_alg_max_kl_set_property(GObject *object,
     
     case PROP_DPRIOR:
       if (self->Dprior) g_object_unref(self->Dprior);
-      self->Dprior = g_value_get_object(value);
+      self->Dprior = g_value_dup_object(value);
       break;
     
     case PROP_MODEL_KEY:
@@ -389,6 +764,39 @@ static void oscats_alg_max_kl_set_property(GObject *object,
     }
       break;
     
+    case PROP_RNG:
+      if (self->rng) g_object_unref(self->rng);
+      self->rng = g_value_dup_object(value);
+      break;
+    
+    case PROP_THREADS:
+      g_object_set(self->chooser, "threads", g_value_get_uint(value), NULL);
+      break;
+    
+    case PROP_GRID_POINTS:		// construction only
+      self->grid_points = g_value_get_uint(value);
+      break;
+    
+    case PROP_GRID_MIN:			// construction only
+      self->grid_min = g_value_get_double(value);
+      break;
+    
+    case PROP_GRID_MAX:			// construction only
+      self->grid_max = g_value_get_double(value);
+      break;
+    
+    case PROP_INTEGRATE_METHOD:		// construction only
+      self->integ_method = g_value_get_enum(value);
+      break;
+    
+    case PROP_INTEGRATE_SIZE:		// construction only
+      self->integ_size = g_value_get_uint(value);
+      break;
+    
+    case PROP_INTEGRATE_SEED:		// construction only
+      self->integ_seed = g_value_get_uint64(value);
+      break;
+    
     default:
       // Unknown property
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -461,6 +869,38 @@ static void oscats_alg_max_kl_get_property(GObject *object,
                          g_quark_to_string(self->thetaKey) : "");
       break;
     
+    case PROP_RNG:
+      g_value_set_object(value, self->rng);
+      break;
+    
+    case PROP_THREADS:
+      g_value_set_uint(value, self->chooser->threads);
+      break;
+    
+    case PROP_GRID_POINTS:
+      g_value_set_uint(value, self->grid_points);
+      break;
+    
+    case PROP_GRID_MIN:
+      g_value_set_double(value, self->grid_min);
+      break;
+    
+    case PROP_GRID_MAX:
+      g_value_set_double(value, self->grid_max);
+      break;
+    
+    case PROP_INTEGRATE_METHOD:
+      g_value_set_enum(value, self->integ_method);
+      break;
+    
+    case PROP_INTEGRATE_SIZE:
+      g_value_set_uint(value, self->integ_size);
+      break;
+    
+    case PROP_INTEGRATE_SEED:
+      g_value_set_uint64(value, self->integ_seed);
+      break;
+    
     default:
       // Unknown property
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -474,45 +914,82 @@ static void initialize(OscatsTest *test, OscatsExaminee *e, gpointer alg_data)
   if (self->Inf) g_gsl_matrix_set_all(self->Inf, 0);
   self->base_num = 0;
   self->e = e;
+  if (self->grid_logL)
+    memset(self->grid_logL, 0, self->grid_points*sizeof(gdouble));
+  self->grid_base_num = 0;
+  if (self->rng)
+  {
+    self->stream = oscats_algorithm_examinee_rng(alg_data, self->rng,
+                                                 self->stream, e);
+    self->chooser->rng = self->stream;
+  }
+}
+
+// Prod_i P_i(x_i|theta) for discrete pattern number pattern
+static gdouble likelihood(Workspace *ws, guint pattern)
+{
+  OscatsAlgMaxKl *self = ws->self;
+  OscatsExaminee *e = self->e;
+  const gdouble *x = ws->theta->cont;
+  gsize size = ws->cache_n*sizeof(gdouble);
+  gdouble L = 1;
+  guint i, s;
+
+  if (e->items->len == 0) return 1;
+  if (ws->step != self->step)		// Slots from earlier steps are free
+  {
+    ws->step = self->step;
+    ws->cache_num = 0;
+  }
+
+  // Linear probing; the table is never more than half full
+  for (s = cache_slot(x, ws->cache_n, pattern); ws->cache_step[s] == ws->step;
+       s = (s+1) & (CACHE_SIZE-1))
+    if (ws->cache_pattern[s] == pattern &&
+        memcmp(ws->cache_x + s*ws->cache_n, x, size) == 0)
+      return ws->cache_L[s];
+
+  for (i=0; i < e->items->len; i++)
+    L *= oscats_model_P(
+           oscats_administrand_get_model(g_ptr_array_index(e->items, i), self->modelKey),
+           e->resp->data[i], ws->theta, e->covariates);
+
+  if (ws->cache_num < CACHE_SIZE/2)
+  {
+    ws->cache_step[s] = ws->step;
+    ws->cache_pattern[s] = pattern;
+    memcpy(ws->cache_x + s*ws->cache_n, x, size);
+    ws->cache_L[s] = L;
+    ws->cache_num++;
+  }
+  return L;
 }
 
 // - KL(theta_hat || theta) { Prod_i P_i(x_i|theta) }
-static gdouble summand(OscatsAlgMaxKl *self)
+static gdouble summand(Workspace *ws, guint pattern)
 {
+  OscatsAlgMaxKl *self = ws->self;
   OscatsExaminee *e = self->e;
   OscatsResponse k;
   gdouble val=0, L=1;
-  guint i;
   
-  if (self->posterior)
-    for (i=0; i < e->items->len; i++)
-      L *= oscats_model_P(
-             oscats_administrand_get_model(g_ptr_array_index(e->items, i), self->modelKey),
-             e->resp->data[i], self->theta, e->covariates);
-
-  for (k=0; k <= self->max; k++)
-    val += self->p[k] * log(oscats_model_P(self->model, k, self->theta, e->covariates));
-  return (val - self->p_sum) * L;
+  if (self->posterior) L = likelihood(ws, pattern);
+
+  for (k=0; k <= ws->max; k++)
+    val += ws->p[k] * log(oscats_model_P(ws->model, k, ws->theta, e->covariates));
+  return (val - ws->p_sum) * L;
 }
 
 // Sum KL(theta_hat || theta) { Prod_i P_i(x_i|theta) } g_discr(theta)
-static gdouble sum(OscatsAlgMaxKl *alg_data)
+// The patterns are visited in Gray-code order, one dimension per step.
+static gdouble sum(Workspace *ws)
 {
-  OscatsNatural i, junk=0, *max;
+  OscatsAlgMaxKl *alg_data = ws->self;
   gdouble val=0, *Dprior=NULL;
-  guint numNat = alg_data->space->num_nat;
-  guint numBin = alg_data->space->num_bin;
-  guint I, J, n=0, stride=1;
+  guint k, c=0, stride=1;
 
-  if (numBin == 0 && numNat == 0)	// only continuous dimensions
-    return summand(alg_data);
-  
-  if (numNat > 0) max = alg_data->space->max;
-  else  // Fake a natural dimension
-  {
-    numNat = 1;
-    max = &junk;
-  }
+  if (alg_data->numPatterns == 0)	// only continuous dimensions
+    return summand(ws, 0);
   
   if (alg_data->Dprior)
   {
@@ -525,45 +1002,105 @@ static gdouble sum(OscatsAlgMaxKl *alg_data)
     }
   }
 
-  for (I=0; I < numNat; I++)		// natural dimension
-    for (i=0; i <= max[I]; i++)		// value of this natural dimension
-    {
-      if (alg_data->theta->nat) alg_data->theta->nat[I] = i;
-      if (numBin == 0)
-        val += summand(alg_data) * (Dprior ? Dprior[stride*(n++)] : 1);
-      else
-        for (J=0; J < numBin; J++)	// binary dimension
-        {
-          // binary dim == 0
-          g_bit_array_clear_bit(alg_data->theta->bin, J);
-          val += summand(alg_data) * (Dprior ? Dprior[stride*(n++)] : 1);
-          
-          // binary dim == 1
-          g_bit_array_set_bit(alg_data->theta->bin, J);
-          val += summand(alg_data) * (Dprior ? Dprior[stride*(n++)] : 1);
-        }
-    }
+  oscats_point_first_pattern(ws->theta);
+  for (k=0; k < alg_data->numPatterns; k++)
+  {
+    if (k > 0) oscats_point_next_pattern(ws->theta, k, &c);
+    val += summand(ws, c) * (Dprior ? Dprior[stride*c] : 1);
+  }
       
   return val;
 }
 
-static gdouble integrand(const GGslVector *theta, gpointer data)
+/*
+ * For the posterior, x is the whitened variable z, with theta = mu + Lz
+ * and Sigma = LL', so the prior is exp(-|z|^2/2) with no solve per node.
+ * The Jacobian |L| is the same for every item, so it is dropped.
+ * Otherwise, x is linked to theta.
+ */
+static gdouble integrand(const GGslVector *x, gpointer data)
 {
-  OscatsAlgMaxKl *self = (OscatsAlgMaxKl*)data;
+  Workspace *ws = (Workspace*)data;
+  OscatsAlgMaxKl *self = ws->self;
   
   if (self->posterior)
   {
+    gsl_vector *theta = oscats_point_cont_as_vector(ws->theta)->v;
     gdouble g;
-    gsl_vector_memcpy(self->tmp, theta->v);
-    if (self->mu) gsl_vector_sub(self->tmp, self->mu);
-    if (self->Sigma_half)
-      gsl_linalg_cholesky_solve(self->Sigma_half, self->tmp, self->tmp2);
-    else
-      gsl_vector_memcpy(self->tmp2, self->tmp);
-    gsl_blas_ddot(self->tmp, self->tmp2, &g);
-    return sum(self) * exp(-g/2);
+    if (x->v->size == 1)
+    {
+      g = x->v->data[0];
+      theta->data[0] = (self->mu ? self->mu->data[0] : 0) +
+                       (self->Sigma_half ? self->Sigma_half->data[0] : 1) * g;
+      g *= g;
+    } else {
+      gsl_vector_memcpy(theta, x->v);
+      if (self->Sigma_half)
+        gsl_blas_dtrmv(CblasLower, CblasNoTrans, CblasNonUnit,
+                       self->Sigma_half, theta);
+      if (self->mu) gsl_vector_add(theta, self->mu);
+      gsl_blas_ddot(x->v, x->v, &g);
+    }
+    return sum(ws) * exp(-g/2);
+  }
+  else return sum(ws);
+}
+
+/*
+ * integrand() for a block of n nodes when the space is purely continuous.
+ * The item's log probabilities are computed over the whole block with
+ * oscats_model_P_grid(), one response category at a time.  The
+ * likelihood of the administered items is taken from the cache.
+ */
+static void integrand_batch(guint n, const gdouble *x, gdouble *f,
+                            gpointer data)
+{
+  Workspace *ws = (Workspace*)data;
+  OscatsAlgMaxKl *self = ws->self;
+  guint d = self->space->num_cont, g, i, j;
+  const gdouble *theta = x, *z;
+  gdouble *P, s;
+  OscatsResponse k;
+
+  if (n*(d+1) > ws->block_size)
+  {
+    ws->block_size = n*(d+1);
+    ws->block = g_renew(gdouble, ws->block, ws->block_size);
   }
-  else return sum(self);
+  P = ws->block + n*d;
+
+  // theta = mu + Lz, as in integrand()
+  if (self->posterior)
+  {
+    for (g=0, z=x; g < n; g++, z += d)
+      for (i=0; i < d; i++)
+      {
+        s = (self->mu ? gsl_vector_get(self->mu, i) : 0);
+        if (self->Sigma_half)
+          for (j=0; j <= i; j++)
+            s += gsl_matrix_get(self->Sigma_half, i, j) * z[j];
+        else
+          s += z[i];
+        ws->block[g*d+i] = s;
+      }
+    theta = ws->block;
+  }
+
+  for (g=0; g < n; g++) f[g] = -ws->p_sum;
+  for (k=0; k <= ws->max; k++)
+  {
+    oscats_model_P_grid(ws->model, k, theta, n, self->e->covariates, P);
+    for (g=0; g < n; g++)
+      f[g] += ws->p[k] * log(P[g]);
+  }
+
+  if (self->posterior)
+    for (g=0, z=x; g < n; g++, z += d)
+    {
+      memcpy(ws->theta->cont, theta + g*d, d*sizeof(gdouble));
+      for (i=0, s=0; i < d; i++) s += z[i]*z[i];
+      f[g] *= likelihood(ws, 0) * exp(-s/2);
+    }
 }
 
 // This value will be minimized
@@ -572,55 +1109,183 @@ static gdouble criterion(const OscatsItem *item,
                          const OscatsExaminee *e,
                          gpointer data)
 {
-  OscatsAlgMaxKl *alg_data = OSCATS_ALG_MAX_KL(data);
+  Workspace *ws = (Workspace*)data;
+  OscatsAlgMaxKl *alg_data = ws->self;
   OscatsModel *model = oscats_administrand_get_model(OSCATS_ADMINISTRAND(item), alg_data->modelKey);
   gdouble I = 0;
   guint k;
 
   g_return_val_if_fail(model != NULL, 0);
-  if (!(alg_data->space &&
-        oscats_space_compatible(alg_data->space, model->space)))
-    g_return_val_if_fail(alloc_workspace(alg_data, model->space), 0);
+  // The workspace was allocated in select()
+  g_return_val_if_fail(oscats_space_compatible(alg_data->space, model->space), 0);
 
-  alg_data->model = model;
-  alg_data->max = oscats_model_get_max(model);
-  if (alg_data->max >= alg_data->p_num)
+  ws->model = model;
+  ws->max = oscats_model_get_max(model);
+  if (ws->max >= ws->p_num)
   {
-    if (alg_data->p) g_free(alg_data->p);
-    alg_data->p_num = alg_data->max+1;
-    alg_data->p = g_new(gdouble, alg_data->p_num);
+    if (ws->p) g_free(ws->p);
+    ws->p_num = ws->max+1;
+    ws->p = g_new(gdouble, ws->p_num);
   }
-  for (k=0; k <= alg_data->max; k++)
+  for (k=0; k <= ws->max; k++)
   {
     gdouble p = oscats_model_P(model, k, alg_data->theta_hat, e->covariates);
-    alg_data->p[k] = p;
+    ws->p[k] = p;
     I += p * log(p);
   }
-  alg_data->p_sum = I;
+  ws->p_sum = I;
 
   if (alg_data->space->num_cont == 0)
-    return sum(alg_data);
+    return sum(ws);
   
   if (alg_data->posterior)
-    return oscats_integrate_space(alg_data->integrator, alg_data);
+    return oscats_integrate_space(ws->integrator, ws);
   else if (alg_data->inf_bounds)
   {
     if (alg_data->base_num == 0)
-      return oscats_integrate_space(alg_data->integrator, alg_data);
+      return oscats_integrate_space(ws->integrator, ws);
     else
-      return oscats_integrate_ellipse(alg_data->integrator,
+      return oscats_integrate_ellipse_chol(ws->integrator,
                             oscats_point_cont_as_vector(alg_data->theta_hat),
-                                      alg_data->Inf_inv,
+                                      alg_data->Inf_half,
                                       alg_data->c,
-                                      alg_data);
+                                      ws);
   }
   else
-    return oscats_integrate_cube(alg_data->integrator,
+    return oscats_integrate_cube(ws->integrator,
                             oscats_point_cont_as_vector(alg_data->theta_hat),
                                  alg_data->c / 
                                  (alg_data->e->items->len > 0 ?
                                   sqrt(alg_data->e->items->len) : 1),
-                                 alg_data);
+                                 ws);
+}
+
+// Bank index of an administered item, usually the last one selected
+static guint grid_bank_index(const OscatsAlgMaxKl *self, gpointer item)
+{
+  GPtrArray *items = self->chooser->bank->items;
+  guint i;
+  if (self->grid_last < items->len &&
+      g_ptr_array_index(items, self->grid_last) == item)
+    return self->grid_last;
+  for (i=0; i < items->len; i++)
+    if (g_ptr_array_index(items, i) == item) break;
+  return i;
+}
+
+static gdouble grid_log_prior(const OscatsAlgMaxKl *self, guint g)
+{
+  gdouble z = grid_point(self, g);
+  if (self->mu) z -= self->mu->data[0];
+  if (self->Sigma_half) z /= self->Sigma_half->data[0];
+  return -z*z/2;
+}
+
+/*
+ * Sets the quadrature weights for the grid points.  The weights integrate
+ * the linear interpolant of the integrand over the integration region,
+ * times the posterior if necessary.
+ */
+static void grid_weights(OscatsAlgMaxKl *self, OscatsExaminee *e)
+{
+  guint G = self->grid_points, g, i, K, n;
+  gdouble *w = self->grid_w, *logL = self->grid_logL;
+  gdouble h = (self->grid_max - self->grid_min) / (G-1);
+  gdouble lo = self->grid_min, hi = self->grid_max, a, b, t, x, max;
+
+  if (!self->posterior && !(self->inf_bounds && self->base_num == 0))
+  {
+    gdouble th = self->theta_hat->cont[0], delta;
+    if (self->inf_bounds)
+      delta = sqrt(self->c * self->Inf_inv->v->data[0]);
+    else
+      delta = self->c / (e->items->len > 0 ? sqrt(e->items->len) : 1);
+    if (th - delta > lo) lo = th - delta;
+    if (th + delta < hi) hi = th + delta;
+  }
+
+  for (g=0; g < G; g++) w[g] = 0;
+  for (g=0; g+1 < G; g++)
+  {
+    x = grid_point(self, g);
+    a = (lo > x ? lo : x);
+    b = (hi < x+h ? hi : x+h);
+    if (b <= a) continue;
+    t = (a + b - 2*x) / (2*h);
+    w[g] += (b-a)*(1-t);
+    w[g+1] += (b-a)*t;
+  }
+
+  if (self->posterior)
+  {
+    for (; self->grid_base_num < e->items->len; self->grid_base_num++)
+    {
+      i = grid_bank_index(self,
+                          g_ptr_array_index(e->items, self->grid_base_num));
+      if (i >= self->chooser->bank->items->len)
+      {
+        // Leaves the weights consistent, as if the item had not been given
+        g_warning("OscatsAlgMaxKl: Administered item is not in the item bank.  Ignored in the posterior.");
+        continue;
+      }
+      K = (self->grid_offset[i+1] - self->grid_offset[i]) / G;
+      for (g=0; g < G; g++)
+        logL[g] += self->grid_logP[self->grid_offset[i] + g*K +
+                                   e->resp->data[self->grid_base_num]];
+    }
+    // The posterior is scaled by its maximum to avoid underflow
+    for (g=0, max=-G_MAXDOUBLE; g < G; g++)
+      if (logL[g] + grid_log_prior(self, g) > max)
+        max = logL[g] + grid_log_prior(self, g);
+    for (g=0; g < G; g++)
+      w[g] *= exp(logL[g] + grid_log_prior(self, g) - max);
+  }
+
+  for (g=0, max=0; g < G; g++)
+    if (w[g] > max) max = w[g];
+  self->grid_W = 0;
+  for (g=0, n=0; g < G; g++)
+    if (w[g] > MIN_WEIGHT*max)
+    {
+      self->grid_active[n] = g;
+      w[n] = w[g];
+      self->grid_W += w[n++];
+    }
+  self->grid_num_active = n;
+}
+
+// KL index of each eligible item from the grid tables (to be minimized)
+static void grid_values(OscatsAlgMaxKl *self, OscatsExaminee *e,
+                        GBitArray *eligible)
+{
+  GPtrArray *items = self->chooser->bank->items;
+  guint n = self->grid_num_active, K, j;
+  const gdouble *logP, *w = self->grid_w;
+  const guint *active = self->grid_active;
+  gdouble val, p, s;
+  OscatsResponse k;
+  OscatsModel *model;
+  gint i;
+
+  g_bit_array_iter_reset(eligible);
+  while ((i = g_bit_array_iter_next(eligible)) >= 0)
+  {
+    model = oscats_administrand_get_model(g_ptr_array_index(items, i),
+                                          self->modelKey);
+    logP = self->grid_logP + self->grid_offset[i];
+    K = (self->grid_offset[i+1] - self->grid_offset[i]) / self->grid_points;
+
+    // Sum_g w_g sum_k p_k (log p_k - log P(k|x_g))
+    for (k=0, val=0; k < K; k++)
+    {
+      p = oscats_model_P(model, k, self->theta_hat, e->covariates);
+      if (p <= 0) continue;
+      for (j=0, s=0; j < n; j++)
+        s += w[j] * logP[active[j]*K+k];
+      val += p * (log(p)*self->grid_W - s);
+    }
+    self->grid_values[i] = -val;
+  }
 }
 
 static gint select (OscatsTest *test, OscatsExaminee *e,
@@ -630,16 +1295,48 @@ static gint select (OscatsTest *test, OscatsExaminee *e,
   self->theta_hat = ( self->thetaKey ?
                         oscats_examinee_get_theta(e, self->thetaKey) :
                         oscats_examinee_get_est_theta(e) );
+  self->step++;
 
-  if (self->Inf)
+  // Allocate shared state here, before the criterion is evaluated
+  if (!(self->space &&
+        oscats_space_compatible(self->space, self->theta_hat->space)))
+    g_return_val_if_fail(alloc_workspace(self, self->theta_hat->space), -1);
+  if (self->space->num_cont > 0) oscats_point_cont_as_vector(self->theta_hat);
+
+  // The inverse only changes when items have been administered
+  if (self->Inf && self->base_num < e->items->len)
   {
     for (; self->base_num < e->items->len; self->base_num++)
       oscats_model_fisher_inf(
         oscats_administrand_get_model(g_ptr_array_index(e->items, self->base_num), self->modelKey),
         self->theta_hat, e->covariates, self->Inf);
-    g_gsl_matrix_copy(self->Inf_inv, self->Inf);
-    gsl_linalg_cholesky_decomp(self->Inf_inv->v);
-    gsl_linalg_cholesky_invert(self->Inf_inv->v);
+    if (self->Inf->v->size1 == 1)
+      self->Inf_inv->v->data[0] = 1/self->Inf->v->data[0];
+    else
+    {
+      g_gsl_matrix_copy(self->Inf_inv, self->Inf);
+      gsl_linalg_cholesky_decomp(self->Inf_inv->v);
+      gsl_linalg_cholesky_invert(self->Inf_inv->v);
+    }
+    // Factored here rather than once per candidate by the integrator
+    if (self->Inf->v->size1 == 1)
+      self->Inf_half->v->data[0] = sqrt(self->Inf_inv->v->data[0]);
+    else
+    {
+      g_gsl_matrix_copy(self->Inf_half, self->Inf_inv);
+      gsl_linalg_cholesky_decomp(self->Inf_half->v);
+    }
+  }
+
+  if (self->grid_logP && eligible->bit_len == self->chooser->bank->items->len)
+  {
+    gint item_index;
+    grid_weights(self, e);
+    grid_values(self, e, eligible);
+    item_index = oscats_alg_chooser_choose_values(self->chooser, eligible,
+                                                  self->grid_values);
+    if (item_index >= 0) self->grid_last = item_index;
+    return item_index;
   }
 
   return oscats_alg_chooser_choose(self->chooser, e, eligible, alg_data);
@@ -658,11 +1355,12 @@ static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test)
 
   self->chooser->bank = g_object_ref(test->itembank);
   self->chooser->criterion = criterion;
+  build_grid(self);
 
-  g_signal_connect_data(test, "initialize", G_CALLBACK(initialize),
-                        alg_data, oscats_algorithm_closure_finalize, 0);
-  g_signal_connect_data(test, "select", G_CALLBACK(select),
-                        alg_data, oscats_algorithm_closure_finalize, 0);
+  oscats_test_connect_native(test, "initialize", G_CALLBACK(initialize),
+                             alg_data, oscats_algorithm_closure_finalize);
+  oscats_test_connect_native(test, "select", G_CALLBACK(select),
+                             alg_data, oscats_algorithm_closure_finalize);
   g_object_ref(alg_data);
 }
                    
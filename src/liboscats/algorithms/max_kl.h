@@ -65,6 +65,15 @@ typedef struct _OscatsAlgMaxKlClass OscatsAlgMaxKlClass;
  * where g(theta) is the prior for theta (multivariate normal for continuous
  * dimensions and an arbitrary discrete distribution for discrete dimensions).
  *
+ * For banks with a single continuous dimension, setting
+ * #OscatsAlgMaxKl:grid-points replaces the adaptive integration with fixed
+ * quadrature weights on a grid over which each item's log probabilities are
+ * tabulated once, when the algorithm is registered.
+ *
+ * In several continuous dimensions, #OscatsAlgMaxKl:integrate-method
+ * selects quasi-Monte Carlo or sparse-grid integration, whose cost does
+ * not grow exponentially with the number of dimensions.
+ *
  * References:
  * <bibliolist>
  *  <bibliomixed>
@@ -133,6 +142,7 @@ struct _OscatsAlgMaxKl {
   gdouble c;
   /*< private >*/
   OscatsAlgChooser *chooser;
+  OscatsRng *rng, *stream;
   OscatsSpace *space;
   guint numPatterns;
   // Properties
@@ -144,16 +154,25 @@ struct _OscatsAlgMaxKl {
   // Temporary holding slots (held without reference)
   OscatsExaminee *e;
   OscatsPoint *theta_hat;
-  OscatsModel *model;
-  OscatsResponse max;
-  // Integration working space
-  OscatsPoint *theta;
-  gdouble p_sum, *p;
-  guint p_num;
-  OscatsIntegrate *integrator;
-  gsl_vector *tmp, *tmp2;	// for posterior
+  // Integration working space (per-thread space is kept by the chooser)
   GGslMatrix *Inf, *Inf_inv;	// for ellipse
+  GGslMatrix *Inf_half;		// Cholesky factor of Inf_inv
   guint base_num;
+  guint step;			// selection count, for likelihood caches
+  OscatsIntegrateMethod integ_method;
+  guint integ_size;
+  guint64 integ_seed;		// for quasi-Monte Carlo shifts
+  // Fixed-grid KL tables for unidimensional banks
+  guint grid_points;
+  gdouble grid_min, grid_max;
+  gdouble *grid_logP;		// log P_i(k|x_g), one block per item
+  guint *grid_offset;		// start of each item's block
+  gdouble *grid_logL;		// log likelihood at each grid point
+  gdouble *grid_w;		// quadrature weights of active points
+  gdouble grid_W;		// sum of grid_w
+  guint *grid_active, grid_num_active, grid_base_num;
+  guint grid_last;		// bank index of the last item selected
+  gdouble *grid_values;		// KL index, by bank index
 };
 
 struct _OscatsAlgMaxKlClass {
@@ -0,0 +1,493 @@
+/* OSCATS: Open-Source Computerized Adaptive Testing System
+ * CAT Algorithm: Select Item based on Posterior-Weighted Fisher Information
+ * Copyright 2011 Michael Culbertson <culbert1@illinois.edu>
+ *
+ *  OSCATS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OSCATS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with OSCATS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include "random.h"
+#include "algorithms/max_pw_fisher.h"
+#include "model.h"
+
+// Relative posterior weight below which a grid point is skipped
+#define MIN_WEIGHT 1e-12
+
+enum {
+  PROP_0,
+  PROP_NUM,
+  PROP_MODEL_KEY,
+  PROP_GRID_POINTS,
+  PROP_GRID_MIN,
+  PROP_GRID_MAX,
+  PROP_MU,
+  PROP_SIGMA,
+  PROP_RNG,
+};
+
+G_DEFINE_TYPE(OscatsAlgMaxPwFisher, oscats_alg_max_pw_fisher, OSCATS_TYPE_ALGORITHM);
+
+static void oscats_alg_max_pw_fisher_dispose(GObject *object);
+static void oscats_alg_max_pw_fisher_set_property(GObject *object,
+              guint prop_id, const GValue *value, GParamSpec *pspec);
+static void oscats_alg_max_pw_fisher_get_property(GObject *object,
+              guint prop_id, GValue *value, GParamSpec *pspec);
+static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test);
+
+static void oscats_alg_max_pw_fisher_class_init (OscatsAlgMaxPwFisherClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+  GParamSpec *pspec;
+
+  gobject_class->dispose = oscats_alg_max_pw_fisher_dispose;
+  gobject_class->set_property = oscats_alg_max_pw_fisher_set_property;
+  gobject_class->get_property = oscats_alg_max_pw_fisher_get_property;
+
+  OSCATS_ALGORITHM_CLASS(klass)->reg = alg_register;
+
+/**
+ * OscatsAlgMaxPwFisher:num:
+ *
+ * Number of items from which to choose.  If one, then the exact optimal
+ * item is selected.  If greater than one, then a random item is chosen
+ * from among the #OscatsAlgMaxPwFisher:num optimal items.
+ */
+  pspec = g_param_spec_uint("num", "",
+                            "Number of items from which to choose",
+                            1, G_MAXUINT, 1,
+                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_NUM, pspec);
+
+/**
+ * OscatsAlgMaxPwFisher:modelKey:
+ *
+ * The key indicating which model to use for selection.  A %NULL value or
+ * empty string indicates the item's default model.
+ */
+  pspec = g_param_spec_string("modelKey", "model key",
+                            "Which model to use for selection",
+                            NULL,
+                            G_PARAM_READWRITE |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_MODEL_KEY, pspec);
+
+/**
+ * OscatsAlgMaxPwFisher:grid-points:
+ *
+ * Number of equally spaced grid points from
+ * #OscatsAlgMaxPwFisher:grid-min to #OscatsAlgMaxPwFisher:grid-max over
+ * which the posterior is evaluated.  The grid is set up when the algorithm
+ * is registered.
+ */
+  pspec = g_param_spec_uint("grid-points", "grid points",
+                            "Number of points in posterior grid",
+                            2, G_MAXUINT, 61,
+                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_GRID_POINTS, pspec);
+
+/**
+ * OscatsAlgMaxPwFisher:grid-min:
+ *
+ * Lower end of the posterior grid.
+ */
+  pspec = g_param_spec_double("grid-min", "grid minimum",
+                              "Lower end of posterior grid",
+                              -G_MAXDOUBLE, G_MAXDOUBLE, -4,
+                              G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                              G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                              G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_GRID_MIN, pspec);
+
+/**
+ * OscatsAlgMaxPwFisher:grid-max:
+ *
+ * Upper end of the posterior grid.
+ */
+  pspec = g_param_spec_double("grid-max", "grid maximum",
+                              "Upper end of posterior grid",
+                              -G_MAXDOUBLE, G_MAXDOUBLE, 4,
+                              G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                              G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                              G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_GRID_MAX, pspec);
+
+/**
+ * OscatsAlgMaxPwFisher:mu:
+ *
+ * The mean of the Normal prior for theta.
+ */
+  pspec = g_param_spec_double("mu", "prior mean",
+                              "Mean of the Normal prior",
+                              -G_MAXDOUBLE, G_MAXDOUBLE, 0,
+                              G_PARAM_READWRITE |
+                              G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                              G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_MU, pspec);
+
+/**
+ * OscatsAlgMaxPwFisher:sigma:
+ *
+ * The standard deviation of the Normal prior for theta.
+ */
+  pspec = g_param_spec_double("sigma", "prior standard deviation",
+                              "Standard deviation of the Normal prior",
+                              G_MINDOUBLE, G_MAXDOUBLE, 1,
+                              G_PARAM_READWRITE |
+                              G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                              G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_SIGMA, pspec);
+
+/**
+ * OscatsAlgMaxPwFisher:rng:
+ *
+ * The random number generator used to choose among the
+ * #OscatsAlgMaxPwFisher:num best items.  If %NULL, the library-wide
+ * generator is used.  Otherwise, each examinee's choices are made with a
+ * substream of @rng determined by the examinee's id
+ * [see oscats_algorithm_examinee_rng()].  The choices are reproducible
+ * between runs only if the examinees are given explicit ids.
+ */
+  pspec = g_param_spec_object("rng", "Random number generator",
+                            "Generator for choosing among the best items",
+                            OSCATS_TYPE_RNG,
+                            G_PARAM_READWRITE |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_RNG, pspec);
+
+}
+
+static void oscats_alg_max_pw_fisher_init (OscatsAlgMaxPwFisher *self)
+{
+  self->sigma = 1;
+}
+
+static void clear_grid(OscatsAlgMaxPwFisher *self)
+{
+  if (self->theta) g_object_unref(self->theta);
+  if (self->I) g_object_unref(self->I);
+  g_free(self->logw);
+  g_free(self->w);
+  g_free(self->active);
+  g_free(self->table);
+  g_free(self->values);
+  self->theta = NULL;
+  self->I = NULL;
+  self->logw = self->w = self->table = self->values = NULL;
+  self->active = NULL;
+  self->num_active = self->table_num = 0;
+}
+
+static gdouble grid_point(const OscatsAlgMaxPwFisher *self, guint k)
+{
+  return self->grid_min +
+         (self->grid_max - self->grid_min) * k / (self->grid_points-1);
+}
+
+// Sets up the grid and, if no model has covariates, tabulates item
+// information over it.
+static void build_grid(OscatsAlgMaxPwFisher *self)
+{
+  GPtrArray *items = self->chooser->bank->items;
+  guint num = items->len, P = self->grid_points, i, k;
+  gboolean tabulate = TRUE;
+  OscatsModel *model;
+
+  clear_grid(self);
+  g_return_if_fail(num > 0 && self->grid_min < self->grid_max);
+  for (i=0; i < num; i++)
+  {
+    model = oscats_administrand_get_model(g_ptr_array_index(items, i),
+                                          self->modelKey);
+    g_return_if_fail(model != NULL && OSCATS_IS_SPACE(model->space));
+    if (model->space->num_cont != 1 || model->space->num_bin > 0 ||
+        model->space->num_nat > 0)
+    {
+      g_critical("OscatsAlgMaxPwFisher: Item bank is not unidimensional.");
+      if (self->theta) g_object_unref(self->theta);
+      self->theta = NULL;
+      return;
+    }
+    if (model->Ncov > 0) tabulate = FALSE;
+    if (self->theta == NULL)
+      self->theta = oscats_point_new_from_space(model->space);
+  }
+
+  self->logw = g_new(gdouble, P);
+  self->w = g_new(gdouble, P);
+  self->active = g_new(guint, P);
+  self->I = g_gsl_matrix_new(1, 1);
+  if (!tabulate) return;
+
+  // Item-major, so that each item's weighted sum is over a contiguous row
+  self->table = g_new(gdouble, num*P);
+  self->values = g_new(gdouble, num);
+  self->table_num = num;
+  for (i=0; i < num; i++)
+  {
+    model = oscats_administrand_get_model(g_ptr_array_index(items, i),
+                                          self->modelKey);
+    for (k=0; k < P; k++)
+    {
+      self->theta->cont[0] = grid_point(self, k);
+      self->I->v->data[0] = 0;
+      oscats_model_fisher_inf(model, self->theta, NULL, self->I);
+      self->table[i*P+k] = self->I->v->data[0];
+    }
+  }
+}
+
+static void oscats_alg_max_pw_fisher_dispose (GObject *object)
+{
+  OscatsAlgMaxPwFisher *self = OSCATS_ALG_MAX_PW_FISHER(object);
+  G_OBJECT_CLASS(oscats_alg_max_pw_fisher_parent_class)->dispose(object);
+  if (self->chooser) g_object_unref(self->chooser);
+  if (self->rng) g_object_unref(self->rng);
+  if (self->stream) g_object_unref(self->stream);
+  clear_grid(self);
+  self->chooser = NULL;
+  self->rng = self->stream = NULL;
+}
+
+static void oscats_alg_max_pw_fisher_set_property(GObject *object,
+              guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+  OscatsAlgMaxPwFisher *self = OSCATS_ALG_MAX_PW_FISHER(object);
+  switch (prop_id)
+  {
+    case PROP_NUM:			// construction only
+      self->chooser = g_object_new(OSCATS_TYPE_ALG_CHOOSER,
+                                   "num", g_value_get_uint(value), NULL);
+      break;
+
+    case PROP_MODEL_KEY:
+    {
+      const gchar *key = g_value_get_string(value);
+      if (key == NULL || key[0] == '\0') self->modelKey = 0;
+      else self->modelKey = g_quark_from_string(key);
+    }
+      break;
+
+    case PROP_GRID_POINTS:		// construction only
+      self->grid_points = g_value_get_uint(value);
+      break;
+
+    case PROP_GRID_MIN:		// construction only
+      self->grid_min = g_value_get_double(value);
+      break;
+
+    case PROP_GRID_MAX:		// construction only
+      self->grid_max = g_value_get_double(value);
+      break;
+
+    case PROP_MU:
+      self->mu = g_value_get_double(value);
+      break;
+
+    case PROP_SIGMA:
+      self->sigma = g_value_get_double(value);
+      break;
+
+    case PROP_RNG:
+      if (self->rng) g_object_unref(self->rng);
+      self->rng = g_value_dup_object(value);
+      break;
+
+    default:
+      // Unknown property
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+static void oscats_alg_max_pw_fisher_get_property(GObject *object,
+              guint prop_id, GValue *value, GParamSpec *pspec)
+{
+  OscatsAlgMaxPwFisher *self = OSCATS_ALG_MAX_PW_FISHER(object);
+  switch (prop_id)
+  {
+    case PROP_NUM:
+      g_value_set_uint(value, self->chooser->num);
+      break;
+
+    case PROP_MODEL_KEY:
+      g_value_set_string(value, self->modelKey ?
+                         g_quark_to_string(self->modelKey) : "");
+      break;
+
+    case PROP_GRID_POINTS:
+      g_value_set_uint(value, self->grid_points);
+      break;
+
+    case PROP_GRID_MIN:
+      g_value_set_double(value, self->grid_min);
+      break;
+
+    case PROP_GRID_MAX:
+      g_value_set_double(value, self->grid_max);
+      break;
+
+    case PROP_MU:
+      g_value_set_double(value, self->mu);
+      break;
+
+    case PROP_SIGMA:
+      g_value_set_double(value, self->sigma);
+      break;
+
+    case PROP_RNG:
+      g_value_set_object(value, self->rng);
+      break;
+
+    default:
+      // Unknown property
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+static void initialize(OscatsTest *test, OscatsExaminee *e, gpointer alg_data)
+{
+  OscatsAlgMaxPwFisher *self = OSCATS_ALG_MAX_PW_FISHER(alg_data);
+  guint k;
+  gdouble z;
+  // Start from the log prior
+  if (self->logw)
+    for (k=0; k < self->grid_points; k++)
+    {
+      z = (grid_point(self, k) - self->mu) / self->sigma;
+      self->logw[k] = -z*z/2;
+    }
+  self->base_num = 0;
+  if (self->rng)
+  {
+    self->stream = oscats_algorithm_examinee_rng(alg_data, self->rng,
+                                                 self->stream, e);
+    self->chooser->rng = self->stream;
+  }
+}
+
+// This value will be minimized
+static gdouble criterion(const OscatsItem *item,
+                         const OscatsExaminee *e,
+                         gpointer data)
+{
+  OscatsAlgMaxPwFisher *alg_data = (OscatsAlgMaxPwFisher*)data;
+  OscatsModel *model = oscats_administrand_get_model(OSCATS_ADMINISTRAND(item), alg_data->modelKey);
+  gdouble I = 0;
+  guint j;
+  g_return_val_if_fail(model != NULL, 0);
+  for (j=0; j < alg_data->num_active; j++)
+  {
+    alg_data->theta->cont[0] = grid_point(alg_data, alg_data->active[j]);
+    alg_data->I->v->data[0] = 0;
+    oscats_model_fisher_inf(model, alg_data->theta, e->covariates,
+                            alg_data->I);
+    I += alg_data->w[j] * alg_data->I->v->data[0];
+  }
+  return -I;
+    // max E[I_j(theta)|x] <==> min -E[I_j(theta)|x]
+}
+
+static gint select (OscatsTest *test, OscatsExaminee *e,
+                    GBitArray *eligible, gpointer alg_data)
+{
+  OscatsAlgMaxPwFisher *self = OSCATS_ALG_MAX_PW_FISHER(alg_data);
+  OscatsModel *model;
+  gdouble max = -G_MAXDOUBLE, total = 0, I;
+  const gdouble *row;
+  guint k, j, first, last;
+  gint i;
+  g_return_val_if_fail(self->logw != NULL, -1);
+
+  // Update the posterior with items administered since the last selection
+  for (; self->base_num < e->items->len; self->base_num++)
+  {
+    model = oscats_administrand_get_model(g_ptr_array_index(e->items, self->base_num), self->modelKey);
+    for (k=0; k < self->grid_points; k++)
+    {
+      self->theta->cont[0] = grid_point(self, k);
+      self->logw[k] += log(oscats_model_P(model,
+                                          e->resp->data[self->base_num],
+                                          self->theta, e->covariates));
+    }
+  }
+
+  // The active points run from the first to the last with non-negligible
+  // weight.  If the posterior has underflowed everywhere, all points are
+  // weighted equally.
+  for (k=0; k < self->grid_points; k++)
+    if (self->logw[k] > max) max = self->logw[k];
+  for (k=0; k < self->grid_points; k++)
+    self->w[k] = exp(self->logw[k] - max);
+  for (first=0; first < self->grid_points && !(self->w[first] >= MIN_WEIGHT);
+       first++) ;
+  if (first == self->grid_points)
+  {
+    for (k=0; k < self->grid_points; k++) self->w[k] = 1;
+    first = 0;
+  }
+  for (last=self->grid_points-1; !(self->w[last] >= MIN_WEIGHT); last--) ;
+  for (k=first, j=0; k <= last; k++, j++)
+  {
+    self->active[j] = k;
+    self->w[j] = self->w[k];
+    total += self->w[j];
+  }
+  self->num_active = j;
+  for (j=0; j < self->num_active; j++)
+    self->w[j] /= total;
+
+  if (!self->table || self->table_num != eligible->bit_len)
+    return oscats_alg_chooser_choose(self->chooser, e, eligible, alg_data);
+
+  // max E[I_j(theta)|x] <==> min -E[I_j(theta)|x]
+  g_bit_array_iter_reset(eligible);
+  while ((i = g_bit_array_iter_next(eligible)) >= 0)
+  {
+    row = self->table + i*self->grid_points + first;
+    for (j=0, I=0; j < self->num_active; j++)
+      I += self->w[j] * row[j];
+    self->values[i] = -I;
+  }
+  return oscats_alg_chooser_choose_values(self->chooser, eligible,
+                                          self->values);
+}
+
+/*
+ * Note that unless someone does something naughty, alg_data will be of the
+ * appropriate type, and test will be an OscatsTest.  The signal connections
+ * should include oscats_algorithm_closure_finalize as the destruction
+ * callback.  The first connection should take alg_data's reference.  Any
+ * subsequent connections should be accompanied by g_object_ref(alg_data).
+ */
+static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test)
+{
+  OscatsAlgMaxPwFisher *self = OSCATS_ALG_MAX_PW_FISHER(alg_data);
+
+  self->chooser->bank = g_object_ref(test->itembank);
+  build_grid(self);
+  self->chooser->criterion = criterion;
+
+  oscats_test_connect_native(test, "initialize", G_CALLBACK(initialize),
+                             alg_data, oscats_algorithm_closure_finalize);
+  oscats_test_connect_native(test, "select", G_CALLBACK(select),
+                             alg_data, oscats_algorithm_closure_finalize);
+  g_object_ref(alg_data);
+}
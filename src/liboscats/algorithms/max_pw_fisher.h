@@ -0,0 +1,102 @@
+/* OSCATS: Open-Source Computerized Adaptive Testing System
+ * CAT Algorithm: Select Item based on Posterior-Weighted Fisher Information
+ * Copyright 2011 Michael Culbertson <culbert1@illinois.edu>
+ *
+ *  OSCATS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OSCATS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with OSCATS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LIBOSCATS_ALGORITHM_MAX_PW_FISHER_H_
+#define _LIBOSCATS_ALGORITHM_MAX_PW_FISHER_H_
+#include <glib-object.h>
+#include <algorithm.h>
+#include <algorithms/chooser.h>
+G_BEGIN_DECLS
+
+#define OSCATS_TYPE_ALG_MAX_PW_FISHER	(oscats_alg_max_pw_fisher_get_type())
+#define OSCATS_ALG_MAX_PW_FISHER(obj)	(G_TYPE_CHECK_INSTANCE_CAST ((obj), OSCATS_TYPE_ALG_MAX_PW_FISHER, OscatsAlgMaxPwFisher))
+#define OSCATS_IS_ALG_MAX_PW_FISHER(obj)	(G_TYPE_CHECK_INSTANCE_TYPE ((obj), OSCATS_TYPE_ALG_MAX_PW_FISHER))
+#define OSCATS_ALG_MAX_PW_FISHER_CLASS(klass)	(G_TYPE_CHECK_CLASS_CAST ((klass), OSCATS_TYPE_ALG_MAX_PW_FISHER, OscatsAlgMaxPwFisherClass))
+#define OSCATS_IS_ALG_MAX_PW_FISHER_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), OSCATS_TYPE_ALG_MAX_PW_FISHER))
+#define OSCATS_ALG_MAX_PW_FISHER_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS ((obj), OSCATS_TYPE_ALG_MAX_PW_FISHER, OscatsAlgMaxPwFisherClass))
+
+typedef struct _OscatsAlgMaxPwFisher OscatsAlgMaxPwFisher;
+typedef struct _OscatsAlgMaxPwFisherClass OscatsAlgMaxPwFisherClass;
+
+/**
+ * OscatsAlgMaxPwFisher:
+ *
+ * Item selection algorithm (#OscatsTest::select).
+ * Picks the item with greatest posterior-weighted Fisher information.
+ * Items with exactly the same information are ranked by their index in
+ * the item bank.
+ *
+ * Posterior-weighted Fisher Information is:
+ * PWI_j = Int I_j(theta) { prod_i P_i(x_i|theta) } g(theta) dtheta /
+ *         Int { prod_i P_i(x_i|theta) } g(theta) dtheta,
+ * where g(theta) is a Normal prior for theta.  Unlike
+ * #OscatsAlgMaxFisher, this does not depend on a point estimate of theta,
+ * which is unstable early in the test.
+ *
+ * The integrals are approximated on a fixed grid of
+ * #OscatsAlgMaxPwFisher:grid-points equally spaced points.  The
+ * information of every item at each grid point is computed once, when the
+ * algorithm is registered, and the posterior at each grid point is updated
+ * only for newly administered items, so selection costs little more than
+ * with #OscatsAlgMaxFisher.  Grid points whose posterior weight is
+ * negligible are skipped.
+ *
+ * This algorithm requires a latent space with a single continuous
+ * dimension and no discrete dimensions.  If any item model has
+ * covariates, the information is computed at each grid point during
+ * selection instead of being tabulated.
+ *
+ * References:
+ * <bibliolist>
+ *  <bibliomixed>
+ *    <author><personname><firstname>Wim</firstname> <surname>van der Linden</surname></personname></author>
+ *    (<pubdate>1998</pubdate>).
+ *    "<title>Bayesian Item Selection Criteria for Adaptive Testing</title>."
+ *    <biblioset><title>Psychometrika</title>,
+ *               <volumenum>63</volumenum>,</biblioset>
+ *    <artpagenums>201-216</artpagenums>.
+ *  </bibliomixed>
+ * </bibliolist>
+ */
+struct _OscatsAlgMaxPwFisher {
+  OscatsAlgorithm parent_instance;
+  /*< private >*/
+  OscatsAlgChooser *chooser;
+  OscatsRng *rng, *stream;
+  GQuark modelKey;
+  guint grid_points;
+  gdouble grid_min, grid_max, mu, sigma;
+  OscatsPoint *theta;			// grid point
+  GGslMatrix *I;			// 1 x 1, for direct calculation
+  guint base_num;
+  gdouble *logw;			// log posterior (unnormalized)
+  gdouble *w;				// normalized posterior of active points
+  guint *active, num_active;		// grid points spanning non-negligible weight
+  gdouble *table;			// number of items x grid_points
+  guint table_num;			// number of items in table
+  gdouble *values;			// criterion, by bank index
+};
+
+struct _OscatsAlgMaxPwFisherClass {
+  OscatsAlgorithmClass parent_class;
+};
+
+GType oscats_alg_max_pw_fisher_get_type();
+
+G_END_DECLS
+#endif
@@ -22,25 +22,112 @@
 
 G_DEFINE_TYPE(OscatsAlgPickRand, oscats_alg_pick_rand, OSCATS_TYPE_ALGORITHM);
 
+enum
+{
+  PROP_0,
+  PROP_RNG,
+};
+
+static void oscats_alg_pick_rand_dispose (GObject *object);
+static void oscats_alg_pick_rand_set_property(GObject *object,
+              guint prop_id, const GValue *value, GParamSpec *pspec);
+static void oscats_alg_pick_rand_get_property(GObject *object,
+              guint prop_id, GValue *value, GParamSpec *pspec);
 static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test);
 
 static void oscats_alg_pick_rand_class_init (OscatsAlgPickRandClass *klass)
 {
-//  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+  GParamSpec *pspec;
+
+  gobject_class->dispose = oscats_alg_pick_rand_dispose;
+  gobject_class->set_property = oscats_alg_pick_rand_set_property;
+  gobject_class->get_property = oscats_alg_pick_rand_get_property;
 
   OSCATS_ALGORITHM_CLASS(klass)->reg = alg_register;
+
+/**
+ * OscatsAlgPickRand:rng:
+ *
+ * The random number generator for picking items.  If %NULL, the
+ * library-wide generator is used.  Otherwise, each examinee's items are
+ * picked with a substream of @rng determined by the examinee's id
+ * [see oscats_algorithm_examinee_rng()].  The items are reproducible
+ * between runs only if the examinees are given explicit ids.
+ */
+  pspec = g_param_spec_object("rng", "Random number generator", 
+                            "Generator for picking items",
+                            OSCATS_TYPE_RNG,
+                            G_PARAM_READWRITE |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_RNG, pspec);
+
 }
 
 static void oscats_alg_pick_rand_init (OscatsAlgPickRand *self)
 {
 }
 
+static void oscats_alg_pick_rand_dispose (GObject *object)
+{
+  OscatsAlgPickRand *self = OSCATS_ALG_PICK_RAND(object);
+  G_OBJECT_CLASS(oscats_alg_pick_rand_parent_class)->dispose(object);
+  if (self->rng) g_object_unref(self->rng);
+  if (self->stream) g_object_unref(self->stream);
+  self->rng = self->stream = NULL;
+}
+
+static void oscats_alg_pick_rand_set_property(GObject *object,
+              guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+  OscatsAlgPickRand *self = OSCATS_ALG_PICK_RAND(object);
+  switch (prop_id)
+  {
+    case PROP_RNG:
+      if (self->rng) g_object_unref(self->rng);
+      self->rng = g_value_dup_object(value);
+      break;
+    
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+static void oscats_alg_pick_rand_get_property(GObject *object,
+              guint prop_id, GValue *value, GParamSpec *pspec)
+{
+  OscatsAlgPickRand *self = OSCATS_ALG_PICK_RAND(object);
+  switch (prop_id)
+  {
+    case PROP_RNG:
+      g_value_set_object(value, self->rng);
+      break;
+    
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+static void initialize (OscatsTest *test, OscatsExaminee *e, gpointer alg_data)
+{
+  OscatsAlgPickRand *self = OSCATS_ALG_PICK_RAND(alg_data);
+  if (self->rng)
+    self->stream = oscats_algorithm_examinee_rng(alg_data, self->rng,
+                                                 self->stream, e);
+}
+
 static gint select (OscatsTest *test, OscatsExaminee *e,
                     GBitArray *eligible, gpointer alg_data)
 {
+  OscatsAlgPickRand *self = OSCATS_ALG_PICK_RAND(alg_data);
   guint i, item = 0;
   g_return_val_if_fail(eligible->num_set > 0, -1);
-  i = oscats_rnd_uniform_int_range(1, eligible->num_set);
+  i = ( self->rng ?
+        oscats_rng_uniform_int_range(self->stream, 1, eligible->num_set) :
+        oscats_rnd_uniform_int_range(1, eligible->num_set) );
   g_bit_array_iter_reset(eligible);
   for (; i; i--) item = g_bit_array_iter_next(eligible);
   return item;
@@ -55,7 +142,10 @@ static gint select (OscatsTest *test, OscatsExaminee *e,
  */
 static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test)
 {
-  g_signal_connect_data(test, "select", G_CALLBACK(select),
-                        alg_data, oscats_algorithm_closure_finalize, 0);
+  oscats_test_connect_native(test, "select", G_CALLBACK(select),
+                             alg_data, oscats_algorithm_closure_finalize);
+  g_object_ref(alg_data);
+  oscats_test_connect_native(test, "initialize", G_CALLBACK(initialize),
+                             alg_data, oscats_algorithm_closure_finalize);
 }
                    
@@ -40,6 +40,8 @@ typedef struct _OscatsAlgPickRandClass OscatsAlgPickRandClass;
  */
 struct _OscatsAlgPickRand {
   OscatsAlgorithm parent_instance;
+  /*< private >*/
+  OscatsRng *rng, *stream;
 };
 
 struct _OscatsAlgPickRandClass {
@@ -28,8 +28,10 @@ enum
   PROP_AUTO_RECORD,
   PROP_MODEL_KEY,
   PROP_THETA_KEY,
+  PROP_RNG,
 };
 
+static void oscats_alg_simulate_dispose (GObject *object);
 static void oscats_alg_set_property(GObject *object, guint prop_id,
                                     const GValue *value, GParamSpec *pspec);
 static void oscats_alg_get_property(GObject *object, guint prop_id,
@@ -41,6 +43,7 @@ static void oscats_alg_simulate_class_init (OscatsAlgSimulateClass *klass)
   GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
   GParamSpec *pspec;
   
+  gobject_class->dispose = oscats_alg_simulate_dispose;
   gobject_class->set_property = oscats_alg_set_property;
   gobject_class->get_property = oscats_alg_get_property;
 
@@ -87,12 +90,38 @@ static void oscats_alg_simulate_class_init (OscatsAlgSimulateClass *klass)
                             G_PARAM_STATIC_BLURB);
   g_object_class_install_property(gobject_class, PROP_THETA_KEY, pspec);
 
+/**
+ * OscatsAlgSimulate:rng:
+ *
+ * The random number generator for simulating responses.  If %NULL, the
+ * library-wide generator [see oscats_rnd_uniform()] is used.  Otherwise,
+ * each examinee's responses are drawn from a substream of @rng
+ * determined by the examinee's id [see oscats_algorithm_examinee_rng()],
+ * so examinees should be given distinct, explicit ids.
+ */
+  pspec = g_param_spec_object("rng", "Random number generator", 
+                            "Generator for simulated responses",
+                            OSCATS_TYPE_RNG,
+                            G_PARAM_READWRITE |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_RNG, pspec);
+
 }
 
 static void oscats_alg_simulate_init (OscatsAlgSimulate *self)
 {
 }
 
+static void oscats_alg_simulate_dispose (GObject *object)
+{
+  OscatsAlgSimulate *self = OSCATS_ALG_SIMULATE(object);
+  G_OBJECT_CLASS(oscats_alg_simulate_parent_class)->dispose(object);
+  if (self->rng) g_object_unref(self->rng);
+  if (self->stream) g_object_unref(self->stream);
+  self->rng = self->stream = NULL;
+}
+
 static void oscats_alg_set_property(GObject *object, guint prop_id,
                                     const GValue *value, GParamSpec *pspec)
 {
@@ -119,6 +148,11 @@ static void oscats_alg_set_property(GObject *object, guint prop_id,
     }
       break;
     
+    case PROP_RNG:
+      if (self->rng) g_object_unref(self->rng);
+      self->rng = g_value_dup_object(value);
+      break;
+    
     default:
       // Unknown property
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -146,6 +180,10 @@ static void oscats_alg_get_property(GObject *object, guint prop_id,
                          g_quark_to_string(self->thetaKey) : "");
       break;
     
+    case PROP_RNG:
+      g_value_set_object(value, self->rng);
+      break;
+    
     default:
       // Unknown property
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -153,6 +191,14 @@ static void oscats_alg_get_property(GObject *object, guint prop_id,
   }
 }
 
+static void initialize (OscatsTest *test, OscatsExaminee *e, gpointer alg_data)
+{
+  OscatsAlgSimulate *self = OSCATS_ALG_SIMULATE(alg_data);
+  if (self->rng)
+    self->stream = oscats_algorithm_examinee_rng(alg_data, self->rng,
+                                                 self->stream, e);
+}
+
 static guint administer (OscatsTest *test, OscatsExaminee *e,
                          OscatsItem *item, gpointer alg_data)
 {
@@ -162,7 +208,8 @@ static guint administer (OscatsTest *test, OscatsExaminee *e,
                            oscats_examinee_get_theta(e, self->thetaKey) :
                            oscats_examinee_get_sim_theta(e) );
   guint resp, max = oscats_model_get_max(model);
-  gdouble p, rnd = oscats_rnd_uniform();
+  gdouble p, rnd = ( self->rng ? oscats_rng_uniform(self->stream) :
+                                   oscats_rnd_uniform() );
   for (resp=0; resp <= max; resp++)
     if (rnd < (p=oscats_model_P(model, resp, theta, e->covariates)))
     {
@@ -185,7 +232,10 @@ static guint administer (OscatsTest *test, OscatsExaminee *e,
  */
 static void alg_register (OscatsAlgorithm *alg_data, OscatsTest *test)
 {
-  g_signal_connect_data(test, "administer", G_CALLBACK(administer),
-                        alg_data, oscats_algorithm_closure_finalize, 0);
+  oscats_test_connect_native(test, "administer", G_CALLBACK(administer),
+                             alg_data, oscats_algorithm_closure_finalize);
+  g_object_ref(alg_data);
+  oscats_test_connect_native(test, "initialize", G_CALLBACK(initialize),
+                             alg_data, oscats_algorithm_closure_finalize);
 }
                    
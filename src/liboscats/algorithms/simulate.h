@@ -43,6 +43,8 @@ struct _OscatsAlgSimulate {
   OscatsAlgorithm parent_instance;
   gboolean record;
   GQuark modelKey, thetaKey;
+  /*< private >*/
+  OscatsRng *rng, *stream;
 };
 
 struct _OscatsAlgSimulateClass {
@@ -79,8 +79,12 @@ static void oscats_alg_stratify_dispose (GObject *object)
   G_OBJECT_CLASS(oscats_alg_stratify_parent_class)->dispose(object);
   if (self->bank) g_object_unref(self->bank);
   if (self->strata) g_ptr_array_unref(self->strata);
+  if (self->entries) g_ptr_array_unref(self->entries);
+  if (self->order) g_sequence_free(self->order);
+  if (self->blocks) g_ptr_array_unref(self->blocks);
   self->bank = NULL;
-  self->strata = NULL;
+  self->strata = self->entries = self->blocks = NULL;
+  self->order = NULL;
 }
 
 static void oscats_alg_stratify_set_property(GObject *object,
@@ -121,17 +125,162 @@ static void oscats_alg_stratify_get_property(GObject *object,
   }
 }
 
+#define NONE G_MAXUINT
+
+// The stratification state of one item in the bank
 typedef struct
 {
   guint item;
-  gdouble val;
-} Pair;
+  gdouble val, bval;		// stratification and block criteria
+  guint block, stratum;		// NONE if not stratified
+  GSequenceIter *order_iter, *block_iter;
+} Entry;
+
+// Ties are broken by item index so that the strata are reproducible
+static gint entry_compare(gconstpointer A, gconstpointer B, gpointer data)
+{
+  const Entry *a = A, *b = B;
+  if (a->val != b->val) return (a->val < b->val ? -1 : 1);
+  if (a->item == b->item) return 0;
+  return (a->item < b->item ? -1 : 1);
+}
+
+static gint entry_block_compare(gconstpointer A, gconstpointer B,
+                                gpointer data)
+{
+  const Entry *a = A, *b = B;
+  if (a->bval != b->bval) return (a->bval < b->bval ? -1 : 1);
+  if (a->item == b->item) return 0;
+  return (a->item < b->item ? -1 : 1);
+}
+
+static gint entry_ptr_compare(gconstpointer A, gconstpointer B, gpointer data)
+{
+  return entry_compare(*(Entry**)A, *(Entry**)B, data);
+}
+
+static gint entry_ptr_block_compare(gconstpointer A, gconstpointer B,
+                                    gpointer data)
+{
+  return entry_block_compare(*(Entry**)A, *(Entry**)B, data);
+}
+
+/*
+ * n ordered items are divided into parts of sizes n/parts, rounded down
+ * for the first parts and up for the last n%parts parts.
+ * part_of() gives the part of the item with rank k; part_start() the rank
+ * of the first item in part p.
+ */
+static guint part_of(guint k, guint n, guint parts)
+{
+  guint q = n/parts, r = n%parts, B = (parts-r)*q;
+  if (k < B) return k/q;
+  return (parts-r) + (k-B)/(q+1);
+}
+
+static guint part_start(guint p, guint n, guint parts)
+{
+  guint q = n/parts, r = n%parts;
+  if (p <= parts-r) return p*q;
+  return (parts-r)*q + (p-(parts-r))*(q+1);
+}
+
+static void set_stratum(OscatsAlgStratify *self, Entry *e, guint s)
+{
+  if (e->stratum == s) return;
+  if (e->stratum != NONE)
+    g_bit_array_clear_bit(self->strata->pdata[e->stratum], e->item);
+  if (s != NONE)
+    g_bit_array_set_bit(self->strata->pdata[s], e->item);
+  e->stratum = s;
+}
+
+/*
+ * After one item has been inserted into or removed from an ordered
+ * sequence, an item can only change parts if its new rank is within two
+ * of a part boundary, since neither the ranks nor the boundaries move by
+ * more than one.  So only a few items around each boundary need checking.
+ */
+static void fix_block(OscatsAlgStratify *self, guint b)
+{
+  GSequence *seq = self->blocks->pdata[b];
+  guint n_strata = self->strata->len;
+  guint m = g_sequence_get_length(seq);
+  guint s, k, D;
+  for (s=1; s < n_strata; s++)
+  {
+    D = part_start(s, m, n_strata);
+    for (k = (D > 2 ? D-2 : 0); k < D+2 && k < m; k++)
+      set_stratum(self, g_sequence_get(g_sequence_get_iter_at_pos(seq, k)),
+                  part_of(k, m, n_strata));
+  }
+}
 
-static gint pair_compare(gconstpointer A, gconstpointer B)
+static void block_insert(OscatsAlgStratify *self, Entry *e, guint b)
 {
-  const Pair *a = A, *b = B;
-  if (a->val == b->val) return 0;
-  return (a->val < b->val ? -1 : 1);
+  GSequence *seq = self->blocks->pdata[b];
+  e->block = b;
+  e->block_iter = g_sequence_insert_sorted(seq, e, entry_compare, NULL);
+  set_stratum(self, e, part_of(g_sequence_iter_get_position(e->block_iter),
+                               g_sequence_get_length(seq),
+                               self->strata->len));
+  fix_block(self, b);
+}
+
+static void block_remove(OscatsAlgStratify *self, Entry *e)
+{
+  set_stratum(self, e, NONE);
+  g_sequence_remove(e->block_iter);
+  e->block_iter = NULL;
+  fix_block(self, e->block);
+  e->block = NONE;
+}
+
+// Moves items whose block has changed, as for fix_block()
+static void fix_order(OscatsAlgStratify *self)
+{
+  guint n_blocks = self->blocks->len;
+  guint n = g_sequence_get_length(self->order);
+  guint b, k, D, new_b;
+  Entry *e;
+  for (b=1; b < n_blocks; b++)
+  {
+    D = part_start(b, n, n_blocks);
+    for (k = (D > 2 ? D-2 : 0); k < D+2 && k < n; k++)
+    {
+      e = g_sequence_get(g_sequence_get_iter_at_pos(self->order, k));
+      new_b = part_of(k, n, n_blocks);
+      if (e->block != new_b)
+      {
+        block_remove(self, e);
+        block_insert(self, e, new_b);
+      }
+    }
+  }
+}
+
+// Makes sure there is an entry for each item in the bank
+static void grow_entries(OscatsAlgStratify *self)
+{
+  guint i, s, n_items = oscats_item_bank_num_items(self->bank);
+  GPtrArray *entries = self->entries;
+  Entry *e;
+  if (entries->len >= n_items) return;
+  for (i=entries->len; i < n_items; i++)
+  {
+    e = g_new0(Entry, 1);
+    e->item = i;
+    e->block = e->stratum = NONE;
+    g_ptr_array_add(entries, e);
+  }
+  // Extend rather than resize, so existing members stay in their strata
+  for (s=0; s < self->strata->len; s++)
+  {
+    GBitArray *stratum = self->strata->pdata[s];
+    guint num_set = g_bit_array_get_num_set(stratum);
+    g_bit_array_extend(stratum, n_items - g_bit_array_get_len(stratum));
+    g_warn_if_fail(g_bit_array_get_num_set(stratum) == num_set);
+  }
 }
 
 /**
@@ -146,16 +295,23 @@ static gint pair_compare(gconstpointer A, gconstpointer B)
  *
  * Stratify the #OscatsAlgStratify:itembank of @stratify using the criterion
  * @f within blocks specified by @block.  The bank can be restratified by
- * calling this function multiple times.
+ * calling this function multiple times.  Each criterion is evaluated once
+ * per item, and items are ordered by sorting, so stratification takes
+ * O(n log n) time for a bank of n items.  Items with equal criteria are
+ * ordered by their position in the bank.
+ *
+ * The ordering is kept, so that individual items may later be taken out
+ * of or put back into the strata with oscats_alg_stratify_remove_item()
+ * and oscats_alg_stratify_add_item().
  */
 void oscats_alg_stratify_stratify(OscatsAlgStratify *stratify,
            guint n_strata, OscatsAlgStratifyCriterion f,     gpointer f_data,
            guint n_blocks, OscatsAlgStratifyCriterion block, gpointer b_data)
 {
   GBitArray **strata;
-  Pair *pairs;
-  GList *blocks_p, *items_p, *items, *blocks = NULL;
-  guint i, b, s, n_items, rem, block_size, stratum_size;
+  GSequence *seq;
+  Entry *e, **sorted, **block_p;
+  guint i, j, b, s, n_items, rem, block_size;
 
   g_return_if_fail(OSCATS_IS_ALG_STRATIFY(stratify));
   g_return_if_fail(OSCATS_IS_ITEM_BANK(stratify->bank));
@@ -165,6 +321,11 @@ void oscats_alg_stratify_stratify(OscatsAlgStratify *stratify,
   else n_blocks = 1;
   n_items = oscats_item_bank_num_items(stratify->bank);
   g_return_if_fail(n_items > 0);
+
+  stratify->f = f;
+  stratify->f_data = f_data;
+  stratify->block = block;
+  stratify->b_data = b_data;
   
   // Reset the bit arrays
   if (stratify->strata == NULL)
@@ -175,48 +336,151 @@ void oscats_alg_stratify_stratify(OscatsAlgStratify *stratify,
   for (s=0; s < n_strata; s++)
   {
     if (strata[s] == NULL) strata[s] = g_bit_array_new(n_items);
+    else if (g_bit_array_get_len(strata[s]) != n_items)
+      g_bit_array_resize(strata[s], n_items);
     g_bit_array_reset(strata[s], FALSE);
   }
+
+  // Reset the orderings
+  if (stratify->entries) g_ptr_array_unref(stratify->entries);
+  if (stratify->order) g_sequence_free(stratify->order);
+  if (stratify->blocks) g_ptr_array_unref(stratify->blocks);
+  stratify->entries = g_ptr_array_new_with_free_func(g_free);
+  stratify->order = g_sequence_new(NULL);
+  stratify->blocks = g_ptr_array_new_with_free_func(
+                       (GDestroyNotify)g_sequence_free);
+  grow_entries(stratify);
   
-  // Compute the block criteria
-  pairs = g_new(Pair, n_items);
-  g_return_if_fail(pairs != NULL);
+  // Compute the block criteria and sort into blocks
+  sorted = g_new(Entry*, n_items);
   for (i=0; i < n_items; i++)
   {
-    pairs[i].item = i;
+    e = sorted[i] = stratify->entries->pdata[i];
     if (n_blocks > 1)
-      pairs[i].val = block(oscats_item_bank_get_item(stratify->bank, i), b_data);
+      e->bval = block(oscats_item_bank_get_item(stratify->bank, i), b_data);
     else
-      pairs[i].val = 0;
-    blocks = g_list_insert_sorted(blocks, pairs+i, pair_compare);
+      e->bval = 0;
   }
+  if (n_blocks > 1)
+    g_qsort_with_data(sorted, n_items, sizeof(Entry*),
+                      entry_ptr_block_compare, NULL);
+  for (i=0; i < n_items; i++)
+    sorted[i]->order_iter = g_sequence_append(stratify->order, sorted[i]);
     
-  for (b=0, blocks_p=blocks; b < n_blocks; b++, n_items -= block_size)
+  for (b=0, block_p=sorted; b < n_blocks;
+       b++, block_p += block_size, n_items -= block_size)
   {
-    items = NULL;
     block_size = n_items/(n_blocks-b);
+    seq = g_sequence_new(NULL);
+    g_ptr_array_add(stratify->blocks, seq);
 
-    // Compute the stratification criteria
-    for (i=0; i < block_size; i++, blocks_p = g_list_next(blocks_p))
-    {
-      Pair *pair = blocks_p->data;
-      pair->val = f(oscats_item_bank_get_item(stratify->bank, pair->item), f_data);
-      items = g_list_insert_sorted(items, pair, pair_compare);
-    }
+    // Compute the stratification criteria and sort within the block
+    for (i=0; i < block_size; i++)
+      block_p[i]->val = f(oscats_item_bank_get_item(stratify->bank,
+                                                    block_p[i]->item), f_data);
+    g_qsort_with_data(block_p, block_size, sizeof(Entry*),
+                      entry_ptr_compare, NULL);
 
     // Divide into strata
-    items_p = items;
-    for (s=0, rem=block_size; s < n_strata; s++, rem -= stratum_size)
-      for (i=0, stratum_size=rem/(n_strata-s);
-           i < stratum_size;
-           i++, items_p = g_list_next(items_p))
-        g_bit_array_set_bit(strata[s], ((Pair*)(items_p->data))->item);
-
-    g_list_free(items);
+    for (s=0, i=0, rem=block_size; s < n_strata; s++)
+    {
+      guint stratum_size = rem/(n_strata-s);
+      for (j=0; j < stratum_size; j++, i++)
+      {
+        e = block_p[i];
+        e->block = b;
+        e->block_iter = g_sequence_append(seq, e);
+        set_stratum(stratify, e, s);
+      }
+      rem -= stratum_size;
+    }
   }
   
-  g_list_free(blocks);
-  g_free(pairs);
+  g_free(sorted);
+}
+
+/**
+ * oscats_alg_stratify_remove_item:
+ * @stratify: a stratified #OscatsAlgStratify object
+ * @item: the index of the item in #OscatsAlgStratify:itembank
+ *
+ * Takes @item out of the strata (for example, to retire an overexposed
+ * item), adjusting the strata so that they are the same as if @item had
+ * not been present when the bank was stratified.  Only the items at the
+ * block and stratum boundaries are moved, so this takes O(log n) time for
+ * a bank of n items.  The item remains in the bank.  If @item is not in
+ * any stratum, nothing is done.
+ */
+void oscats_alg_stratify_remove_item(OscatsAlgStratify *stratify, guint item)
+{
+  Entry *e;
+  g_return_if_fail(OSCATS_IS_ALG_STRATIFY(stratify));
+  g_return_if_fail(stratify->order != NULL);
+  if (item >= stratify->entries->len) return;
+  e = stratify->entries->pdata[item];
+  if (e->order_iter == NULL) return;
+  block_remove(stratify, e);
+  g_sequence_remove(e->order_iter);
+  e->order_iter = NULL;
+  fix_order(stratify);
+}
+
+/**
+ * oscats_alg_stratify_add_item:
+ * @stratify: a stratified #OscatsAlgStratify object
+ * @item: the index of the item in #OscatsAlgStratify:itembank
+ *
+ * Puts @item into the strata, using the criteria from the last call to
+ * oscats_alg_stratify_stratify(), adjusting the strata as for
+ * oscats_alg_stratify_remove_item().  The item's criteria are evaluated
+ * anew, so an item whose parameters have changed may be restratified by
+ * removing and adding it again.  @item may have been added to the bank
+ * after the bank was stratified, but items may not have been removed from
+ * the bank.  If @item is already stratified, nothing is done.
+ */
+void oscats_alg_stratify_add_item(OscatsAlgStratify *stratify, guint item)
+{
+  const OscatsAdministrand *admin;
+  Entry *e;
+  guint n_blocks;
+  g_return_if_fail(OSCATS_IS_ALG_STRATIFY(stratify));
+  g_return_if_fail(stratify->order != NULL);
+  g_return_if_fail(item < oscats_item_bank_num_items(stratify->bank));
+  grow_entries(stratify);
+  e = stratify->entries->pdata[item];
+  if (e->order_iter) return;
+  admin = oscats_item_bank_get_item(stratify->bank, item);
+  n_blocks = stratify->blocks->len;
+  e->bval = (n_blocks > 1 ? stratify->block(admin, stratify->b_data) : 0);
+  e->val = stratify->f(admin, stratify->f_data);
+  e->order_iter = g_sequence_insert_sorted(stratify->order, e,
+                                           entry_block_compare, NULL);
+  block_insert(stratify, e,
+               part_of(g_sequence_iter_get_position(e->order_iter),
+                       g_sequence_get_length(stratify->order), n_blocks));
+  fix_order(stratify);
+}
+
+/**
+ * oscats_alg_stratify_has_item:
+ * @stratify: a stratified #OscatsAlgStratify object
+ * @item: the index of the item in #OscatsAlgStratify:itembank
+ *
+ * Items taken out with oscats_alg_stratify_remove_item() and items added
+ * to the bank after stratification (but not yet put in with
+ * oscats_alg_stratify_add_item()) are not in any stratum.  Algorithms that
+ * keep an #OscatsAlgStratify use this to carry the removed items over to
+ * their clones [see oscats_algorithm_clone()].
+ *
+ * Returns: %TRUE if @item is in one of the strata
+ */
+gboolean oscats_alg_stratify_has_item(const OscatsAlgStratify *stratify,
+                                      guint item)
+{
+  g_return_val_if_fail(OSCATS_IS_ALG_STRATIFY(stratify), FALSE);
+  g_return_val_if_fail(stratify->order != NULL, FALSE);
+  if (item >= stratify->entries->len) return FALSE;
+  return ((Entry*)stratify->entries->pdata[item])->order_iter != NULL;
 }
                                       
 /**
@@ -46,6 +46,12 @@ struct _OscatsAlgStratify {
   OscatsItemBank *bank;
   GPtrArray *strata;
   guint next;
+  /*< private >*/
+  OscatsAlgStratifyCriterion f, block;
+  gpointer f_data, b_data;
+  GPtrArray *entries;		// stratification state of each item
+  GSequence *order;		// stratified items by block criterion
+  GPtrArray *blocks;		// for each block, items by criterion
 };
 
 struct _OscatsAlgStratifyClass {
@@ -57,6 +63,10 @@ GType oscats_alg_stratify_get_type();
 void oscats_alg_stratify_stratify(OscatsAlgStratify *stratify,
            guint n_strata, OscatsAlgStratifyCriterion f,     gpointer f_data,
            guint n_blocks, OscatsAlgStratifyCriterion block, gpointer b_data);
+void oscats_alg_stratify_remove_item(OscatsAlgStratify *stratify, guint item);
+void oscats_alg_stratify_add_item(OscatsAlgStratify *stratify, guint item);
+gboolean oscats_alg_stratify_has_item(const OscatsAlgStratify *stratify,
+                                      guint item);
 GBitArray * oscats_alg_stratify_get_stratum(const OscatsAlgStratify *stratify, guint stratum);
 void oscats_alg_stratify_reset(OscatsAlgStratify *stratify);
 GBitArray * oscats_alg_stratify_next(OscatsAlgStratify *stratify);
@@ -22,10 +22,38 @@
  * @short_description: An array of bit flags
  */
 
+#include <string.h>
 #include "bitarray.h"
 
 G_DEFINE_TYPE(GBitArray, g_bit_array, G_TYPE_OBJECT);
 
+#define WORD_BITS 64
+#define WORD_ONES (~G_GUINT64_CONSTANT(0))
+#define WORD(pos) ((pos) / WORD_BITS)
+#define BIT(pos) (G_GUINT64_CONSTANT(1) << ((pos) & (WORD_BITS-1)))
+
+#ifdef __GNUC__
+#define popcount(w) __builtin_popcountll(w)
+#define ctz(w) __builtin_ctzll(w)
+#else
+static inline guint popcount(guint64 w)
+{
+  w = w - ((w >> 1) & G_GUINT64_CONSTANT(0x5555555555555555));
+  w = (w & G_GUINT64_CONSTANT(0x3333333333333333)) +
+      ((w >> 2) & G_GUINT64_CONSTANT(0x3333333333333333));
+  w = (w + (w >> 4)) & G_GUINT64_CONSTANT(0x0f0f0f0f0f0f0f0f);
+  return (w * G_GUINT64_CONSTANT(0x0101010101010101)) >> 56;
+}
+
+// w must be non-zero
+static inline guint ctz(guint64 w)
+{
+  guint n = 0;
+  while (!(w & 0x1)) { w >>= 1; n++; }
+  return n;
+}
+#endif
+
 static void g_bit_array_finalize (GObject *object);
 
 static void g_bit_array_class_init (GBitArrayClass *klass)
@@ -47,18 +75,22 @@ static void g_bit_array_finalize (GObject *object)
   G_OBJECT_CLASS(g_bit_array_parent_class)->finalize(object);
 }
 
+// Note: bits past bit_len in the last word are always kept clear
 static void count_bits(GBitArray *array)
 {
-  guint i, pos, num=0, max = array->bit_len;
-  guint8 mask=0x1;
-  for (pos=0, i=0; i < max; i++, mask <<=1)
-  {
-    if (!mask) { pos++; mask = 0x1; }
-    if (array->data[pos] & mask) num++;
-  }
+  guint i, num=0;
+  for (i=0; i < array->word_len; i++)
+    num += popcount(array->data[i]);
   array->num_set = num;
 }
 
+// Mask of the valid bits in the last word
+static inline guint64 tail_mask(const GBitArray *array)
+{
+  guint n = array->bit_len & (WORD_BITS-1);
+  return (n ? WORD_ONES >> (WORD_BITS - n) : WORD_ONES);
+}
+
 /**
  * g_bit_array_new:
  * @bit_length: the number of bits
@@ -91,11 +123,11 @@ GBitArray* g_bit_array_resize(GBitArray* array, guint bit_length)
   g_return_val_if_fail(G_IS_BIT_ARRAY(array), NULL);
   g_free(array->data);
   array->bit_len = bit_length;
-  array->byte_len = bit_length / 8;
-  if (bit_length & 0x7) array->byte_len++;
-  if (array->byte_len > 0) array->data = g_new0(guint8, array->byte_len);
+  array->word_len = bit_length / WORD_BITS;
+  if (bit_length & (WORD_BITS-1)) array->word_len++;
+  if (array->word_len > 0) array->data = g_new0(guint64, array->word_len);
   else array->data = NULL;
-  array->byte_pos = array->byte_len+1;
+  array->word_pos = array->word_len;
   array->num_set = 0;
   return array;
 }
@@ -112,31 +144,20 @@ GBitArray* g_bit_array_resize(GBitArray* array, guint bit_length)
  */
 GBitArray* g_bit_array_extend(GBitArray* array, guint num)
 {
-  guint8 *data;
   guint i, n;
   g_return_val_if_fail(G_IS_BIT_ARRAY(array), NULL);
   if (num == 0) return array;
-  i = array->bit_len;
-  if (i & 0x7)
+  array->bit_len += num;
+  n = array->bit_len / WORD_BITS;	// New word count
+  if (array->bit_len & (WORD_BITS-1)) n++;
+  if (n > array->word_len)
   {
-    n = 8-(i & 0x7);			// Bits remaining in last byte
-    if (n > num) n = num;
-    array->bit_len += n;
-    num -= n;
-    if (num == 0) return array;
-    i += n;
+    // Unused bits of the old last word are already clear
+    array->data = g_renew(guint64, array->data, n);
+    for (i=array->word_len; i < n; i++)
+      array->data[i] = 0;
+    array->word_len = n;
   }
-  n = (i + num)/8;			// New byte count
-  if ((i + num) & 0x7) n++;
-  data = g_new(guint8, n);
-  for (i=0; i < array->byte_len; i++)	// Copy old bits
-    data[i] = array->data[i];
-  for (; i < n; i++)			// Clear new bits
-    data[i] = 0;
-  g_free(array->data);
-  array->data = data;
-  array->bit_len += num;
-  array->byte_len = n;
   return array;
 }
 
@@ -149,12 +170,11 @@ GBitArray* g_bit_array_extend(GBitArray* array, guint num)
  */
 void g_bit_array_copy(GBitArray *lhs, const GBitArray *rhs)
 {
-  guint i;
   g_return_if_fail(G_IS_BIT_ARRAY(lhs) && G_IS_BIT_ARRAY(rhs));
-  if (lhs->byte_len != rhs->byte_len)
+  if (lhs->bit_len != rhs->bit_len)
     g_bit_array_resize(lhs, rhs->bit_len);
-  for (i=0; i < rhs->byte_len; i++)
-    lhs->data[i] = rhs->data[i];
+  if (rhs->word_len > 0)
+    memcpy(lhs->data, rhs->data, rhs->word_len * sizeof(guint64));
   lhs->num_set = rhs->num_set;
 }
 
@@ -198,7 +218,7 @@ gboolean g_bit_array_get_bit(const GBitArray* array, guint pos)
 {
   g_return_val_if_fail(G_IS_BIT_ARRAY(array), FALSE);
   g_return_val_if_fail(pos < array->bit_len, FALSE);
-  return array->data[pos/8] & (0x1 << (pos & 0x7));
+  return (array->data[WORD(pos)] & BIT(pos)) != 0;
 }
 
 /**
@@ -213,10 +233,10 @@ gboolean g_bit_array_get_bit(const GBitArray* array, guint pos)
  */
 GBitArray* g_bit_array_set_bit(GBitArray* array, guint pos)
 {
-  guint8 mask = (0x1 << (pos & 0x7));
+  guint64 mask = BIT(pos);
   g_return_val_if_fail(G_IS_BIT_ARRAY(array), NULL);
   g_return_val_if_fail(pos < array->bit_len, NULL);
-  pos /= 8;
+  pos = WORD(pos);
   if (!(array->data[pos] & mask))
   {
     array->num_set++;
@@ -237,10 +257,10 @@ GBitArray* g_bit_array_set_bit(GBitArray* array, guint pos)
  */
 GBitArray* g_bit_array_clear_bit(GBitArray* array, guint pos)
 {
-  guint8 mask = (0x1 << (pos & 0x7));
+  guint64 mask = BIT(pos);
   g_return_val_if_fail(G_IS_BIT_ARRAY(array), NULL);
   g_return_val_if_fail(pos < array->bit_len, NULL);
-  pos /= 8;
+  pos = WORD(pos);
   if (array->data[pos] & mask)
   {
     array->num_set--;
@@ -261,14 +281,14 @@ GBitArray* g_bit_array_clear_bit(GBitArray* array, guint pos)
  */
 gboolean g_bit_array_flip_bit(GBitArray* array, guint pos)
 {
-  guint8 mask = (0x1 << (pos & 0x7));
+  guint64 mask = BIT(pos);
   g_return_val_if_fail(G_IS_BIT_ARRAY(array), FALSE);
   g_return_val_if_fail(pos < array->bit_len, FALSE);
-  pos /= 8;
+  pos = WORD(pos);
   if (array->data[pos] & mask) array->num_set--;
   else                         array->num_set++;
   array->data[pos] ^= mask;
-  return array->data[pos] & mask;
+  return (array->data[pos] & mask) != 0;
 }
 
 /**
@@ -288,6 +308,17 @@ GBitArray* g_bit_array_set_bit_val(GBitArray* array, guint pos, gboolean val)
   else return g_bit_array_clear_bit(array, pos);
 }
 
+// Sets (or clears) the bits of mask in word i, keeping num_set current
+static inline void set_word_mask(GBitArray *array, guint i, guint64 mask,
+                                 gboolean val)
+{
+  guint64 w = array->data[i];
+  array->num_set -= popcount(w);
+  w = (val ? w | mask : w & ~mask);
+  array->num_set += popcount(w);
+  array->data[i] = w;
+}
+
 /**
  * g_bit_array_set_range:
  * @array: a #GBitArray
@@ -303,29 +334,27 @@ GBitArray* g_bit_array_set_bit_val(GBitArray* array, guint pos, gboolean val)
 GBitArray* g_bit_array_set_range(GBitArray* array, guint start, guint stop,
                                  gboolean val)
 {
-  static const guint8 masks[] = { 255, 254, 252, 248, 240, 224, 192, 128, 0 };
-  guint8 V = (val ? 255 : 0);
+  guint64 first, last;
   guint i;
   g_return_val_if_fail(G_IS_BIT_ARRAY(array), NULL);
   g_return_val_if_fail(start <= stop && stop < array->bit_len, NULL);
-  if (start/8 == stop/8)			// Only within one byte
+  first = WORD_ONES << (start & (WORD_BITS-1));
+  last = WORD_ONES >> (WORD_BITS-1 - (stop & (WORD_BITS-1)));
+  start = WORD(start);
+  stop = WORD(stop);
+  if (start == stop)			// Only within one word
   {
-    for (i=start; i <= stop; i++)
-      g_bit_array_set_bit_val(array, i, val);
+    set_word_mask(array, start, first & last, val);
     return array;
   }
-  if (val)
+  set_word_mask(array, start, first, val);
+  set_word_mask(array, stop, last, val);
+  for (i = start+1; i < stop; i++)
   {
-    array->data[start/8] |= masks[start & 0x7];		// First byte
-    array->data[stop/8] |= ~masks[(stop & 0x7)+1];	// Last byte
-  } else {
-    array->data[start/8] &= ~masks[start & 0x7];	// First byte
-    array->data[stop/8] &= masks[(stop & 0x7)+1];	// Last byte
+    array->num_set -= popcount(array->data[i]);
+    array->data[i] = (val ? WORD_ONES : 0);
   }
-  stop /= 8;
-  for (i = start/8 + 1; i < stop; i++)
-    array->data[i] = V;
-  count_bits(array);
+  if (val) array->num_set += (stop - start - 1) * WORD_BITS;
   return array;
 }
 
@@ -340,11 +369,10 @@ GBitArray* g_bit_array_set_range(GBitArray* array, guint start, guint stop,
  */
 GBitArray* g_bit_array_reset(GBitArray* array, gboolean val)
 {
-  guint8 V = (val ? 255 : 0);
-  guint i;
   g_return_val_if_fail(G_IS_BIT_ARRAY(array), NULL);
-  for (i=0; i < array->byte_len; i++)
-    array->data[i] = V;
+  if (array->word_len == 0) return array;
+  memset(array->data, (val ? 0xff : 0), array->word_len * sizeof(guint64));
+  if (val) array->data[array->word_len-1] &= tail_mask(array);
   array->num_set = (val ? array->bit_len : 0);
   return array;
 }
@@ -364,8 +392,8 @@ gboolean g_bit_array_equal(GBitArray *lhs, GBitArray *rhs)
   g_return_val_if_fail(G_IS_BIT_ARRAY(lhs) && G_IS_BIT_ARRAY(rhs), FALSE);
   if (lhs->bit_len != rhs->bit_len) return FALSE;
   if (lhs->num_set != rhs->num_set) return FALSE;
-  for (i=0; i < lhs->byte_len; i++)
-    if (lhs->data[i] != lhs->data[i]) return FALSE;
+  for (i=0; i < lhs->word_len; i++)
+    if (lhs->data[i] != rhs->data[i]) return FALSE;
   return TRUE;
 }
 
@@ -384,13 +412,117 @@ gint g_bit_array_serial_compare(const GBitArray *a, const GBitArray *b)
   gint i;
   g_return_val_if_fail(G_IS_BIT_ARRAY(a) && G_IS_BIT_ARRAY(b), 0);
   g_return_val_if_fail(a->bit_len == b->bit_len, 0);
-  // Last byte is most significant
-  for (i=a->byte_len-1; i >= 0 && a->data[i] == b->data[i]; i--) ;
+  // Last word is most significant
+  for (i=a->word_len-1; i >= 0 && a->data[i] == b->data[i]; i--) ;
   if (i < 0) return 0;
   if (a->data[i] < b->data[i]) return -1;
   else return 1;
 }
 
+/**
+ * g_bit_array_and:
+ * @lhs: a #GBitArray
+ * @rhs: a #GBitArray of the same length
+ *
+ * Sets @lhs to the bitwise AND of @lhs and @rhs.
+ *
+ * Returns: @lhs
+ */
+GBitArray* g_bit_array_and(GBitArray *lhs, const GBitArray *rhs)
+{
+  guint64 *l;
+  const guint64 *r;
+  guint i, num=0, n;
+  g_return_val_if_fail(G_IS_BIT_ARRAY(lhs) && G_IS_BIT_ARRAY(rhs), NULL);
+  g_return_val_if_fail(lhs->bit_len == rhs->bit_len, NULL);
+  l = lhs->data;  r = rhs->data;  n = lhs->word_len;
+  for (i=0; i < n; i++)
+  {
+    l[i] &= r[i];
+    num += popcount(l[i]);
+  }
+  lhs->num_set = num;
+  return lhs;
+}
+
+/**
+ * g_bit_array_or:
+ * @lhs: a #GBitArray
+ * @rhs: a #GBitArray of the same length
+ *
+ * Sets @lhs to the bitwise OR of @lhs and @rhs.
+ *
+ * Returns: @lhs
+ */
+GBitArray* g_bit_array_or(GBitArray *lhs, const GBitArray *rhs)
+{
+  guint64 *l;
+  const guint64 *r;
+  guint i, num=0, n;
+  g_return_val_if_fail(G_IS_BIT_ARRAY(lhs) && G_IS_BIT_ARRAY(rhs), NULL);
+  g_return_val_if_fail(lhs->bit_len == rhs->bit_len, NULL);
+  l = lhs->data;  r = rhs->data;  n = lhs->word_len;
+  for (i=0; i < n; i++)
+  {
+    l[i] |= r[i];
+    num += popcount(l[i]);
+  }
+  lhs->num_set = num;
+  return lhs;
+}
+
+/**
+ * g_bit_array_andnot:
+ * @lhs: a #GBitArray
+ * @rhs: a #GBitArray of the same length
+ *
+ * Clears every bit of @lhs that is set in @rhs.
+ *
+ * Returns: @lhs
+ */
+GBitArray* g_bit_array_andnot(GBitArray *lhs, const GBitArray *rhs)
+{
+  guint64 *l;
+  const guint64 *r;
+  guint i, num=0, n;
+  g_return_val_if_fail(G_IS_BIT_ARRAY(lhs) && G_IS_BIT_ARRAY(rhs), NULL);
+  g_return_val_if_fail(lhs->bit_len == rhs->bit_len, NULL);
+  l = lhs->data;  r = rhs->data;  n = lhs->word_len;
+  for (i=0; i < n; i++)
+  {
+    l[i] &= ~r[i];
+    num += popcount(l[i]);
+  }
+  lhs->num_set = num;
+  return lhs;
+}
+
+/**
+ * g_bit_array_xor:
+ * @lhs: a #GBitArray
+ * @rhs: a #GBitArray of the same length
+ *
+ * Sets @lhs to the bitwise exclusive OR of @lhs and @rhs.
+ *
+ * Returns: @lhs
+ */
+GBitArray* g_bit_array_xor(GBitArray *lhs, const GBitArray *rhs)
+{
+  guint64 *l;
+  const guint64 *r;
+  guint i, num=0, n;
+  g_return_val_if_fail(G_IS_BIT_ARRAY(lhs) && G_IS_BIT_ARRAY(rhs), NULL);
+  g_return_val_if_fail(lhs->bit_len == rhs->bit_len, NULL);
+  l = lhs->data;  r = rhs->data;  n = lhs->word_len;
+  for (i=0; i < n; i++)
+  {
+    l[i] ^= r[i];
+    num += popcount(l[i]);
+  }
+  lhs->num_set = num;
+  return lhs;
+}
+
 /**
  * g_bit_array_iter_reset:
  * @array: a #GBitArray
@@ -401,8 +533,8 @@ gint g_bit_array_serial_compare(const GBitArray *a, const GBitArray *b)
 void g_bit_array_iter_reset(GBitArray* array)
 {
   g_return_if_fail(G_IS_BIT_ARRAY(array));
-  array->byte_pos = -1;
-  array->bit_pos = 7;
+  array->word_pos = -1;
+  array->bit_pos = WORD_BITS-1;
 }
 
 /**
@@ -416,30 +548,25 @@ void g_bit_array_iter_reset(GBitArray* array)
  */
 gint g_bit_array_iter_next(GBitArray* array)
 {
-  guint8 mask, byte;
-  gint i, max, ret;
+  guint64 word;
+  gint i, max, bit;
   g_return_val_if_fail(G_IS_BIT_ARRAY(array), 0);
-  max = array->byte_len;
-  i = array->byte_pos;
+  max = array->word_len;
+  i = array->word_pos;
   if (i >= max) return -1;
-  mask = (1 << (array->bit_pos+1));	// Increment last position
-  if (mask == 0) { i++; mask = 1; }
-  byte = array->data[i];
-  for (; i < max; )
+  bit = array->bit_pos + 1;		// Increment last position
+  if (bit == WORD_BITS) { i++; bit = 0; }
+  for (; i < max; i++, bit = 0)
   {
-    if (byte & mask)
-    {
-      array->byte_pos = i;
-      for (array->bit_pos=0, mask >>= 1; mask; array->bit_pos++, mask >>= 1) ;
-      ret = i*8 + array->bit_pos;
-      return (ret >= array->bit_len ? -1 : ret);
-    }
-    if ((mask <<= 1) == 0)
+    // Skip the bits already visited in this word
+    word = array->data[i] & (WORD_ONES << bit);
+    if (word)
     {
-      if (++i < max) byte = array->data[i];
-      mask = 1;
+      array->word_pos = i;
+      array->bit_pos = ctz(word);
+      return i*WORD_BITS + array->bit_pos;
     }
   }
-  array->byte_pos = i;
+  array->word_pos = max;
   return -1;
 }
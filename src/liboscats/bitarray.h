@@ -36,9 +36,9 @@ struct _GBitArray {
   /*< read only >*/
   guint num_set;
   /*< private >*/
-  guint8 *data;
-  guint bit_len, byte_len;
-  gint bit_pos, byte_pos;
+  guint64 *data;
+  guint bit_len, word_len;
+  gint bit_pos, word_pos;
 };
 
 struct _GBitArrayClass {
@@ -64,6 +64,11 @@ GBitArray* g_bit_array_reset(GBitArray* array, gboolean val);
 gboolean g_bit_array_equal(GBitArray *lhs, GBitArray *rhs);
 gint g_bit_array_serial_compare(const GBitArray *a, const GBitArray *b);
 
+GBitArray* g_bit_array_and(GBitArray *lhs, const GBitArray *rhs);
+GBitArray* g_bit_array_or(GBitArray *lhs, const GBitArray *rhs);
+GBitArray* g_bit_array_andnot(GBitArray *lhs, const GBitArray *rhs);
+GBitArray* g_bit_array_xor(GBitArray *lhs, const GBitArray *rhs);
+
 void g_bit_array_iter_reset(GBitArray* array);
 gint g_bit_array_iter_next(GBitArray* array);
 
@@ -79,7 +79,8 @@ static void oscats_examinee_class_init (OscatsExamineeClass *klass)
 /**
  * OscatsExaminee:id:
  *
- * A string identifier for the examinee.
+ * A string identifier for the examinee.  If not given, an id based on the
+ * examinee's address is generated, which differs from run to run.
  */
   pspec = g_param_spec_string("id", "ID", 
                             "String identifier for the examinee",
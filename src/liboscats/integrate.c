@@ -22,11 +22,42 @@
  * @short_description: Multivariate Integration
  */
 
+#include <math.h>
 #include "integrate.h"
 #include <gsl/gsl_blas.h>
 #include <gsl/gsl_linalg.h>
+#include <gsl/gsl_eigen.h>
+#include <gsl/gsl_cdf.h>
+#include <gsl/gsl_qrng.h>
 
 #define WS_SIZE 32
+// Bisection depth for batch integration (at most WS_SIZE intervals)
+#define MAX_DEPTH 5
+// Nodes per batch: 15 Gauss-Kronrod nodes, doubled for the infinite range
+#define BATCH_SIZE 30
+// Random shifts (independent replicates) for quasi-Monte Carlo
+#define QMC_SHIFTS 8
+#define QMC_DEFAULT_SIZE 1024
+#define SPARSE_DEFAULT_LEVEL 5
+#define SPARSE_MAX_LEVEL 25
+
+// 15-point Kronrod nodes and weights, and 7-point Gauss weights (QUADPACK)
+static const gdouble xgk[8] = {
+  0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+  0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+  0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+  0.207784955007898467600689403773245, 0.000000000000000000000000000000000
+};
+static const gdouble wgk[8] = {
+  0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+  0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+  0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+  0.204432940075298892414161999234649, 0.209482141084727828012999174891714
+};
+static const gdouble wg[4] = {
+  0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+  0.381830050505118944950369775488975, 0.417959183673469387755102040816327
+};
 
 G_DEFINE_TYPE(OscatsIntegrate, oscats_integrate, G_TYPE_OBJECT);
 
@@ -57,6 +88,9 @@ static void oscats_integrate_clear (OscatsIntegrate *self)
   if (self->z) gsl_vector_free(self->z);
   if (self->mu) gsl_vector_free(self->mu);
   if (self->B) gsl_matrix_free(self->B);
+  g_free(self->nodes);
+  g_free(self->values);
+  g_free(self->qmc);
   if (self->ws)
   {
     guint i;
@@ -70,21 +104,114 @@ static void oscats_integrate_clear (OscatsIntegrate *self)
   self->mu = NULL;
   self->B = NULL;
   self->ws = NULL;
+  self->nodes = self->values = NULL;
+  self->qmc = NULL;
   self->f = NULL;
+  self->batch = NULL;
 }
 
 static void oscats_integrate_finalize (GObject *object)
 {
   OscatsIntegrate *self = OSCATS_INTEGRATE(object);
   oscats_integrate_clear(self);
+  g_free(self->rule_x);
+  g_free(self->rule_w);
+  if (self->rng) g_object_unref(self->rng);
   G_OBJECT_CLASS(oscats_integrate_parent_class)->finalize(object);
 }
 
+static double integrate_ellipse(double x, void *data);
+static double integrate_space(double x, void *data);
+
+/*
+ * Evaluates the batch function at n values u of the innermost variable,
+ * the outer variables being fixed by the recursion, and stores the
+ * results in f.  For the whole space, u is in (0, 1] and is mapped to
+ * x = +/-(1-u)/u, with the Jacobian folded into f.
+ */
+static void eval_nodes(OscatsIntegrate *self, const gdouble *u, guint n,
+                       gdouble *f)
+{
+  guint d = self->dims, i, j, k, m = n;
+  gdouble *row;
+
+  if (self->F.function == integrate_space) m = 2*n;
+  for (i=0; i < m; i++)
+  {
+    row = self->nodes + i*d;
+    if (self->F.function == integrate_ellipse)
+    {
+      self->z->data[d-1] = u[i];
+      for (j=0; j < d; j++)
+      {
+        row[j] = self->mu->data[j];
+        for (k=0; k <= j; k++)
+          row[j] += self->B->data[j*self->B->tda+k] * self->z->data[k];
+      }
+    } else {
+      for (j=0; j+1 < d; j++) row[j] = self->x->v->data[j];
+      if (m == n)
+        row[d-1] = u[i];
+      else
+        row[d-1] = (i % 2 ? -1 : 1) * (1-u[i/2])/u[i/2];
+    }
+  }
+  self->batch(m, self->nodes, self->values, self->data);
+  if (m == n)
+    for (i=0; i < n; i++) f[i] = self->values[i];
+  else
+    for (i=0; i < n; i++)
+      f[i] = (self->values[2*i] + self->values[2*i+1]) / (u[i]*u[i]);
+}
+
+// 15-point Gauss-Kronrod rule over [a, b] with all nodes in one batch
+static gdouble gk15(OscatsIntegrate *self, gdouble a, gdouble b,
+                    gdouble *err)
+{
+  gdouble c = (a+b)/2, h = (b-a)/2, u[15], f[15], K, G, sum;
+  guint j;
+  u[0] = c;
+  for (j=0; j < 7; j++)
+  {
+    u[2*j+1] = c - h*xgk[j];
+    u[2*j+2] = c + h*xgk[j];
+  }
+  eval_nodes(self, u, 15, f);
+  K = wgk[7]*f[0];
+  G = wg[3]*f[0];
+  for (j=0; j < 7; j++)
+  {
+    sum = f[2*j+1] + f[2*j+2];
+    K += wgk[j]*sum;
+    if (j % 2) G += wg[j/2]*sum;
+  }
+  *err = fabs((K-G)*h);
+  return K*h;
+}
+
+// Adaptive bisection of the innermost dimension for batch functions
+static gdouble integrate_batch(OscatsIntegrate *self, gdouble a, gdouble b,
+                               guint depth)
+{
+  gdouble I, err, m = (a+b)/2;
+  I = gk15(self, a, b, &err);
+  if (depth >= MAX_DEPTH || err <= self->tol ||
+      err <= self->tol*fabs(I))
+  {
+    if (self->level == 0) self->err += err;
+    return I;
+  }
+  return integrate_batch(self, a, m, depth+1) +
+         integrate_batch(self, m, b, depth+1);
+}
+
 static double integrate_box(double x, void *data)
 {
   OscatsIntegrate *self = (OscatsIntegrate*)data;
   guint level = self->level;
   if (level > 0) self->x->v->data[level-1] = x;
+  if (level+1 == self->dims && self->batch)
+    return integrate_batch(self, self->min[level], self->max[level], 0);
   if (level < self->dims)		// Recurse
   {
     gdouble I, err;
@@ -93,6 +220,7 @@ static double integrate_box(double x, void *data)
                         self->tol, self->tol, WS_SIZE, GSL_INTEG_GAUSS15,
                         self->ws[level], &I, &err);
     self->level--;
+    if (level == 0) self->err = err;
     return I;
   } else				// Integrand
     return (*(self->f))(self->x, self->data);
@@ -109,12 +237,19 @@ static double integrate_ellipse(double x, void *data)
     gdouble I, err, delta, rem = self->rem;
     self->rem -= x*x;
     delta = sqrt(self->rem);
+    if (level+1 == self->dims && self->batch)
+    {
+      I = integrate_batch(self, -delta, delta, 0);
+      self->rem = rem;
+      return I;
+    }
     self->level++;
     gsl_integration_qag(&(self->F), -delta, delta, self->tol, self->tol,
                         WS_SIZE, GSL_INTEG_GAUSS15, self->ws[level],
                         &I, &err);
     self->level--;
     self->rem = rem;
+    if (level == 0) self->err = err;
     return I;
   } else {				// Integrand
     gsl_vector_memcpy(self->x->v, self->z);
@@ -128,6 +263,8 @@ static double integrate_space(double x, void *data)
 {
   OscatsIntegrate *self = (OscatsIntegrate*)data;
   if (self->level > 0) self->x->v->data[self->level-1] = x;
+  if (self->level+1 == self->dims && self->batch)
+    return integrate_batch(self, 0, 1, 0);
   if (self->level < self->dims)		// Recurse
   {
     gdouble I, err;
@@ -135,11 +272,318 @@ static double integrate_space(double x, void *data)
     gsl_integration_qagi(&(self->F), self->tol, self->tol, WS_SIZE,
                          self->ws[self->level-1], &I, &err);
     self->level--;
+    if (self->level == 0) self->err = err;
     return I;
   } else				// Integrand
     return (*(self->f))(self->x, self->data);
 }
 
+/*
+ * Fixed (non-adaptive) rules.  Points are generated in reference
+ * coordinates r: [-1, 1]^d for the cube, box, and ellipse (points outside
+ * the unit sphere are dropped for the ellipse), and R^d for the whole
+ * space, where the rules are built for the standard normal density and the
+ * integrand is divided by that density.  Points are mapped to the
+ * integration region and evaluated BATCH_SIZE at a time.
+ */
+typedef struct {
+  guint n;
+  gdouble w[BATCH_SIZE];
+  gdouble sum;
+} Accum;
+
+static void flush_points(OscatsIntegrate *self, Accum *acc)
+{
+  guint d = self->dims, i, j;
+  if (acc->n == 0) return;
+  if (self->batch)
+    self->batch(acc->n, self->nodes, self->values, self->data);
+  else
+    for (i=0; i < acc->n; i++)
+    {
+      for (j=0; j < d; j++)
+        self->x->v->data[j] = self->nodes[i*d+j];
+      self->values[i] = (*(self->f))(self->x, self->data);
+    }
+  for (i=0; i < acc->n; i++)
+    acc->sum += acc->w[i] * self->values[i];
+  acc->n = 0;
+}
+
+static void add_point(OscatsIntegrate *self, Accum *acc, const gdouble *r,
+                      gdouble w)
+{
+  guint d = self->dims, j, k;
+  gdouble *row = self->nodes + acc->n*d, ss = 0;
+  if (self->F.function == integrate_box)
+    for (j=0; j < d; j++)
+      row[j] = (self->min[j] + self->max[j])/2 +
+               (self->max[j] - self->min[j])/2 * r[j];
+  else if (self->F.function == integrate_ellipse)
+  {
+    for (j=0; j < d; j++) ss += r[j]*r[j];
+    if (ss > 1) return;
+    for (j=0; j < d; j++)
+    {
+      row[j] = self->mu->data[j];
+      for (k=0; k <= j; k++)
+        row[j] += self->B->data[j*self->B->tda+k] * r[k];
+    }
+  } else {
+    for (j=0; j < d; j++)
+    {
+      row[j] = r[j];
+      ss += r[j]*r[j];
+    }
+    w *= exp(ss/2 + d*log(2*M_PI)/2);
+  }
+  acc->w[acc->n++] = w;
+  if (acc->n == BATCH_SIZE) flush_points(self, acc);
+}
+
+// Draws the randomly shifted quasi-random points for each replicate
+static void set_points(OscatsIntegrate *self)
+{
+  const gsl_qrng_type *type = gsl_qrng_halton;
+  gsl_qrng *q;
+  guint d = self->dims, n = self->size, s, i, j;
+  gdouble *base, shift, u;
+
+  g_free(self->qmc);
+  self->qmc = NULL;
+  if (d == 0 || (self->method != OSCATS_INTEGRATE_SOBOL &&
+                 self->method != OSCATS_INTEGRATE_HALTON))
+    return;
+  if (self->method == OSCATS_INTEGRATE_SOBOL)
+  {
+    if (d <= gsl_qrng_sobol->max_dimension)
+      type = gsl_qrng_sobol;
+    else
+      g_warning("Sobol sequence is limited to %u dimensions; using Halton.",
+                gsl_qrng_sobol->max_dimension);
+  }
+  g_return_if_fail(d <= type->max_dimension);
+
+  q = gsl_qrng_alloc(type, d);
+  base = g_new(gdouble, n*d);
+  for (i=0; i < n; i++)
+    gsl_qrng_get(q, base + i*d);
+  gsl_qrng_free(q);
+
+  self->qmc = g_new(gdouble, QMC_SHIFTS*n*d);
+  for (s=0; s < QMC_SHIFTS; s++)
+    for (j=0; j < d; j++)
+    {
+      shift = (self->rng ? oscats_rng_uniform(self->rng) :
+                           oscats_rnd_uniform());
+      for (i=0; i < n; i++)
+      {
+        u = base[i*d+j] + shift;
+        self->qmc[(s*n+i)*d+j] = (u < 1 ? u : u-1);
+      }
+    }
+  g_free(base);
+}
+
+// Randomized quasi-Monte Carlo: mean and standard error over the shifts
+static gdouble quasi_mc(OscatsIntegrate *self, gboolean bounded,
+                        gdouble *err)
+{
+  guint d = self->dims, n = self->size, s, i, j;
+  gdouble est[QMC_SHIFTS], mean = 0, var = 0, w, *u;
+  gdouble *r = g_new(gdouble, d);
+  Accum acc;
+
+  w = (bounded ? pow(2, d) : 1) / n;
+  for (s=0; s < QMC_SHIFTS; s++)
+  {
+    acc.n = 0;
+    acc.sum = 0;
+    for (i=0; i < n; i++)
+    {
+      u = self->qmc + (s*n+i)*d;
+      for (j=0; j < d; j++)
+      {
+        if (bounded)
+          r[j] = 2*u[j] - 1;
+        else if (u[j] > 0)
+          r[j] = gsl_cdf_ugaussian_Pinv(u[j]);
+        else
+          break;
+      }
+      if (j == d) add_point(self, &acc, r, w);
+    }
+    flush_points(self, &acc);
+    est[s] = acc.sum;
+    mean += acc.sum;
+  }
+  g_free(r);
+
+  mean /= QMC_SHIFTS;
+  for (s=0; s < QMC_SHIFTS; s++)
+    var += (est[s]-mean)*(est[s]-mean);
+  *err = sqrt(var / (QMC_SHIFTS*(QMC_SHIFTS-1)));
+  return mean;
+}
+
+/*
+ * Golub-Welsch: n-point Gauss-Legendre rule on [-1, 1] or Gauss-Hermite
+ * rule for the standard normal density.  The nodes are the eigenvalues of
+ * the Jacobi matrix; the weights are the squared first components of the
+ * normalized eigenvectors, times the total weight.
+ */
+static void gauss_rule(guint n, gboolean hermite, gdouble *x, gdouble *w)
+{
+  gsl_matrix *J = gsl_matrix_calloc(n, n);
+  gsl_matrix *evec = gsl_matrix_alloc(n, n);
+  gsl_vector_view eval = gsl_vector_view_array(x, n);
+  gsl_eigen_symmv_workspace *ws = gsl_eigen_symmv_alloc(n);
+  gdouble b;
+  guint i;
+  for (i=1; i < n; i++)
+  {
+    b = (hermite ? sqrt(i) : i/sqrt(4.0*i*i - 1));
+    gsl_matrix_set(J, i-1, i, b);
+    gsl_matrix_set(J, i, i-1, b);
+  }
+  gsl_eigen_symmv(J, &eval.vector, evec, ws);
+  for (i=0; i < n; i++)
+    w[i] = (hermite ? 1 : 2) *
+           gsl_matrix_get(evec, 0, i) * gsl_matrix_get(evec, 0, i);
+  gsl_eigen_symmv_free(ws);
+  gsl_matrix_free(evec);
+  gsl_matrix_free(J);
+}
+
+// Offset of the rule with n points (levels are stored consecutively)
+#define RULE(n) ((n)*((n)-1)/2)
+
+// Tabulates the Gauss rules with 1 to size points: Legendre, then Hermite
+static void set_rules(OscatsIntegrate *self)
+{
+  guint L = self->size, off = RULE(L+1), n;
+  g_free(self->rule_x);
+  g_free(self->rule_w);
+  self->rule_x = self->rule_w = NULL;
+  if (self->method != OSCATS_INTEGRATE_SPARSE_GRID) return;
+  self->rule_x = g_new(gdouble, 2*off);
+  self->rule_w = g_new(gdouble, 2*off);
+  for (n=1; n <= L; n++)
+  {
+    gauss_rule(n, FALSE, self->rule_x + RULE(n), self->rule_w + RULE(n));
+    gauss_rule(n, TRUE, self->rule_x + off + RULE(n),
+               self->rule_w + off + RULE(n));
+  }
+}
+
+static gdouble choose(guint n, guint k)
+{
+  gdouble c = 1;
+  guint i;
+  for (i=1; i <= k; i++) c = c*(n-k+i)/i;
+  return c;
+}
+
+/*
+ * Smolyak sparse grid of level L (combination technique):
+ * A(L) = sum_{L <= |k| <= q} (-1)^(q-|k|) C(d-1, q-|k|) U(k_1) x ... x U(k_d)
+ * where q = d+L-1, k_j >= 1, and U(n) is the n-point Gauss rule.
+ */
+static gdouble sparse_grid(OscatsIntegrate *self, guint L, gboolean bounded)
+{
+  guint d = self->dims, q = d+L-1, t = d, j;
+  guint *k = g_new(guint, d), *idx = g_new(guint, d);
+  gdouble *r = g_new(gdouble, d), coef, w;
+  const gdouble *x = self->rule_x, *wt = self->rule_w;
+  Accum acc;
+
+  if (!bounded)
+  {
+    x += RULE(self->size+1);
+    wt += RULE(self->size+1);
+  }
+  acc.n = 0;
+  acc.sum = 0;
+  for (j=0; j < d; j++) k[j] = 1;
+  while (TRUE)
+  {
+    if (t >= L)
+    {
+      coef = ((q-t) % 2 ? -1 : 1) * choose(d-1, q-t);
+      for (j=0; j < d; j++) idx[j] = 0;
+      do {				// Tensor product rule
+        w = coef;
+        for (j=0; j < d; j++)
+        {
+          r[j] = x[RULE(k[j]) + idx[j]];
+          w *= wt[RULE(k[j]) + idx[j]];
+        }
+        add_point(self, &acc, r, w);
+        for (j=0; j < d; j++)
+        {
+          if (++idx[j] < k[j]) break;
+          idx[j] = 0;
+        }
+      } while (j < d);
+    }
+    // Next multi-index with |k| <= q
+    for (j=0; j < d; j++)
+    {
+      k[j]++;
+      if (++t <= q) break;
+      t -= k[j]-1;
+      k[j] = 1;
+    }
+    if (j == d) break;
+  }
+  flush_points(self, &acc);
+  g_free(k);
+  g_free(idx);
+  g_free(r);
+  return acc.sum;
+}
+
+// Integrates with the fixed rule, scaling by the Jacobian of the map from
+// reference coordinates
+static gdouble integrate_fixed(OscatsIntegrate *self, gdouble scale)
+{
+  gboolean bounded = (self->F.function != integrate_space);
+  gdouble I, err;
+  if (self->method == OSCATS_INTEGRATE_SPARSE_GRID)
+  {
+    I = sparse_grid(self, self->size, bounded);
+    err = fabs(I - (self->size > 1 ?
+                    sparse_grid(self, self->size-1, bounded) : 0));
+  } else {
+    g_return_val_if_fail(self->qmc != NULL, 0);
+    I = quasi_mc(self, bounded, &err);
+  }
+  self->err = fabs(scale)*err;
+  return scale*I;
+}
+
+static void set_dims(OscatsIntegrate *integrator, guint dims)
+{
+  guint i;
+  if (integrator->dims != dims)
+  {
+    oscats_integrate_clear(integrator);
+    integrator->dims = dims;
+    integrator->x = g_gsl_vector_new(dims);
+    integrator->min = g_new(gdouble, dims);
+    integrator->max = g_new(gdouble, dims);
+    integrator->z = gsl_vector_calloc(dims);
+    integrator->mu = gsl_vector_calloc(dims);
+    integrator->B = gsl_matrix_calloc(dims, dims);
+    integrator->ws = g_new(gsl_integration_workspace*, dims);
+    for (i=0; i < dims; i++)
+      integrator->ws[i] = gsl_integration_workspace_alloc(WS_SIZE);
+    integrator->nodes = g_new(gdouble, BATCH_SIZE*dims);
+    integrator->values = g_new(gdouble, BATCH_SIZE);
+    set_points(integrator);
+  }
+}
+
 /**
  * oscats_integrate_set_tol:
  * @integrator: an #OscatsIntegrate
@@ -153,6 +597,84 @@ void oscats_integrate_set_tol(OscatsIntegrate *integrator, gdouble tol)
   integrator->tol = tol;
 }
 
+/**
+ * oscats_integrate_set_method:
+ * @integrator: an #OscatsIntegrate
+ * @method: the integration method
+ * @size: the number of points per replicate (quasi-Monte Carlo) or the
+ * level (sparse grid), or 0 for the default
+ * @rng: the random number generator for quasi-Monte Carlo shifts (or %NULL
+ * for the library generator)
+ *
+ * Sets the integration method used by subsequent calls.  The default is
+ * %OSCATS_INTEGRATE_ADAPTIVE, which nests one-dimensional adaptive
+ * quadrature to the tolerance set by oscats_integrate_set_tol(); its cost
+ * grows exponentially with the number of dimensions.  The other methods
+ * use a fixed number of points and ignore the tolerance:
+ *
+ * %OSCATS_INTEGRATE_SOBOL and %OSCATS_INTEGRATE_HALTON average the
+ * integrand over @size points of the quasi-random sequence (default 1024;
+ * powers of 2 are best for Sobol), repeated for 8 independent random
+ * shifts of the sequence, for 8 @size evaluations in all.  The shifts are
+ * drawn from @rng when the method or the dimension is set, so repeated
+ * integrals with @integrator use the same points.  Sobol sequences are
+ * limited to 40 dimensions; Halton is used for more dimensions.
+ *
+ * %OSCATS_INTEGRATE_SPARSE_GRID uses a Smolyak sparse grid of level @size
+ * (default 5) built from Gauss-Legendre rules, which is exact for
+ * polynomials of total degree 2 @size - 1.  The grid for the whole space
+ * [see oscats_integrate_space()] is built from Gauss-Hermite rules for the
+ * standard normal density, by which the integrand is divided, so it works
+ * best for integrands that decay like a normal density with unit scale.
+ * The number of evaluations grows polynomially in the dimension for a
+ * fixed level.  The integral at level @size - 1 is also computed for the
+ * error estimate.
+ *
+ * For oscats_integrate_ellipse(), the fixed methods integrate over the
+ * enclosing box, dropping points outside the ellipse.  Since the integrand
+ * is then discontinuous, sparse grids are less accurate there than
+ * quasi-Monte Carlo.
+ */
+void oscats_integrate_set_method(OscatsIntegrate *integrator, OscatsIntegrateMethod method, guint size, OscatsRng *rng)
+{
+  g_return_if_fail(OSCATS_IS_INTEGRATE(integrator));
+  g_return_if_fail(method <= OSCATS_INTEGRATE_SPARSE_GRID);
+  if (rng) g_return_if_fail(OSCATS_IS_RNG(rng));
+  if (method == OSCATS_INTEGRATE_ADAPTIVE)
+    size = 0;
+  else if (size == 0)
+    size = (method == OSCATS_INTEGRATE_SPARSE_GRID ?
+            SPARSE_DEFAULT_LEVEL : QMC_DEFAULT_SIZE);
+  if (method == OSCATS_INTEGRATE_SPARSE_GRID)
+    g_return_if_fail(size <= SPARSE_MAX_LEVEL);
+  integrator->method = method;
+  integrator->size = size;
+  if (rng) g_object_ref(rng);
+  if (integrator->rng) g_object_unref(integrator->rng);
+  integrator->rng = rng;
+  set_points(integrator);
+  set_rules(integrator);
+}
+
+/**
+ * oscats_integrate_get_error:
+ * @integrator: an #OscatsIntegrate
+ *
+ * For adaptive integration, the error is the estimate reported for the
+ * outermost dimension (the inner integrals are taken as exact).  For
+ * quasi-Monte Carlo, it is the standard error of the mean over the random
+ * shifts.  For sparse grids, it is the difference between the integrals at
+ * the set level and the level below.
+ *
+ * Returns: an estimate of the absolute error of the last integral
+ * computed by @integrator
+ */
+gdouble oscats_integrate_get_error(OscatsIntegrate *integrator)
+{
+  g_return_val_if_fail(OSCATS_IS_INTEGRATE(integrator), 0);
+  return integrator->err;
+}
+
 /**
  * oscats_integrate_set_c_function:
  * @integrator: an #OscatsIntegrate
@@ -163,23 +685,32 @@ void oscats_integrate_set_tol(OscatsIntegrate *integrator, gdouble tol)
  */
 void oscats_integrate_set_c_function(OscatsIntegrate *integrator, guint dims, OscatsIntegrateFunction f)
 {
-  guint i;
   g_return_if_fail(OSCATS_IS_INTEGRATE(integrator) && dims > 0 && f != NULL);
-  if (integrator->dims != dims)
-  {
-    oscats_integrate_clear(integrator);
-    integrator->dims = dims;
-    integrator->x = g_gsl_vector_new(dims);
-    integrator->min = g_new(gdouble, dims);
-    integrator->max = g_new(gdouble, dims);
-    integrator->z = gsl_vector_calloc(dims);
-    integrator->mu = gsl_vector_calloc(dims);
-    integrator->B = gsl_matrix_calloc(dims, dims);
-    integrator->ws = g_new(gsl_integration_workspace*, dims);
-    for (i=0; i < dims; i++)
-      integrator->ws[i] = gsl_integration_workspace_alloc(WS_SIZE);
-  }
+  set_dims(integrator, dims);
   integrator->f = f;
+  integrator->batch = NULL;
+}
+
+/**
+ * oscats_integrate_set_c_batch_function:
+ * @integrator: an #OscatsIntegrate
+ * @dims: the dimension of the function
+ * @f: the function to integrate
+ *
+ * Sets a function to integrate that is evaluated at many points at once.
+ * The function @f receives the number of points n, the points as an
+ * n x @dims array stored by rows, an array for returning the n function
+ * values, and the data passed to the integration routine.  All of the
+ * Gauss-Kronrod nodes for the innermost dimension are passed in one call,
+ * so that the integrand can reuse work across them.  Points passed to @f
+ * are not copied to a point linked by oscats_integrate_link_point().
+ */
+void oscats_integrate_set_c_batch_function(OscatsIntegrate *integrator, guint dims, OscatsIntegrateBatchFunction f)
+{
+  g_return_if_fail(OSCATS_IS_INTEGRATE(integrator) && dims > 0 && f != NULL);
+  set_dims(integrator, dims);
+  integrator->f = NULL;
+  integrator->batch = f;
 }
 
 /**
@@ -195,16 +726,21 @@ void oscats_integrate_set_c_function(OscatsIntegrate *integrator, guint dims, Os
  */
 gdouble oscats_integrate_cube(OscatsIntegrate *integrator, GGslVector *mu, gdouble delta, gpointer data)
 {
+  gdouble vol = 1;
   guint i;
-  g_return_val_if_fail(OSCATS_IS_INTEGRATE(integrator) && integrator->f != NULL, 0);
+  g_return_val_if_fail(OSCATS_IS_INTEGRATE(integrator) && (integrator->f != NULL || integrator->batch != NULL), 0);
   if (mu) g_return_val_if_fail(G_GSL_IS_VECTOR(mu) && mu->v->size == integrator->dims, 0);
   for (i=0; i < integrator->dims; i++)
   {
     integrator->min[i] = (mu ? mu->v->data[i*mu->v->stride] : 0) - delta;
     integrator->max[i] = (mu ? mu->v->data[i*mu->v->stride] : 0) + delta;
+    vol *= delta;
   }
   integrator->data = data;
   integrator->F.function = integrate_box;
+  integrator->err = 0;
+  if (integrator->method != OSCATS_INTEGRATE_ADAPTIVE)
+    return integrate_fixed(integrator, vol);
   return integrate_box(0, integrator);
 }
 
@@ -221,8 +757,9 @@ gdouble oscats_integrate_cube(OscatsIntegrate *integrator, GGslVector *mu, gdoub
  */
 gdouble oscats_integrate_box(OscatsIntegrate *integrator, GGslVector *min, GGslVector *max, gpointer data)
 {
+  gdouble vol = 1;
   guint i;
-  g_return_val_if_fail(OSCATS_IS_INTEGRATE(integrator) && integrator->f != NULL, 0);
+  g_return_val_if_fail(OSCATS_IS_INTEGRATE(integrator) && (integrator->f != NULL || integrator->batch != NULL), 0);
   g_return_val_if_fail(G_GSL_IS_VECTOR(min) && min->v->size == integrator->dims, 0);
   g_return_val_if_fail(G_GSL_IS_VECTOR(max) && max->v->size == integrator->dims, 0);
   for (i=0; i < integrator->dims; i++)
@@ -230,12 +767,38 @@ gdouble oscats_integrate_box(OscatsIntegrate *integrator, GGslVector *min, GGslV
     integrator->min[i] = min->v->data[i*min->v->stride];
     integrator->max[i] = max->v->data[i*max->v->stride];
     g_return_val_if_fail(integrator->min[i] < integrator->max[i], 0);
+    vol *= (integrator->max[i] - integrator->min[i])/2;
   }
   integrator->data = data;
   integrator->F.function = integrate_box;
+  integrator->err = 0;
+  if (integrator->method != OSCATS_INTEGRATE_ADAPTIVE)
+    return integrate_fixed(integrator, vol);
   return integrate_box(0, integrator);
 }
 
+// Integrates over the ellipse x = Bz + mu, ||z||^2 <= 1, with B set
+static gdouble integrate_ellipse_B(OscatsIntegrate *integrator,
+                                   GGslVector *mu, gpointer data)
+{
+  gdouble det = 1, I;
+  guint i;
+  if (mu)
+    gsl_vector_memcpy(integrator->mu, mu->v);
+  else
+    gsl_vector_set_zero(integrator->mu);
+  for (i=0; i < integrator->dims; i++)
+    det *= integrator->B->data[i*integrator->B->tda+i];
+  integrator->data = data;
+  integrator->F.function = integrate_ellipse;
+  integrator->err = 0;
+  if (integrator->method != OSCATS_INTEGRATE_ADAPTIVE)
+    return integrate_fixed(integrator, det);
+  I = integrate_ellipse(0, integrator) * det;
+  integrator->err *= det;
+  return I;
+}
+
 /**
  * oscats_integrate_ellipse:
  * @integrator: an #OscatsIntegrate object with function set
@@ -257,20 +820,14 @@ gdouble oscats_integrate_box(OscatsIntegrate *integrator, GGslVector *min, GGslV
  */
 gdouble oscats_integrate_ellipse(OscatsIntegrate *integrator, GGslVector *mu, GGslMatrix *Sigma, gdouble c, gpointer data)
 {
-  gdouble det = 1;
-  guint i;
   g_return_val_if_fail(OSCATS_IS_INTEGRATE(integrator) &&
-                       integrator->f != NULL, 0);
+                       (integrator->f != NULL || integrator->batch != NULL), 0);
   if (mu) g_return_val_if_fail(G_GSL_IS_VECTOR(mu) &&
                                mu->v->size == integrator->dims, 0);
   if (Sigma) g_return_val_if_fail(G_GSL_IS_MATRIX(Sigma) &&
                                   Sigma->v->size1 == integrator->dims &&
                                   Sigma->v->size2 == integrator->dims, 0);
   g_return_val_if_fail(c > 0, 0);
-  if (mu)
-    gsl_vector_memcpy(integrator->mu, mu->v);
-  else
-    gsl_vector_set_zero(integrator->mu);
   if (Sigma)
   {
     gsl_matrix_memcpy(integrator->B, Sigma->v);
@@ -282,11 +839,39 @@ gdouble oscats_integrate_ellipse(OscatsIntegrate *integrator, GGslVector *mu, GG
     gsl_matrix_set_identity(integrator->B);
     gsl_matrix_scale(integrator->B, c);
   }
-  for (i=0; i < integrator->dims; i++)
-    det *= integrator->B->data[i*integrator->B->tda+i];
-  integrator->data = data;
-  integrator->F.function = integrate_ellipse;
-  return integrate_ellipse(0, integrator) * det;
+  return integrate_ellipse_B(integrator, mu, data);
+}
+
+/**
+ * oscats_integrate_ellipse_chol:
+ * @integrator: an #OscatsIntegrate object with function set
+ * @mu: the center of the ellipse (or %NULL for the origin)
+ * @L: the lower Cholesky factor of Sigma, Sigma = LL'
+ * @c: the dilation size of the ellipse (> 0)
+ * @data: parameters for the function (or %NULL)
+ *
+ * Integrates the set function over the ellipse defined by:
+ * (x-mu)' Sigma^-1 (x-mu) <= c, as oscats_integrate_ellipse(), but with
+ * Sigma given by its Cholesky factor @L (as from
+ * gsl_linalg_cholesky_decomp(); the upper triangle is ignored).  This
+ * avoids repeating the decomposition when several functions are
+ * integrated over the same ellipse.
+ *
+ * Returns: the value of the integral
+ */
+gdouble oscats_integrate_ellipse_chol(OscatsIntegrate *integrator, GGslVector *mu, GGslMatrix *L, gdouble c, gpointer data)
+{
+  g_return_val_if_fail(OSCATS_IS_INTEGRATE(integrator) &&
+                       (integrator->f != NULL || integrator->batch != NULL), 0);
+  if (mu) g_return_val_if_fail(G_GSL_IS_VECTOR(mu) &&
+                               mu->v->size == integrator->dims, 0);
+  g_return_val_if_fail(G_GSL_IS_MATRIX(L) &&
+                       L->v->size1 == integrator->dims &&
+                       L->v->size2 == integrator->dims, 0);
+  g_return_val_if_fail(c > 0, 0);
+  gsl_matrix_memcpy(integrator->B, L->v);
+  gsl_matrix_scale(integrator->B, sqrt(c));
+  return integrate_ellipse_B(integrator, mu, data);
 }
 
 /**
@@ -300,9 +885,12 @@ gdouble oscats_integrate_ellipse(OscatsIntegrate *integrator, GGslVector *mu, GG
  */
 gdouble oscats_integrate_space(OscatsIntegrate *integrator, gpointer data)
 {
-  g_return_val_if_fail(OSCATS_IS_INTEGRATE(integrator) && integrator->f != NULL, 0);
+  g_return_val_if_fail(OSCATS_IS_INTEGRATE(integrator) && (integrator->f != NULL || integrator->batch != NULL), 0);
   integrator->data = data;
   integrator->F.function = integrate_space;
+  integrator->err = 0;
+  if (integrator->method != OSCATS_INTEGRATE_ADAPTIVE)
+    return integrate_fixed(integrator, 1);
   return integrate_space(0, integrator);
 }
 
@@ -22,8 +22,33 @@
 #include <gsl/gsl_integration.h>
 #include "gsl.h"
 #include <point.h>
+#include <random.h>
 G_BEGIN_DECLS
 
+/**
+ * OscatsIntegrateMethod:
+ * @OSCATS_INTEGRATE_ADAPTIVE: nested one-dimensional adaptive Gauss-Kronrod
+ *   quadrature
+ * @OSCATS_INTEGRATE_SOBOL: randomly shifted Sobol quasi-Monte Carlo
+ * @OSCATS_INTEGRATE_HALTON: randomly shifted Halton quasi-Monte Carlo
+ * @OSCATS_INTEGRATE_SPARSE_GRID: Smolyak sparse grid of Gauss rules
+ *
+ * The method used by #OscatsIntegrate.  The cost of adaptive integration
+ * grows exponentially with the number of dimensions; the other methods
+ * use a fixed number of function evaluations [see
+ * oscats_integrate_set_method()].
+ */
+typedef enum
+{
+  OSCATS_INTEGRATE_ADAPTIVE,
+  OSCATS_INTEGRATE_SOBOL,
+  OSCATS_INTEGRATE_HALTON,
+  OSCATS_INTEGRATE_SPARSE_GRID
+} OscatsIntegrateMethod;
+
+#define OSCATS_TYPE_INTEGRATE_METHOD (oscats_integrate_method_get_type())
+GType oscats_integrate_method_get_type (void);
+
 #define OSCATS_TYPE_INTEGRATE		(oscats_integrate_get_type())
 #define OSCATS_INTEGRATE(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), OSCATS_TYPE_INTEGRATE, OscatsIntegrate))
 #define OSCATS_IS_INTEGRATE(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), OSCATS_TYPE_INTEGRATE))
@@ -35,14 +60,20 @@ typedef struct _OscatsIntegrate OscatsIntegrate;
 typedef struct _OscatsIntegrateClass OscatsIntegrateClass;
 
 typedef gdouble (*OscatsIntegrateFunction) (const GGslVector *x, gpointer data);
+typedef void (*OscatsIntegrateBatchFunction) (guint n, const gdouble *x,
+                                              gdouble *f, gpointer data);
 
 struct _OscatsIntegrate {
   GObject parent_instance;
   OscatsIntegrateFunction f;
+  OscatsIntegrateBatchFunction batch;
   guint dims;
   gdouble tol;
+  OscatsIntegrateMethod method;
+  guint size;
   
   /*< private >*/
+  gdouble err;
   guint level;
   GGslVector *x;
   gdouble *min, *max, rem;
@@ -51,6 +82,10 @@ struct _OscatsIntegrate {
   gsl_integration_workspace **ws;
   gpointer data;
   gsl_function F;
+  gdouble *nodes, *values;	// for batch
+  OscatsRng *rng;		// for random shifts
+  gdouble *qmc;			// shifted quasi-random points
+  gdouble *rule_x, *rule_w;	// Gauss rules for sparse grids
 };
 
 struct _OscatsIntegrateClass {
@@ -60,10 +95,14 @@ struct _OscatsIntegrateClass {
 GType oscats_integrate_get_type();
 
 void oscats_integrate_set_tol(OscatsIntegrate *integrator, gdouble tol);
+void oscats_integrate_set_method(OscatsIntegrate *integrator, OscatsIntegrateMethod method, guint size, OscatsRng *rng);
+gdouble oscats_integrate_get_error(OscatsIntegrate *integrator);
 void oscats_integrate_set_c_function(OscatsIntegrate *integrator, guint dims, OscatsIntegrateFunction f);
+void oscats_integrate_set_c_batch_function(OscatsIntegrate *integrator, guint dims, OscatsIntegrateBatchFunction f);
 gdouble oscats_integrate_cube(OscatsIntegrate *integrator, GGslVector *mu, gdouble delta, gpointer data);
 gdouble oscats_integrate_box(OscatsIntegrate *integrator, GGslVector *min, GGslVector *max, gpointer data);
 gdouble oscats_integrate_ellipse(OscatsIntegrate *integrator, GGslVector *mu, GGslMatrix *Sigma, gdouble c, gpointer data);
+gdouble oscats_integrate_ellipse_chol(OscatsIntegrate *integrator, GGslVector *mu, GGslMatrix *L, gdouble c, gpointer data);
 gdouble oscats_integrate_space(OscatsIntegrate *integrator, gpointer data);
 void oscats_integrate_link_point(OscatsIntegrate *integrator, OscatsPoint *point);
 
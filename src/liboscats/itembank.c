@@ -29,6 +29,10 @@
  * oscats_administrand_set_model(), or oscats_administrand_get_model().  For
  * oscats_administrand_set_default_model(), #OscatsItemBank will set the
  * default model for all items.
+ *
+ * While the bank is frozen, oscats_item_bank_get_pack() gathers the models
+ * of a given type for batch evaluation by algorithms.  Packs are built on
+ * request.
  */
 
 #include "itembank.h"
@@ -91,20 +95,66 @@ static void oscats_item_bank_class_init (OscatsItemBankClass *klass)
 
 }
 
+static void pack_free(gpointer data)
+{
+  OscatsItemBankPack *pack = (OscatsItemBankPack*)data;
+  g_free(pack->index);
+  g_free(pack->position);
+  g_free(pack->models);
+  g_free(pack);
+}
+
+static OscatsItemBankPack * pack_new(OscatsItemBank *bank, GQuark modelKey,
+                                     GType type)
+{
+  OscatsItemBankPack *pack = g_new0(OscatsItemBankPack, 1);
+  gpointer *items = bank->items->pdata;
+  guint i, num = bank->items->len;
+  OscatsModel *model;
+  gint n;
+
+  pack->modelKey = modelKey;
+  pack->type = type;
+  pack->position = g_new(gint, num);
+  for (i=0; i < num; i++)
+  {
+    model = oscats_administrand_get_model(items[i], modelKey);
+    if (model && G_TYPE_FROM_INSTANCE(model) == type)
+      pack->position[i] = pack->num++;
+    else
+      pack->position[i] = -1;
+  }
+
+  pack->index = g_new(guint, pack->num);
+  pack->models = g_new(OscatsModel*, pack->num);
+  for (i=0; i < num; i++)
+    if ((n = pack->position[i]) >= 0)
+    {
+      pack->index[n] = i;
+      pack->models[n] = oscats_administrand_get_model(items[i], modelKey);
+    }
+
+  return pack;
+}
+
 static void oscats_item_bank_init (OscatsItemBank *self)
 {
+  self->packs = g_ptr_array_new();
+  g_ptr_array_set_free_func(self->packs, pack_free);
 }
 
 static void oscats_item_bank_dispose (GObject *object)
 {
   OscatsItemBank *self = OSCATS_ITEM_BANK(object);
   G_OBJECT_CLASS(oscats_item_bank_parent_class)->dispose(object);
+  g_ptr_array_set_size(self->packs, 0);
   g_ptr_array_set_size(self->items, 0);
 }
 
 static void oscats_item_bank_finalize (GObject *object)
 {
   OscatsItemBank *self = OSCATS_ITEM_BANK(object);
+  g_ptr_array_free(self->packs, TRUE);
   g_ptr_array_free(self->items, TRUE);
   G_OBJECT_CLASS(oscats_item_bank_parent_class)->finalize(object);
 }
@@ -156,6 +206,8 @@ static void unfreeze (OscatsAdministrand *self)
   guint i, num = bank->items->len;
   for (i=0; i < num; i++)
     oscats_administrand_unfreeze(items[i]);
+  if (self->freeze_count == 0)
+    g_ptr_array_set_size(bank->packs, 0);
 }
 
 static gboolean check_type (const OscatsAdministrand *self, GType type)
@@ -274,3 +326,40 @@ const OscatsAdministrand * oscats_item_bank_get_item(const OscatsItemBank *bank,
                        i < bank->items->len, NULL);
   return g_ptr_array_index(bank->items, i);
 }
+
+/**
+ * oscats_item_bank_get_pack:
+ * @bank: a frozen #OscatsItemBank
+ * @modelKey: the model key (0 for the default model)
+ * @type: the model type
+ *
+ * Gathers the models of all items in @bank whose model @modelKey is of
+ * type @type (see #OscatsItemBankPack).  A pack is
+ * built on the first request and kept until @bank is unfrozen.  Since
+ * building a pack is not thread-safe, algorithms should request their
+ * packs when they are registered.
+ *
+ * The pack is a snapshot.  Freezing the bank prevents items from being
+ * added or removed, but not items' models from being replaced; if a model
+ * is replaced while @bank is frozen, the pack is stale until @bank is
+ * unfrozen and the pack is requested again.  Changes to model parameters
+ * are seen, since the pack holds the models themselves.
+ *
+ * Returns: (transfer none): the pack, or %NULL if @bank is not frozen
+ */
+const OscatsItemBankPack * oscats_item_bank_get_pack(OscatsItemBank *bank, GQuark modelKey, GType type)
+{
+  OscatsItemBankPack *pack;
+  guint i;
+  g_return_val_if_fail(OSCATS_IS_ITEM_BANK(bank), NULL);
+  g_return_val_if_fail(OSCATS_ADMINISTRAND(bank)->freeze_count > 0, NULL);
+  for (i=0; i < bank->packs->len; i++)
+  {
+    pack = g_ptr_array_index(bank->packs, i);
+    if (pack->modelKey == modelKey && pack->type == type)
+      return pack;
+  }
+  pack = pack_new(bank, modelKey, type);
+  g_ptr_array_add(bank->packs, pack);
+  return pack;
+}
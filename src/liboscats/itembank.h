@@ -31,10 +31,37 @@ G_BEGIN_DECLS
 
 typedef struct _OscatsItemBank OscatsItemBank;
 typedef struct _OscatsItemBankClass OscatsItemBankClass;
+typedef struct _OscatsItemBankPack OscatsItemBankPack;
 
 struct _OscatsItemBank {
   OscatsAdministrand parent_instance;
   GPtrArray *items;
+  /*< private >*/
+  GPtrArray *packs;
+};
+
+/**
+ * OscatsItemBankPack:
+ * @modelKey: the model key packed
+ * @type: the model type packed
+ * @num: the number of packed items
+ * @index: the item bank index of packed item i
+ * @position: the packed position of bank item j, or -1 if the item
+ * is not in the pack
+ * @models: the model of packed item i (not referenced)
+ *
+ * The items of a frozen item bank whose model for @modelKey is of type
+ * @type, gathered so that their models can be passed together to
+ * oscats_model_P_batch().  The pack is not updated if items' models are
+ * replaced while the bank is frozen.
+ */
+struct _OscatsItemBankPack {
+  GQuark modelKey;
+  GType type;
+  guint num;
+  guint *index;
+  gint *position;
+  OscatsModel **models;
 };
 
 struct _OscatsItemBankClass {
@@ -47,6 +74,7 @@ void oscats_item_bank_add_item(OscatsItemBank *bank, OscatsAdministrand *item);
 void oscats_item_bank_remove_item(OscatsItemBank *bank, OscatsAdministrand *item);
 guint oscats_item_bank_num_items(const OscatsItemBank *bank);
 const OscatsAdministrand * oscats_item_bank_get_item(const OscatsItemBank *bank, guint i);
+const OscatsItemBankPack * oscats_item_bank_get_pack(OscatsItemBank *bank, GQuark modelKey, GType type);
 
 G_END_DECLS
 #endif
@@ -57,6 +57,44 @@ static gdouble null_P (const OscatsModel *model, OscatsResponse resp,
   g_critical("Abstract OscatsModel should have overloaded P().");
   return 0;
 }
+static void default_P_batch (OscatsModel * const *models, guint num,
+                             OscatsResponse resp, const OscatsPoint *theta,
+                             const OscatsCovariates *covariates, gdouble *P)
+{
+  OscatsModelClass *klass = OSCATS_MODEL_GET_CLASS(models[0]);
+  guint i;
+  for (i=0; i < num; i++)
+    P[i] = klass->P(models[i], resp, theta, covariates);
+}
+static void default_P_grid (const OscatsModel *model, OscatsResponse resp,
+                            const gdouble *thetas, guint num,
+                            const OscatsCovariates *covariates, gdouble *P)
+{
+  OscatsModelClass *klass = OSCATS_MODEL_GET_CLASS(model);
+  OscatsPoint *theta = oscats_point_new_from_space(model->space);
+  guint g, i, dims = model->space->num_cont;
+  for (g=0; g < num; g++)
+  {
+    for (i=0; i < dims; i++)
+      theta->cont[i] = thetas[g*dims+i];
+    P[g] = klass->P(model, resp, theta, covariates);
+  }
+  g_object_unref(theta);
+}
+static void default_P_patterns (const OscatsModel *model, OscatsResponse resp,
+                                const OscatsCovariates *covariates, gdouble *P)
+{
+  OscatsModelClass *klass = OSCATS_MODEL_GET_CLASS(model);
+  OscatsPoint *theta = oscats_point_new_from_space(model->space);
+  guint c, j, num_bin = model->space->num_bin;
+  for (c=0; c < (1u << num_bin); c++)
+  {
+    for (j=0; j < num_bin; j++)
+      g_bit_array_set_bit_val(theta->bin, j, (c >> j) & 1);
+    P[c] = klass->P(model, resp, theta, covariates);
+  }
+  g_object_unref(theta);
+}
 static gdouble null_distance (const OscatsModel *model,
                               const OscatsPoint *theta, const OscatsCovariates *covariates)
 {
@@ -89,6 +127,9 @@ static void oscats_model_class_init (OscatsModelClass *klass)
   
   klass->get_max = null_get_max;
   klass->P = null_P;
+  klass->P_batch = default_P_batch;
+  klass->P_grid = default_P_grid;
+  klass->P_patterns = default_P_patterns;
   klass->distance = null_distance;
   klass->logLik_dtheta = null_logLik_theta;
   klass->logLik_dparam = null_logLik_param;
@@ -526,6 +567,101 @@ gdouble oscats_model_P(const OscatsModel *model, OscatsResponse resp,
   return OSCATS_MODEL_GET_CLASS(model)->P(model, resp, theta, covariates);
 }
 
+/**
+ * oscats_model_P_batch:
+ * @models: (array length=num): #OscatsModel objects, all of the same type
+ * @num: the number of models
+ * @resp: the examinee response value
+ * @theta: the latent ability
+ * @covariates: (allow-none): the values for covariates
+ * @P: (out caller-allocates) (array length=num): the computed probabilities
+ *
+ * Calculates the probability of response @resp, given latent ability
+ * @theta, for each of @models, storing the result in @P[i].  The arguments
+ * are checked once for the whole batch, and implementations may overload
+ * #OscatsModelClass.P_batch to compute all of the probabilities in one
+ * pass.  The default implementation calls #OscatsModelClass.P for each
+ * model.
+ */
+void oscats_model_P_batch(OscatsModel * const *models, guint num,
+                          OscatsResponse resp, const OscatsPoint *theta,
+                          const OscatsCovariates *covariates, gdouble *P)
+{
+  GType type;
+  guint i;
+  if (num == 0) return;
+  g_return_if_fail(models != NULL && P != NULL);
+  g_return_if_fail(OSCATS_IS_MODEL(models[0]));
+  g_return_if_fail(OSCATS_IS_POINT(theta));
+  if (covariates) g_return_if_fail(OSCATS_IS_COVARIATES(covariates));
+  type = G_TYPE_FROM_INSTANCE(models[0]);
+  for (i=0; i < num; i++)
+  {
+    g_return_if_fail(OSCATS_IS_MODEL(models[i]) &&
+                     G_TYPE_FROM_INSTANCE(models[i]) == type);
+    g_return_if_fail(oscats_space_compatible(theta->space, models[i]->space));
+  }
+  OSCATS_MODEL_GET_CLASS(models[0])->P_batch(models, num, resp, theta,
+                                             covariates, P);
+}
+
+/**
+ * oscats_model_P_grid:
+ * @model: an #OscatsModel on a continuous subspace
+ * @resp: the examinee response value
+ * @thetas: (array): the continuous coordinates of @num points, stored by
+ * row: coordinate i of point g is @thetas[g*num_cont+i], where num_cont is
+ * the number of continuous dimensions of @model's latent space
+ * @num: the number of points
+ * @covariates: (allow-none): the values for covariates
+ * @P: (out caller-allocates) (array length=num): the computed probabilities
+ *
+ * Calculates the probability of response @resp at each of @num latent
+ * points, storing the result in @P[g].  This is equivalent to calling
+ * oscats_model_P() for each point, but avoids filling an #OscatsPoint and
+ * dispatching through the class for every point, which is useful for
+ * quadrature.  The rows of a #gsl_matrix allocated with @num rows and
+ * num_cont columns can be passed directly as @thetas.
+ */
+void oscats_model_P_grid(const OscatsModel *model, OscatsResponse resp,
+                         const gdouble *thetas, guint num,
+                         const OscatsCovariates *covariates, gdouble *P)
+{
+  g_return_if_fail(OSCATS_IS_MODEL(model));
+  g_return_if_fail(model->dimType == OSCATS_DIM_CONT);
+  if (num == 0) return;
+  g_return_if_fail(thetas != NULL && P != NULL);
+  if (covariates) g_return_if_fail(OSCATS_IS_COVARIATES(covariates));
+  OSCATS_MODEL_GET_CLASS(model)->P_grid(model, resp, thetas, num,
+                                        covariates, P);
+}
+
+/**
+ * oscats_model_P_patterns:
+ * @model: an #OscatsModel whose latent space is purely binary
+ * @resp: the examinee response value
+ * @covariates: (allow-none): the values for covariates
+ * @P: (out caller-allocates): the computed probabilities, an array of
+ * length 2^num_bin, where num_bin is the number of binary dimensions
+ *
+ * Calculates the probability of response @resp for every pattern of the
+ * binary latent space, storing the result for pattern c in @P[c].  Bit j
+ * of c is binary dimension j, so patterns are in the order of
+ * #OscatsAlgEstimate:Dprior.  This is equivalent to calling
+ * oscats_model_P() for each pattern, but implementations may compute all
+ * of the patterns at once.  The space may have at most 30 binary
+ * dimensions.
+ */
+void oscats_model_P_patterns(const OscatsModel *model, OscatsResponse resp,
+                             const OscatsCovariates *covariates, gdouble *P)
+{
+  g_return_if_fail(OSCATS_IS_MODEL(model) && P != NULL);
+  g_return_if_fail(model->space->num_cont == 0 && model->space->num_nat == 0);
+  g_return_if_fail(model->space->num_bin <= 30);
+  if (covariates) g_return_if_fail(OSCATS_IS_COVARIATES(covariates));
+  OSCATS_MODEL_GET_CLASS(model)->P_patterns(model, resp, covariates, P);
+}
+
 /**
  * oscats_model_distance:
  * @model: an #OscatsModel
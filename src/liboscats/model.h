@@ -61,6 +61,12 @@ struct _OscatsModel {
  * OscatsModelClass:
  * @get_max: get maximum response category supported by model
  * @P: get the probability of a response, given a point in latent space
+ * @P_batch: get the probability of a response for several models of this
+ *           type at the same point in latent space
+ * @P_grid: get the probability of a response at many points in the
+ *          continuous latent space
+ * @P_patterns: get the probability of a response for every pattern of a
+ *              binary latent space
  * @distance: get a distance metric between the item model and a given point
  *            in latent space
  * @logLik_dtheta: get the derivative of the log-likelihood of the given
@@ -85,6 +91,14 @@ struct _OscatsModelClass {
   /*< public >*/
   OscatsResponse (*get_max) (const OscatsModel *model);
   gdouble (*P) (const OscatsModel *model, OscatsResponse resp, const OscatsPoint *theta, const OscatsCovariates *covariates);
+  void (*P_batch) (OscatsModel * const *models, guint num, OscatsResponse resp,
+                   const OscatsPoint *theta, const OscatsCovariates *covariates,
+                   gdouble *P);
+  void (*P_grid) (const OscatsModel *model, OscatsResponse resp,
+                  const gdouble *thetas, guint num,
+                  const OscatsCovariates *covariates, gdouble *P);
+  void (*P_patterns) (const OscatsModel *model, OscatsResponse resp,
+                      const OscatsCovariates *covariates, gdouble *P);
   gdouble (*distance) (const OscatsModel *model, const OscatsPoint *theta, const OscatsCovariates *covariates);
   void (*logLik_dtheta) (const OscatsModel *model, OscatsResponse resp,
                          const OscatsPoint *theta, const OscatsCovariates *covariates,
@@ -103,6 +117,14 @@ OscatsModel * oscats_model_new(GType type, OscatsSpace *space,
 OscatsResponse oscats_model_get_max(const OscatsModel *model);
 gdouble oscats_model_P(const OscatsModel *model, OscatsResponse resp,
                        const OscatsPoint *theta, const OscatsCovariates *covariates);
+void oscats_model_P_batch(OscatsModel * const *models, guint num,
+                          OscatsResponse resp, const OscatsPoint *theta,
+                          const OscatsCovariates *covariates, gdouble *P);
+void oscats_model_P_grid(const OscatsModel *model, OscatsResponse resp,
+                         const gdouble *thetas, guint num,
+                         const OscatsCovariates *covariates, gdouble *P);
+void oscats_model_P_patterns(const OscatsModel *model, OscatsResponse resp,
+                             const OscatsCovariates *covariates, gdouble *P);
 gdouble oscats_model_distance(const OscatsModel *model,
                               const OscatsPoint *theta, const OscatsCovariates *covariates);
 void oscats_model_logLik_dtheta(const OscatsModel *model, OscatsResponse resp,
@@ -39,6 +39,8 @@ static void model_constructed (GObject *object);
 static OscatsResponse get_max (const OscatsModel *model);
 static gdouble P(const OscatsModel *model, OscatsResponse resp,
                  const OscatsPoint *theta, const OscatsCovariates *covariates);
+static void P_patterns(const OscatsModel *model, OscatsResponse resp,
+                       const OscatsCovariates *covariates, gdouble *P);
 static void logLik_dparam(const OscatsModel *model, OscatsResponse resp,
                           const OscatsPoint *theta, const OscatsCovariates *covariates,
                           GGslVector *grad, GGslMatrix *hes);
@@ -52,6 +54,7 @@ static void oscats_model_dina_class_init (OscatsModelDinaClass *klass)
 
   model_class->get_max = get_max;
   model_class->P = P;
+  model_class->P_patterns = P_patterns;
   model_class->logLik_dparam = logLik_dparam;
   
 }
@@ -102,6 +105,27 @@ static gdouble P(const OscatsModel *model, OscatsResponse resp,
   return (resp ? p : 1-p);
 }
 
+// Pattern c has mastered all required attributes iff (c & mask) == mask
+static void P_patterns(const OscatsModel *model, OscatsResponse resp,
+                       const OscatsCovariates *covariates, gdouble *P)
+{
+  guint *dims = model->shortDims;
+  guint c, i, mask = 0, num = 1u << model->space->num_bin;
+  gdouble p_pass, p_fail;
+  g_return_if_fail(resp <= 1);
+  for (i=0; i < model->Ndims; i++)
+    mask |= 1u << dims[i];
+  p_pass = 1-model->params[PARAM_SLIP];
+  p_fail = model->params[PARAM_GUESS];
+  if (!resp)
+  {
+    p_pass = 1-p_pass;
+    p_fail = 1-p_fail;
+  }
+  for (c=0; c < num; c++)
+    P[c] = ((c & mask) == mask ? p_pass : p_fail);
+}
+
 /* Derivative    pass && resp  pass && !resp  !pass && resp  !pass && !resp
  *   g             0             0              1/g            -1/g
  *   s             1/(s-1)       1/s            0              0
@@ -48,6 +48,9 @@ static void model_get_property(GObject *object, guint prop_id,
                                GValue *value, GParamSpec *pspec);
 static OscatsResponse get_max (const OscatsModel *model);
 static gdouble P(const OscatsModel *model, OscatsResponse resp, const OscatsPoint *theta, const OscatsCovariates *covariates);
+static void P_grid(const OscatsModel *model, OscatsResponse resp,
+                   const gdouble *thetas, guint num,
+                   const OscatsCovariates *covariates, gdouble *P);
 //static gdouble distance(const OscatsModel *model, const OscatsPoint *theta, const OscatsCovariates *covariates);
 static void logLik_dtheta(const OscatsModel *model, OscatsResponse resp,
                           const OscatsPoint *theta, const OscatsCovariates *covariates,
@@ -68,6 +71,7 @@ static void oscats_model_gpc_class_init (OscatsModelGpcClass *klass)
 
   model_class->get_max = get_max;
   model_class->P = P;
+  model_class->P_grid = P_grid;
 //  model_class->distance = distance;
   model_class->logLik_dtheta = logLik_dtheta;
   model_class->logLik_dparam = logLik_dparam;
@@ -207,13 +211,43 @@ static gdouble P(const OscatsModel *model, OscatsResponse resp,
           z[k] += model->params[PARAM_A(i)] * theta->cont[dims[i]];
       }
   }
-  for (i=0, I=PARAM_D(0); i < model->Np; i++, I++)
+  for (i=0, I=PARAM_D(0); i < model->Ncov; i++, I++)
     cov += oscats_covariates_get(covariates, model->covariates[i]) * model->params[I];
   for (k=0; k < Ncat; k++)
     denom += exp(z[k]+cov);
   return (resp == 0 ? 1 : exp(z[resp-1]+cov)) / denom;
 }
 
+static void P_grid(const OscatsModel *model, OscatsResponse resp,
+                   const gdouble *thetas, guint num,
+                   const OscatsCovariates *covariates, gdouble *P)
+{
+  guint *dims = model->shortDims;
+  guint stride = model->space->num_cont;
+  guint Ndims = model->Ndims;
+  guint Ncat = ((OscatsModelGpc*)model)->Ncat;
+  guint g, i, I, k;
+  gdouble a, cov = 0, denom;
+  g_return_if_fail(resp <= Ncat);
+  for (i=0, I=PARAM_D(0); i < model->Ncov; i++, I++)
+    cov += oscats_covariates_get(covariates, model->covariates[i]) * model->params[I];
+  for (g=0; g < num; g++)
+    P[g] = cov;
+  for (i=0; i < Ndims; i++)
+  {
+    a = model->params[PARAM_A(i)];
+    for (g=0; g < num; g++)
+      P[g] += a * thetas[g*stride+dims[i]];
+  }
+  for (g=0; g < num; g++)
+  {
+    denom = 1;
+    for (k=0; k < Ncat; k++)
+      denom += exp(P[g] - model->params[PARAM_B(k+1)]);
+    P[g] = (resp == 0 ? 1 : exp(P[g] - model->params[PARAM_B(resp)])) / denom;
+  }
+}
+
 /* z_k = k sum_i a_i theta_i - sum_h^k b_h + sum_l d_l cov_l, z_0 = 0
  * P_k = exp(z_k) / [ sum_h^Ncat exp(z_h) ]
  * d log P_k / dA = dz_k/dA - sum_x P_x dz_x/dA
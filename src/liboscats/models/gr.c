@@ -49,6 +49,9 @@ static void model_get_property(GObject *object, guint prop_id,
                                GValue *value, GParamSpec *pspec);
 static OscatsResponse get_max (const OscatsModel *model);
 static gdouble P(const OscatsModel *model, OscatsResponse resp, const OscatsPoint *theta, const OscatsCovariates *covariates);
+static void P_grid(const OscatsModel *model, OscatsResponse resp,
+                   const gdouble *thetas, guint num,
+                   const OscatsCovariates *covariates, gdouble *P);
 //static gdouble distance(const OscatsModel *model, const OscatsPoint *theta, const OscatsCovariates *covariates);
 static void logLik_dtheta(const OscatsModel *model, OscatsResponse resp,
                           const OscatsPoint *theta, const OscatsCovariates *covariates,
@@ -69,6 +72,7 @@ static void oscats_model_gr_class_init (OscatsModelGrClass *klass)
 
   model_class->get_max = get_max;
   model_class->P = P;
+  model_class->P_grid = P_grid;
 //  model_class->distance = distance;
   model_class->logLik_dtheta = logLik_dtheta;
   model_class->logLik_dparam = logLik_dparam;
@@ -210,6 +214,37 @@ static gdouble P(const OscatsModel *model, OscatsResponse resp,
          (resp == Ncat ? 0 : P_star(model, resp+1, theta, covariates));
 }
 
+static void P_grid(const OscatsModel *model, OscatsResponse resp,
+                   const gdouble *thetas, guint num,
+                   const OscatsCovariates *covariates, gdouble *P)
+{
+  guint *dims = model->shortDims;
+  guint stride = model->space->num_cont;
+  guint Ndims = model->Ndims;
+  guint Ncat = ((OscatsModelGr*)model)->Ncat;
+  guint g, i;
+  gdouble a, eta0 = 0, hi, lo;
+  g_return_if_fail(resp <= Ncat);
+  for (i=0; i < model->Ncov; i++)
+    eta0 += model->params[PARAM_D(i)] *
+            oscats_covariates_get(covariates, model->covariates[i]);
+  for (g=0; g < num; g++)
+    P[g] = eta0;
+  for (i=0; i < Ndims; i++)
+  {
+    a = model->params[PARAM_A(i)];
+    for (g=0; g < num; g++)
+      P[g] += a * thetas[g*stride+dims[i]];
+  }
+  // P[g] = P_star(resp) - P_star(resp+1)
+  for (g=0; g < num; g++)
+  {
+    hi = (resp == 0 ? 1 : 1/(1+exp(model->params[PARAM_B(resp)] - P[g])));
+    lo = (resp == Ncat ? 0 : 1/(1+exp(model->params[PARAM_B(resp+1)] - P[g])));
+    P[g] = hi - lo;
+  }
+}
+
 /* See below for general derivatives.
  * dz_k/dtheta_i = a_i
  */
@@ -37,6 +37,12 @@ enum
 static void model_constructed (GObject *object);
 static OscatsResponse get_max (const OscatsModel *model);
 static gdouble P(const OscatsModel *model, OscatsResponse resp, const OscatsPoint *theta, const OscatsCovariates *covariates);
+static void P_batch(OscatsModel * const *models, guint num, OscatsResponse resp,
+                    const OscatsPoint *theta, const OscatsCovariates *covariates,
+                    gdouble *P);
+static void P_grid(const OscatsModel *model, OscatsResponse resp,
+                   const gdouble *thetas, guint num,
+                   const OscatsCovariates *covariates, gdouble *P);
 static gdouble distance(const OscatsModel *model, const OscatsPoint *theta, const OscatsCovariates *covariates);
 static void logLik_dtheta(const OscatsModel *model, OscatsResponse resp,
                           const OscatsPoint *theta, const OscatsCovariates *covariates,
@@ -54,6 +60,8 @@ static void oscats_model_l1p_class_init (OscatsModelL1pClass *klass)
 
   model_class->get_max = get_max;
   model_class->P = P;
+  model_class->P_batch = P_batch;
+  model_class->P_grid = P_grid;
   model_class->distance = distance;
   model_class->logLik_dtheta = logLik_dtheta;
   model_class->logLik_dparam = logLik_dparam;
@@ -94,13 +102,13 @@ static OscatsResponse get_max (const OscatsModel *model)
   return 1;
 }
 
-static gdouble P(const OscatsModel *model, OscatsResponse resp,
-                 const OscatsPoint *theta, const OscatsCovariates *covariates)
+// P(1) = 1/(1+exp(z))
+static inline gdouble exponent(const OscatsModel *model, const OscatsPoint *theta,
+                               const OscatsCovariates *covariates)
 {
   guint *dims = model->shortDims;
   guint i;
   gdouble z = 0;
-  g_return_val_if_fail(resp <= 1, 0);
   switch (model->Ndims)
   {
     case 2:
@@ -117,9 +125,56 @@ static gdouble P(const OscatsModel *model, OscatsResponse resp,
     z -= oscats_covariates_get(covariates, model->covariates[i]) *
          model->params[NUM_PARAMS+i];
   z += model->params[PARAM_B];
+  return z;
+}
+
+static gdouble P(const OscatsModel *model, OscatsResponse resp,
+                 const OscatsPoint *theta, const OscatsCovariates *covariates)
+{
+  gdouble z;
+  g_return_val_if_fail(resp <= 1, 0);
+  z = exponent(model, theta, covariates);
   return 1/(1+exp(resp ? z : -z));
 }
 
+static void P_grid(const OscatsModel *model, OscatsResponse resp,
+                   const gdouble *thetas, guint num,
+                   const OscatsCovariates *covariates, gdouble *P)
+{
+  guint *dims = model->shortDims;
+  guint stride = model->space->num_cont;
+  guint g, i;
+  gdouble z0 = model->params[PARAM_B];
+  g_return_if_fail(resp <= 1);
+  for (i=0; i < model->Ncov; i++)
+    z0 -= oscats_covariates_get(covariates, model->covariates[i]) *
+          model->params[NUM_PARAMS+i];
+  for (g=0; g < num; g++)
+    P[g] = z0;
+  for (i=0; i < model->Ndims; i++)
+    for (g=0; g < num; g++)
+      P[g] -= thetas[g*stride+dims[i]];
+  if (resp == 0)
+    for (g=0; g < num; g++) P[g] = -P[g];
+  for (g=0; g < num; g++)
+    P[g] = 1/(1+exp(P[g]));
+}
+
+// As P(), without the per-model dispatch and argument checks
+static void P_batch(OscatsModel * const *models, guint num, OscatsResponse resp,
+                    const OscatsPoint *theta, const OscatsCovariates *covariates,
+                    gdouble *P)
+{
+  gdouble z;
+  guint i;
+  g_return_if_fail(resp <= 1);
+  for (i=0; i < num; i++)
+  {
+    z = exponent(models[i], theta, covariates);
+    P[i] = 1/(1+exp(resp ? z : -z));
+  }
+}
+
 static gdouble distance(const OscatsModel *model, const OscatsPoint *theta,
                         const OscatsCovariates *covariates)
 {
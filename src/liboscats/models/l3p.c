@@ -38,6 +38,12 @@ enum
 static void model_constructed (GObject *object);
 static OscatsResponse get_max (const OscatsModel *model);
 static gdouble P(const OscatsModel *model, OscatsResponse resp, const OscatsPoint *theta, const OscatsCovariates *covariates);
+static void P_batch(OscatsModel * const *models, guint num, OscatsResponse resp,
+                    const OscatsPoint *theta, const OscatsCovariates *covariates,
+                    gdouble *P);
+static void P_grid(const OscatsModel *model, OscatsResponse resp,
+                   const gdouble *thetas, guint num,
+                   const OscatsCovariates *covariates, gdouble *P);
 static gdouble distance(const OscatsModel *model, const OscatsPoint *theta, const OscatsCovariates *covariates);
 static void logLik_dtheta(const OscatsModel *model, OscatsResponse resp,
                           const OscatsPoint *theta, const OscatsCovariates *covariates,
@@ -55,6 +61,8 @@ static void oscats_model_l3p_class_init (OscatsModelL3pClass *klass)
 
   model_class->get_max = get_max;
   model_class->P = P;
+  model_class->P_batch = P_batch;
+  model_class->P_grid = P_grid;
   model_class->distance = distance;
   model_class->logLik_dtheta = logLik_dtheta;
   model_class->logLik_dparam = logLik_dparam;
@@ -105,8 +113,9 @@ static OscatsResponse get_max (const OscatsModel *model)
   return 1;
 }
 
-static gdouble P_star(const OscatsModel *model, const OscatsPoint *theta,
-                      const OscatsCovariates *covariates)
+// P_star = 1/(1+exp(z))
+static inline gdouble exponent(const OscatsModel *model, const OscatsPoint *theta,
+                               const OscatsCovariates *covariates)
 {
   guint *dims = model->shortDims;
   guint i, I;
@@ -126,7 +135,13 @@ static gdouble P_star(const OscatsModel *model, const OscatsPoint *theta,
   for (i=PARAM_A_FIRST+model->Ndims, I=0; i < model->Np; i++, I++)
     z -= oscats_covariates_get(covariates, model->covariates[I]) * model->params[i];
   z += model->params[PARAM_B];
-  return 1/(1+exp(z));
+  return z;
+}
+
+static gdouble P_star(const OscatsModel *model, const OscatsPoint *theta,
+                      const OscatsCovariates *covariates)
+{
+  return 1/(1+exp(exponent(model, theta, covariates)));
 }
 
 static gdouble P(const OscatsModel *model, OscatsResponse resp,
@@ -139,6 +154,47 @@ static gdouble P(const OscatsModel *model, OscatsResponse resp,
   return (resp ? x : 1-x);
 }
 
+// As P(), without the per-model dispatch and argument checks
+static void P_batch(OscatsModel * const *models, guint num, OscatsResponse resp,
+                    const OscatsPoint *theta, const OscatsCovariates *covariates,
+                    gdouble *P)
+{
+  gdouble c, x;
+  guint i;
+  g_return_if_fail(resp <= 1);
+  for (i=0; i < num; i++)
+  {
+    c = models[i]->params[PARAM_C];
+    x = c + (1-c) * P_star(models[i], theta, covariates);
+    P[i] = (resp ? x : 1-x);
+  }
+}
+
+static void P_grid(const OscatsModel *model, OscatsResponse resp,
+                   const gdouble *thetas, guint num,
+                   const OscatsCovariates *covariates, gdouble *P)
+{
+  guint *dims = model->shortDims;
+  guint stride = model->space->num_cont;
+  guint g, i, I;
+  gdouble a, c = model->params[PARAM_C], z0 = model->params[PARAM_B];
+  g_return_if_fail(resp <= 1);
+  for (i=PARAM_A_FIRST+model->Ndims, I=0; i < model->Np; i++, I++)
+    z0 -= oscats_covariates_get(covariates, model->covariates[I]) * model->params[i];
+  for (g=0; g < num; g++)
+    P[g] = z0;
+  for (i=0; i < model->Ndims; i++)
+  {
+    a = model->params[PARAM_A_FIRST+i];
+    for (g=0; g < num; g++)
+      P[g] -= a * thetas[g*stride+dims[i]];
+  }
+  for (g=0; g < num; g++)
+    P[g] = c + (1-c)/(1+exp(P[g]));
+  if (resp == 0)
+    for (g=0; g < num; g++) P[g] = 1-P[g];
+}
+
 static gdouble distance(const OscatsModel *model, const OscatsPoint *theta,
                         const OscatsCovariates *covariates)
 {
@@ -38,6 +38,8 @@ static void model_constructed (GObject *object);
 static OscatsResponse get_max (const OscatsModel *model);
 static gdouble P(const OscatsModel *model, OscatsResponse resp,
                  const OscatsPoint *theta, const OscatsCovariates *covariates);
+static void P_patterns(const OscatsModel *model, OscatsResponse resp,
+                       const OscatsCovariates *covariates, gdouble *P);
 static void logLik_dparam(const OscatsModel *model, OscatsResponse resp,
                           const OscatsPoint *theta, const OscatsCovariates *covariates,
                           GGslVector *grad, GGslMatrix *hes);
@@ -51,6 +53,7 @@ static void oscats_model_nida_class_init (OscatsModelNidaClass *klass)
 
   model_class->get_max = get_max;
   model_class->P = P;
+  model_class->P_patterns = P_patterns;
   model_class->logLik_dparam = logLik_dparam;
   
 }
@@ -112,6 +115,40 @@ static gdouble P(const OscatsModel *model, OscatsResponse resp,
   return (resp ? p : 1-p);
 }
 
+/* The table is built by doubling: after step j, P[0 .. 2^(j+1)-1] holds
+ * the product of the factors for binary dimensions 0..j.  Dimensions that
+ * the item does not measure contribute a factor of 1.
+ */
+static void P_patterns(const OscatsModel *model, OscatsResponse resp,
+                       const OscatsCovariates *covariates, gdouble *P)
+{
+  guint *dims = model->shortDims;
+  guint num_bin = model->space->num_bin;
+  guint c, i, j, half, num = 1u << num_bin;
+  gdouble m0, m1;
+  g_return_if_fail(resp <= 1);
+  P[0] = 1;
+  for (j=0; j < num_bin; j++)
+  {
+    half = 1u << j;
+    m0 = m1 = 1;
+    for (i=0; i < model->Ndims; i++)
+      if (dims[i] == j)
+      {
+        m0 = model->params[PARAM_GUESS*model->Ndims+i];
+        m1 = 1-model->params[PARAM_SLIP*model->Ndims+i];
+        break;
+      }
+    for (c=0; c < half; c++)
+    {
+      P[c+half] = P[c] * m1;
+      P[c] *= m0;
+    }
+  }
+  if (!resp)
+    for (c=0; c < num; c++) P[c] = 1-P[c];
+}
+
 static void logLik_dparam(const OscatsModel *model, OscatsResponse resp,
                           const OscatsPoint *theta, const OscatsCovariates *covariates,
                           GGslVector *grad, GGslMatrix *hes)
@@ -47,6 +47,9 @@ static void model_get_property(GObject *object, guint prop_id,
                                GValue *value, GParamSpec *pspec);
 static OscatsResponse get_max (const OscatsModel *model);
 static gdouble P(const OscatsModel *model, OscatsResponse resp, const OscatsPoint *theta, const OscatsCovariates *covariates);
+static void P_grid(const OscatsModel *model, OscatsResponse resp,
+                   const gdouble *thetas, guint num,
+                   const OscatsCovariates *covariates, gdouble *P);
 static gdouble distance(const OscatsModel *model, const OscatsPoint *theta, const OscatsCovariates *covariates);
 static void logLik_dtheta(const OscatsModel *model, OscatsResponse resp,
                           const OscatsPoint *theta, const OscatsCovariates *covariates,
@@ -67,6 +70,7 @@ static void oscats_model_nominal_class_init (OscatsModelNominalClass *klass)
 
   model_class->get_max = get_max;
   model_class->P = P;
+  model_class->P_grid = P_grid;
   model_class->distance = distance;
   model_class->logLik_dtheta = logLik_dtheta;
   model_class->logLik_dparam = logLik_dparam;
@@ -210,6 +214,34 @@ static gdouble P(const OscatsModel *model, OscatsResponse resp,
   return (resp == 0 ? 1 : exp(z[resp-1]+cov)) / denom;
 }
 
+static void P_grid(const OscatsModel *model, OscatsResponse resp,
+                   const gdouble *thetas, guint num,
+                   const OscatsCovariates *covariates, gdouble *P)
+{
+  guint *dims = model->shortDims;
+  guint stride = model->space->num_cont;
+  guint g, i, I, k, Ncat = ((OscatsModelNominal*)model)->Ncat;
+  gdouble cov = 0, z, numer, denom;
+  const gdouble *theta;
+  g_return_if_fail(resp <= Ncat);
+  for (i=model->Np-model->Ncov, I=0; i < model->Np; i++, I++)
+    cov += oscats_covariates_get(covariates, model->covariates[I]) * model->params[i];
+  for (g=0; g < num; g++)
+  {
+    theta = thetas + g*stride;
+    numer = denom = 1;
+    for (k=0; k < Ncat; k++)
+    {
+      z = cov - model->params[PARAM_B*Ncat+k];
+      for (i=0; i < model->Ndims; i++)
+        z += model->params[(PARAM_A_FIRST+i)*Ncat+k] * theta[dims[i]];
+      denom += (z = exp(z));
+      if (k+1 == resp) numer = z;
+    }
+    P[g] = numer / denom;
+  }
+}
+
 static gdouble distance(const OscatsModel *model, const OscatsPoint *theta,
                         const OscatsCovariates *covariates)
 {
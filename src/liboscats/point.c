@@ -232,6 +232,82 @@ void oscats_point_copy(OscatsPoint *lhs, const OscatsPoint *rhs)
   for (i=0; i < num; i++) lhs->nat[i] = rhs->nat[i];
 }
 
+/**
+ * oscats_point_first_pattern:
+ * @point: an #OscatsPoint
+ *
+ * Sets all of the discrete dimensions of @point to zero, the first
+ * pattern visited by oscats_point_next_pattern().  Continuous dimensions
+ * are unchanged.
+ */
+void oscats_point_first_pattern(OscatsPoint *point)
+{
+  guint i;
+  g_return_if_fail(OSCATS_IS_POINT(point));
+  if (point->bin) g_bit_array_reset(point->bin, FALSE);
+  for (i=0; i < point->space->num_nat; i++)
+    point->nat[i] = 0;
+}
+
+/**
+ * oscats_point_next_pattern:
+ * @point: an #OscatsPoint
+ * @step: the step number, 1 &lt;= @step &lt; oscats_space_num_patterns()
+ * @index: (inout) (allow-none): the index of the current pattern
+ *
+ * Visits the discrete patterns of @point's space in reflected Gray code
+ * order.  Starting from oscats_point_first_pattern() and calling this
+ * function with @step = 1, 2, ..., N-1, where N is
+ * oscats_space_num_patterns(), visits every pattern exactly once.  Each
+ * step changes exactly one discrete dimension, by flipping a binary
+ * dimension or moving a natural dimension up or down by one, so that
+ * quantities depending on the pattern can be updated incrementally.
+ * Continuous dimensions are unchanged.
+ *
+ * If @index is not %NULL, it is updated from the index of the current
+ * pattern to the index of the new one, in the ordering of
+ * oscats_space_num_patterns().
+ *
+ * Returns: the dimension that changed
+ */
+OscatsDim oscats_point_next_pattern(OscatsPoint *point, guint step, guint *index)
+{
+  const OscatsSpace *space;
+  guint i, q = step, r, d, weight = 1, num;
+  gboolean down;
+  g_return_val_if_fail(OSCATS_IS_POINT(point) && step > 0, 0);
+  space = point->space;
+  num = space->num_bin + space->num_nat;
+
+  // The changed digit is the lowest nonzero digit of step in mixed radix.
+  // It moves down if the number formed by the higher digits is odd.
+  for (i=0; i < num; i++)
+  {
+    r = (i < space->num_bin ? 2 : space->max[i-space->num_bin]+1u);
+    d = q % r;
+    q /= r;
+    if (d) break;
+    weight *= r;
+  }
+  g_return_val_if_fail(i < num, 0);
+  down = q & 1;
+
+  if (index)
+  {
+    if (down) *index -= weight;
+    else *index += weight;
+  }
+  if (i < space->num_bin)
+  {
+    g_bit_array_flip_bit(point->bin, i);
+    return OSCATS_DIM_BIN | i;
+  }
+  i -= space->num_bin;
+  if (down) point->nat[i]--;
+  else point->nat[i]++;
+  return OSCATS_DIM_NAT | i;
+}
+
 /**
  * oscats_point_get_double:
  * @point: an #OscatsPoint
@@ -56,6 +56,8 @@ gboolean oscats_point_same_space(const OscatsPoint *lhs, const OscatsPoint *rhs)
 gboolean oscats_point_space_compatible(const OscatsPoint *lhs, const OscatsPoint *rhs);
 gboolean oscats_point_equal(const OscatsPoint *lhs, const OscatsPoint *rhs, gdouble tol);
 void oscats_point_copy(OscatsPoint *lhs, const OscatsPoint *rhs);
+void oscats_point_first_pattern(OscatsPoint *point);
+OscatsDim oscats_point_next_pattern(OscatsPoint *point, guint step, guint *index);
 gdouble oscats_point_get_double(const OscatsPoint *point, OscatsDim dim);
 gdouble oscats_point_get_cont(const OscatsPoint *point, OscatsDim dim);
 gboolean oscats_point_get_bin(const OscatsPoint *point, OscatsDim dim);
@@ -21,8 +21,15 @@
  * @title:Random
  * @short_description: Wrapper for GSL random number generators and
  * distribution functions
+ *
+ * The oscats_rnd_*() functions draw from a single library-wide generator
+ * with a random seed, which is locked while in use.  For reproducible or
+ * parallel simulations, create an #OscatsRng with a known seed and use
+ * the corresponding oscats_rng_*() functions, deriving a separate
+ * substream for each thread or examinee.
  */
 
+#include <math.h>
 #include <gsl/gsl_rng.h>
 #include <gsl/gsl_randist.h>
 #include <gsl/gsl_cdf.h>
@@ -32,11 +39,495 @@
 #include "gsl.h"
 #include "random.h"
 
-static gsl_rng *global_rng = NULL;
+/*
+ * Philox4x32-10 counter-based generator (Salmon et al., 2011), as a GSL
+ * generator type.  Block j of stream s under key k is the encryption of
+ * the counter (j, s), so streams need no state beyond their number.
+ */
+#define PHILOX_M0 0xD2511F53
+#define PHILOX_M1 0xCD9E8D57
+#define PHILOX_W0 0x9E3779B9
+#define PHILOX_W1 0xBB67AE85
+
+typedef struct {
+  guint32 ctr[4], key[2], out[4];
+  guint idx;
+} philox_state_t;
+
+static void philox_block(philox_state_t *state)
+{
+  guint32 c0 = state->ctr[0], c1 = state->ctr[1];
+  guint32 c2 = state->ctr[2], c3 = state->ctr[3];
+  guint32 k0 = state->key[0], k1 = state->key[1];
+  guint64 p0, p1;
+  guint i;
+  for (i=0; i < 10; i++)
+  {
+    p0 = (guint64)PHILOX_M0 * c0;
+    p1 = (guint64)PHILOX_M1 * c2;
+    c0 = (guint32)(p1 >> 32) ^ c1 ^ k0;
+    c1 = (guint32)p1;
+    c2 = (guint32)(p0 >> 32) ^ c3 ^ k1;
+    c3 = (guint32)p0;
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+  state->out[0] = c0;  state->out[1] = c1;
+  state->out[2] = c2;  state->out[3] = c3;
+  state->idx = 0;
+  if (++state->ctr[0] == 0) state->ctr[1]++;	// Next block
+}
+
+static unsigned long int philox_get(void *vstate)
+{
+  philox_state_t *state = vstate;
+  if (state->idx == 4) philox_block(state);
+  return state->out[state->idx++];
+}
+
+static double philox_get_double(void *vstate)
+{
+  return philox_get(vstate) / 4294967296.0;
+}
+
+static void philox_set(void *vstate, unsigned long int seed)
+{
+  philox_state_t *state = vstate;
+  guint64 s = seed;
+  state->key[0] = (guint32)s;
+  state->key[1] = (guint32)(s >> 32);
+  state->ctr[0] = state->ctr[1] = state->ctr[2] = state->ctr[3] = 0;
+  state->idx = 4;
+}
+
+static const gsl_rng_type philox_type = {
+  "philox4x32-10", 0xffffffffUL, 0, sizeof(philox_state_t),
+  &philox_set, &philox_get, &philox_get_double
+};
+
+/*
+ * Fills out[0..n-1] with the same words as n calls to philox_get().
+ * Whole blocks are generated PHILOX_LANES at a time, with each lane
+ * working on its own counter, so that the rounds can be vectorized.
+ */
+#define PHILOX_LANES 8
+static void philox_fill(philox_state_t *state, guint32 *out, gsize n)
+{
+  guint32 c0[PHILOX_LANES], c1[PHILOX_LANES], c2[PHILOX_LANES],
+          c3[PHILOX_LANES];
+  guint32 k0, k1;
+  guint64 ctr, p0, p1;
+  guint i, j;
+
+  // Finish the current block
+  while (n > 0 && state->idx < 4)
+  {
+    *(out++) = state->out[state->idx++];
+    n--;
+  }
+
+  ctr = state->ctr[0] | ((guint64)state->ctr[1] << 32);
+  while (n >= 4*PHILOX_LANES)
+  {
+    k0 = state->key[0];  k1 = state->key[1];
+    for (j=0; j < PHILOX_LANES; j++)
+    {
+      c0[j] = (guint32)(ctr + j);
+      c1[j] = (guint32)((ctr + j) >> 32);
+      c2[j] = state->ctr[2];
+      c3[j] = state->ctr[3];
+    }
+    for (i=0; i < 10; i++)
+    {
+      for (j=0; j < PHILOX_LANES; j++)
+      {
+        p0 = (guint64)PHILOX_M0 * c0[j];
+        p1 = (guint64)PHILOX_M1 * c2[j];
+        c0[j] = (guint32)(p1 >> 32) ^ c1[j] ^ k0;
+        c1[j] = (guint32)p1;
+        c2[j] = (guint32)(p0 >> 32) ^ c3[j] ^ k1;
+        c3[j] = (guint32)p0;
+      }
+      k0 += PHILOX_W0;
+      k1 += PHILOX_W1;
+    }
+    for (j=0; j < PHILOX_LANES; j++)
+    {
+      out[0] = c0[j];  out[1] = c1[j];
+      out[2] = c2[j];  out[3] = c3[j];
+      out += 4;
+    }
+    ctr += PHILOX_LANES;
+    n -= 4*PHILOX_LANES;
+  }
+  state->ctr[0] = (guint32)ctr;
+  state->ctr[1] = (guint32)(ctr >> 32);
+
+  // Remaining blocks, one at a time
+  while (n > 0)
+  {
+    philox_block(state);
+    while (n > 0 && state->idx < 4)
+    {
+      *(out++) = state->out[state->idx++];
+      n--;
+    }
+  }
+}
+
+// Restarts rng at the beginning of its seed and stream
+static void philox_restart(OscatsRng *rng)
+{
+  philox_state_t *state = rng->v->state;
+  state->key[0] = (guint32)rng->seed;
+  state->key[1] = (guint32)(rng->seed >> 32);
+  state->ctr[0] = state->ctr[1] = 0;
+  state->ctr[2] = (guint32)rng->stream;
+  state->ctr[3] = (guint32)(rng->stream >> 32);
+  state->idx = 4;
+}
+
+// SplitMix64 finalizer, used to spread substream numbers
+static guint64 mix64(guint64 z)
+{
+  z = (z ^ (z >> 30)) * G_GUINT64_CONSTANT(0xbf58476d1ce4e5b9);
+  z = (z ^ (z >> 27)) * G_GUINT64_CONSTANT(0x94d049bb133111eb);
+  return z ^ (z >> 31);
+}
+
+/*
+ * Bulk normal variates by the Ziggurat method (Marsaglia & Tsang, 2000)
+ * with 128 layers.  The layer and the candidate value are taken from
+ * separate words, which are drawn from the generator in blocks.
+ */
+#define ZIG_LAYERS 128
+#define ZIG_R 3.442619855899
+#define ZIG_V 9.91256303526217e-3
+#define ZIG_BUF 256
+
+static guint32 zig_k[ZIG_LAYERS];
+static gdouble zig_w[ZIG_LAYERS], zig_f[ZIG_LAYERS];
+
+static void zig_init()
+{
+  static gsize ready = 0;
+  const gdouble m = 2147483648.0;
+  gdouble d = ZIG_R, t = ZIG_R, q = ZIG_V/exp(-0.5*ZIG_R*ZIG_R);
+  guint i;
+  if (!g_once_init_enter(&ready)) return;
+  zig_k[0] = (guint32)((d/q)*m);
+  zig_k[1] = 0;
+  zig_w[0] = q/m;
+  zig_w[ZIG_LAYERS-1] = d/m;
+  zig_f[0] = 1;
+  zig_f[ZIG_LAYERS-1] = exp(-0.5*d*d);
+  for (i=ZIG_LAYERS-2; i >= 1; i--)
+  {
+    d = sqrt(-2*log(ZIG_V/d + exp(-0.5*d*d)));
+    zig_k[i+1] = (guint32)((d/t)*m);
+    t = d;
+    zig_f[i] = exp(-0.5*d*d);
+    zig_w[i] = d/m;
+  }
+  g_once_init_leave(&ready, 1);
+}
+
+typedef struct {
+  philox_state_t *state;
+  guint32 buf[ZIG_BUF];
+  guint pos;
+} zig_words_t;
+
+static inline guint32 zig_word(zig_words_t *w)
+{
+  if (w->pos == ZIG_BUF)
+  {
+    philox_fill(w->state, w->buf, ZIG_BUF);
+    w->pos = 0;
+  }
+  return w->buf[w->pos++];
+}
+
+// Uniform on (0,1)
+static inline gdouble zig_uniform(zig_words_t *w)
+{
+  return (zig_word(w) + 0.5) / 4294967296.0;
+}
+
+static gdouble zig_normal(zig_words_t *w)
+{
+  gint32 hz;
+  guint32 ahz;
+  guint iz;
+  gdouble x, y;
+  for (;;)
+  {
+    hz = (gint32)zig_word(w);
+    iz = zig_word(w) & (ZIG_LAYERS-1);
+    ahz = ( hz < 0 ? (guint32)(-(gint64)hz) : (guint32)hz );
+    x = hz * zig_w[iz];
+    if (ahz < zig_k[iz]) return x;		// Inside the rectangle
+    if (iz == 0)				// Base strip: sample the tail
+    {
+      do {
+        x = -log(zig_uniform(w)) / ZIG_R;
+        y = -log(zig_uniform(w));
+      } while (y+y < x*x);
+      return ( hz > 0 ? ZIG_R+x : -ZIG_R-x );
+    }
+    if (zig_f[iz] + zig_uniform(w)*(zig_f[iz-1]-zig_f[iz]) < exp(-0.5*x*x))
+      return x;
+  }
+}
+
+// Fills x[i*tda+j] with N(0, sd^2) variates, for i < rows and j < cols
+static void normal_fill(OscatsRng *rng, gdouble sd, gdouble *x,
+                        gsize rows, gsize cols, gsize tda)
+{
+  zig_words_t w;
+  gsize i, j;
+  zig_init();
+  w.state = rng->v->state;
+  w.pos = ZIG_BUF;
+  for (i=0; i < rows; i++)
+    for (j=0; j < cols; j++)
+      x[i*tda+j] = sd * zig_normal(&w);
+}
+
+/*
+ * Gamma(a, 1) variates by the method of Marsaglia & Tsang (2000), taking
+ * the normal and uniform draws from the same block of words.  For a < 1,
+ * Gamma(a+1) U^(1/a) is used.  d = a' - 1/3 and c = 1/sqrt(9d) are
+ * computed by the caller for a' = max(a, a+1).
+ */
+static gdouble zig_gamma(zig_words_t *w, gdouble a, gdouble d, gdouble c)
+{
+  gdouble x, v, u;
+  for (;;)
+  {
+    do {
+      x = zig_normal(w);
+      v = 1 + c*x;
+    } while (v <= 0);
+    v = v*v*v;
+    u = zig_uniform(w);
+    if (u < 1 - 0.0331*x*x*x*x) break;
+    if (log(u) < 0.5*x*x + d*(1 - v + log(v))) break;
+  }
+  if (a < 1) return d*v * pow(zig_uniform(w), 1/a);
+  return d*v;
+}
+
+enum {
+  PROP_0,
+  PROP_SEED,
+  PROP_STREAM,
+};
+
+G_DEFINE_TYPE(OscatsRng, oscats_rng, G_TYPE_OBJECT);
+
+static void oscats_rng_finalize (GObject *object);
+static void oscats_rng_set_property(GObject *object, guint prop_id,
+                                    const GValue *value, GParamSpec *pspec);
+static void oscats_rng_get_property(GObject *object, guint prop_id,
+                                    GValue *value, GParamSpec *pspec);
+
+static void oscats_rng_class_init (OscatsRngClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+  GParamSpec *pspec;
+
+  gobject_class->finalize = oscats_rng_finalize;
+  gobject_class->set_property = oscats_rng_set_property;
+  gobject_class->get_property = oscats_rng_get_property;
+
+/**
+ * OscatsRng:seed:
+ *
+ * The key of the generator.  Generators with different seeds produce
+ * unrelated sequences.
+ */
+  pspec = g_param_spec_uint64("seed", "Seed", 
+                            "Random number generator seed",
+                            0, G_MAXUINT64, 0,
+                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_SEED, pspec);
+
+/**
+ * OscatsRng:stream:
+ *
+ * The stream number.  Each of the 2^64 streams for a given
+ * #OscatsRng:seed is an independent sequence of 2^66 numbers.  Setting
+ * either property restarts the generator.
+ */
+  pspec = g_param_spec_uint64("stream", "Stream", 
+                            "Random number stream",
+                            0, G_MAXUINT64, 0,
+                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT |
+                            G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                            G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_STREAM, pspec);
+
+}
+
+static void oscats_rng_init (OscatsRng *self)
+{
+  self->v = gsl_rng_alloc(&philox_type);
+}
+
+static void oscats_rng_finalize (GObject *object)
+{
+  OscatsRng *self = OSCATS_RNG(object);
+  if (self->v) gsl_rng_free(self->v);
+  G_OBJECT_CLASS(oscats_rng_parent_class)->finalize(object);
+}
+
+static void oscats_rng_set_property(GObject *object, guint prop_id,
+                                    const GValue *value, GParamSpec *pspec)
+{
+  OscatsRng *self = OSCATS_RNG(object);
+  switch (prop_id)
+  {
+    case PROP_SEED:
+      self->seed = g_value_get_uint64(value);
+      philox_restart(self);
+      break;
+    
+    case PROP_STREAM:
+      self->stream = g_value_get_uint64(value);
+      philox_restart(self);
+      break;
+    
+    default:
+      // Unknown property
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+static void oscats_rng_get_property(GObject *object, guint prop_id,
+                                    GValue *value, GParamSpec *pspec)
+{
+  OscatsRng *self = OSCATS_RNG(object);
+  switch (prop_id)
+  {
+    case PROP_SEED:
+      g_value_set_uint64(value, self->seed);
+      break;
+    
+    case PROP_STREAM:
+      g_value_set_uint64(value, self->stream);
+      break;
+    
+    default:
+      // Unknown property
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+}
+
+/**
+ * oscats_rng_new:
+ * @seed: the generator's seed
+ *
+ * Creates a new random number generator with the given @seed, starting at
+ * stream 0.  A given #OscatsRng may only be used by one thread at a time;
+ * use oscats_rng_substream() to give each thread (or each examinee) its
+ * own generator.  Unlike the oscats_rnd_*() functions, the sequence
+ * produced is entirely determined by the seed and stream.
+ *
+ * Returns: (transfer full): a new #OscatsRng
+ */
+OscatsRng * oscats_rng_new(guint64 seed)
+{
+  return g_object_new(OSCATS_TYPE_RNG, "seed", seed, NULL);
+}
+
+/**
+ * oscats_rng_substream:
+ * @rng: an #OscatsRng
+ * @id: the substream number
+ *
+ * Derives a new generator from @rng that shares its seed, but uses a
+ * stream determined by @rng's stream and @id.  The result does not
+ * depend on how far @rng has advanced, so deriving substreams from a
+ * shared parent by (say) examinee or replication number gives the same
+ * sequences no matter which thread, or in what order, they are used.
+ * Substreams may themselves be divided further.
+ *
+ * Returns: (transfer full): a new #OscatsRng
+ */
+OscatsRng * oscats_rng_substream(const OscatsRng *rng, guint64 id)
+{
+  OscatsRng *sub;
+  g_return_val_if_fail(OSCATS_IS_RNG(rng), NULL);
+  sub = g_object_new(OSCATS_TYPE_RNG, "seed", rng->seed, NULL);
+  oscats_rng_set_substream(sub, rng, id);
+  return sub;
+}
+
+/**
+ * oscats_rng_set_substream:
+ * @rng: the #OscatsRng to reset
+ * @parent: an #OscatsRng (may be @rng)
+ * @id: the substream number
+ *
+ * Restarts @rng as the substream @id of @parent, as by
+ * oscats_rng_substream(), but without allocating a new generator.
+ * @parent is only read, so it may be shared by several threads.
+ */
+void oscats_rng_set_substream(OscatsRng *rng, const OscatsRng *parent,
+                              guint64 id)
+{
+  g_return_if_fail(OSCATS_IS_RNG(rng) && OSCATS_IS_RNG(parent));
+  rng->seed = parent->seed;
+  rng->stream = mix64(parent->stream ^ mix64(id + 1));
+  philox_restart(rng);
+}
+
+/**
+ * oscats_rng_hash_string:
+ * @str: (allow-none): a string
+ *
+ * Computes a 64-bit hash of @str (FNV-1a), suitable for deriving a
+ * substream number from a name, such as an examinee's id.
+ *
+ * Returns: the hash of @str, or 0 if @str is %NULL
+ */
+guint64 oscats_rng_hash_string(const gchar *str)
+{
+  guint64 h = G_GUINT64_CONSTANT(0xcbf29ce484222325);
+  if (!str) return 0;
+  for (; *str; str++)
+    h = (h ^ (guchar)*str) * G_GUINT64_CONSTANT(0x100000001b3);
+  return h;
+}
+
+static OscatsRng *global_rng = NULL;
+G_LOCK_DEFINE_STATIC(global_rng);
 
-#define CHECK_INIT { if (!global_rng) {					\
-  global_rng = gsl_rng_alloc(gsl_rng_mt19937);				\
-  gsl_rng_set(global_rng, g_random_int()); }}
+// The generator is shared by all threads, so it is held locked while in use
+#define CHECK_INIT { G_LOCK(global_rng); if (!global_rng) 		\
+  global_rng = oscats_rng_new(((guint64)g_random_int() << 32) | g_random_int()); }
+#define DONE G_UNLOCK(global_rng)
+
+/**
+ * oscats_rng_uniform_int:
+ * @rng: an #OscatsRng
+ *
+ * Like oscats_rnd_uniform_int(), but draws from @rng.
+ *
+ * Returns: as for oscats_rnd_uniform_int()
+ */
+guint32 oscats_rng_uniform_int(OscatsRng *rng)
+{
+  guint32 ret;
+  g_return_val_if_fail(OSCATS_IS_RNG(rng), 0);
+  ret = gsl_rng_get(rng->v);
+  return ret;
+}
 
 /**
  * oscats_rnd_uniform_int:
@@ -45,8 +536,32 @@ static gsl_rng *global_rng = NULL;
  */
 guint32 oscats_rnd_uniform_int()
 {
+  guint32 ret;
   CHECK_INIT;
-  return gsl_rng_get(global_rng);
+  ret = oscats_rng_uniform_int(global_rng);
+  DONE;
+  return ret;
+}
+
+/**
+ * oscats_rng_uniform_int_range:
+ * @rng: an #OscatsRng
+ * @min: as for oscats_rnd_uniform_int_range()
+ * @max: as for oscats_rnd_uniform_int_range()
+ *
+ * Like oscats_rnd_uniform_int_range(), but draws from @rng.
+ *
+ * Returns: as for oscats_rnd_uniform_int_range()
+ */
+gint oscats_rng_uniform_int_range(OscatsRng *rng, gint min, gint max)
+{
+  gint ret;
+  guint range = max-min;
+  g_return_val_if_fail(OSCATS_IS_RNG(rng), 0);
+  if (range == 0) return min;
+  g_return_val_if_fail(range >= 0, 0);
+  ret = (gint)((range+1)*gsl_rng_uniform(rng->v)) + min;
+  return ret;
 }
 
 /**
@@ -58,11 +573,27 @@ guint32 oscats_rnd_uniform_int()
  */
 gint oscats_rnd_uniform_int_range(gint min, gint max)
 {
-  guint range = max-min;
-  if (range == 0) return min;
-  g_return_val_if_fail(range >= 0, 0);
+  gint ret;
   CHECK_INIT;
-  return (gint)((range+1)*gsl_rng_uniform(global_rng)) + min;
+  ret = oscats_rng_uniform_int_range(global_rng, min, max);
+  DONE;
+  return ret;
+}
+
+/**
+ * oscats_rng_uniform:
+ * @rng: an #OscatsRng
+ *
+ * Like oscats_rnd_uniform(), but draws from @rng.
+ *
+ * Returns: as for oscats_rnd_uniform()
+ */
+gdouble oscats_rng_uniform(OscatsRng *rng)
+{
+  gdouble ret;
+  g_return_val_if_fail(OSCATS_IS_RNG(rng), 0);
+  ret = gsl_rng_uniform(rng->v);
+  return ret;
 }
 
 /**
@@ -72,8 +603,30 @@ gint oscats_rnd_uniform_int_range(gint min, gint max)
  */
 gdouble oscats_rnd_uniform()
 {
+  gdouble ret;
   CHECK_INIT;
-  return gsl_rng_uniform(global_rng);
+  ret = oscats_rng_uniform(global_rng);
+  DONE;
+  return ret;
+}
+
+/**
+ * oscats_rng_uniform_range:
+ * @rng: an #OscatsRng
+ * @min: as for oscats_rnd_uniform_range()
+ * @max: as for oscats_rnd_uniform_range()
+ *
+ * Like oscats_rnd_uniform_range(), but draws from @rng.
+ *
+ * Returns: as for oscats_rnd_uniform_range()
+ */
+gdouble oscats_rng_uniform_range(OscatsRng *rng, gdouble min, gdouble max)
+{
+  gdouble ret;
+  g_return_val_if_fail(OSCATS_IS_RNG(rng), 0);
+  g_return_val_if_fail(min < max, 0);
+  ret = gsl_ran_flat(rng->v, min, max);
+  return ret;
 }
 
 /**
@@ -85,9 +638,81 @@ gdouble oscats_rnd_uniform()
  */
 gdouble oscats_rnd_uniform_range(gdouble min, gdouble max)
 {
-  g_return_val_if_fail(min < max, 0);
+  gdouble ret;
+  CHECK_INIT;
+  ret = oscats_rng_uniform_range(global_rng, min, max);
+  DONE;
+  return ret;
+}
+
+/**
+ * oscats_rng_uniform_fill:
+ * @rng: an #OscatsRng
+ * @min: as for oscats_rnd_uniform_fill()
+ * @max: as for oscats_rnd_uniform_fill()
+ * @x: as for oscats_rnd_uniform_fill()
+ *
+ * Like oscats_rnd_uniform_fill(), but draws from @rng.  The values are
+ * the same as those given by successive calls to
+ * oscats_rng_uniform_range().
+ */
+void oscats_rng_uniform_fill(OscatsRng *rng, gdouble min, gdouble max,
+                             GGslVector *x)
+{
+  guint32 buf[ZIG_BUF];
+  gdouble *data, u;
+  gsize i, j, n, stride;
+  g_return_if_fail(OSCATS_IS_RNG(rng));
+  g_return_if_fail(G_GSL_IS_VECTOR(x) && x->v);
+  g_return_if_fail(min < max);
+  data = x->v->data;
+  n = x->v->size;
+  stride = x->v->stride;
+  for (i=0; i < n; i += ZIG_BUF)
+  {
+    gsize m = MIN(n-i, ZIG_BUF);
+    philox_fill(rng->v->state, buf, m);
+    for (j=0; j < m; j++)
+    {
+      u = buf[j] / 4294967296.0;		// As gsl_ran_flat()
+      data[(i+j)*stride] = min*(1-u) + max*u;
+    }
+  }
+}
+
+/**
+ * oscats_rnd_uniform_fill:
+ * @min: minimum
+ * @max: maximum
+ * @x: return vector
+ *
+ * Fills @x with independent uniformly random numbers on [@min,@max).
+ * This is much faster than calling oscats_rnd_uniform_range() for each
+ * element when generating large populations.
+ */
+void oscats_rnd_uniform_fill(gdouble min, gdouble max, GGslVector *x)
+{
   CHECK_INIT;
-  return gsl_ran_flat(global_rng, min, max);
+  oscats_rng_uniform_fill(global_rng, min, max, x);
+  DONE;
+}
+
+/**
+ * oscats_rng_normal:
+ * @rng: an #OscatsRng
+ * @sd: as for oscats_rnd_normal()
+ *
+ * Like oscats_rnd_normal(), but draws from @rng.
+ *
+ * Returns: as for oscats_rnd_normal()
+ */
+gdouble oscats_rng_normal(OscatsRng *rng, gdouble sd)
+{
+  gdouble ret;
+  g_return_val_if_fail(OSCATS_IS_RNG(rng), 0);
+  g_return_val_if_fail(sd > 0, 0);
+  ret = gsl_ran_gaussian_ratio_method(rng->v, sd);
+  return ret;
 }
 
 /**
@@ -103,9 +728,46 @@ gdouble oscats_rnd_uniform_range(gdouble min, gdouble max)
  */
 gdouble oscats_rnd_normal(gdouble sd)
 {
-  g_return_val_if_fail(sd > 0, 0);
+  gdouble ret;
   CHECK_INIT;
-  return gsl_ran_gaussian_ratio_method(global_rng, sd);
+  ret = oscats_rng_normal(global_rng, sd);
+  DONE;
+  return ret;
+}
+
+/**
+ * oscats_rng_normal_fill:
+ * @rng: an #OscatsRng
+ * @sd: as for oscats_rnd_normal_fill()
+ * @x: as for oscats_rnd_normal_fill()
+ *
+ * Like oscats_rnd_normal_fill(), but draws from @rng.
+ */
+void oscats_rng_normal_fill(OscatsRng *rng, gdouble sd, GGslVector *x)
+{
+  g_return_if_fail(OSCATS_IS_RNG(rng));
+  g_return_if_fail(G_GSL_IS_VECTOR(x) && x->v);
+  g_return_if_fail(sd > 0);
+  normal_fill(rng, sd, x->v->data, x->v->size, 1, x->v->stride);
+}
+
+/**
+ * oscats_rnd_normal_fill:
+ * @sd: standard deviation
+ * @x: return vector
+ *
+ * Fills @x with independent mean-zero Normal random numbers
+ * [see oscats_rnd_normal()], using the Ziggurat method.  This is much
+ * faster than calling oscats_rnd_normal() for each element when
+ * generating large populations, but does not give the same values.
+ *
+ * Must have: @sd > 0.
+ */
+void oscats_rnd_normal_fill(gdouble sd, GGslVector *x)
+{
+  CHECK_INIT;
+  oscats_rng_normal_fill(global_rng, sd, x);
+  DONE;
 }
 
 /**
@@ -126,6 +788,26 @@ gdouble oscats_rnd_normal_p(gdouble x, gdouble sd)
   return gsl_cdf_gaussian_Q(x, sd);
 }
 
+/**
+ * oscats_rng_binorm:
+ * @rng: an #OscatsRng
+ * @sdx: as for oscats_rnd_binorm()
+ * @sdy: as for oscats_rnd_binorm()
+ * @rho: as for oscats_rnd_binorm()
+ * @X: as for oscats_rnd_binorm()
+ * @Y: as for oscats_rnd_binorm()
+ *
+ * Like oscats_rnd_binorm(), but draws from @rng.
+ */
+void oscats_rng_binorm(OscatsRng *rng, gdouble sdx, gdouble sdy, gdouble rho,
+                       gdouble *X, gdouble *Y)
+{
+  g_return_if_fail(OSCATS_IS_RNG(rng));
+  g_return_if_fail(sdx > 0 && sdy > 0 && -1 <= rho && rho <= 1);
+  g_return_if_fail(X && Y);
+  gsl_ran_bivariate_gaussian(rng->v, sdx, sdy, rho, X, Y);
+}
+
 /**
  * oscats_rnd_binorm:
  * @sdx : standard deviation for first variable
@@ -144,10 +826,9 @@ gdouble oscats_rnd_normal_p(gdouble x, gdouble sd)
 void oscats_rnd_binorm(gdouble sdx, gdouble sdy, gdouble rho,
                        gdouble *X, gdouble *Y)
 {
-  g_return_if_fail(sdx > 0 && sdy > 0 && -1 <= rho && rho <= 1);
-  g_return_if_fail(X && Y);
   CHECK_INIT;
-  gsl_ran_bivariate_gaussian(global_rng, sdx, sdy, rho, X, Y);
+  oscats_rng_binorm(global_rng, sdx, sdy, rho, X, Y);
+  DONE;
 }
 
 /**
@@ -170,6 +851,30 @@ void oscats_rnd_multinorm_prep(const GGslMatrix *sigma, GGslMatrix *sigma_half)
   gsl_linalg_cholesky_decomp(sigma_half->v);
 }
 
+/**
+ * oscats_rng_multinorm:
+ * @rng: an #OscatsRng
+ * @mu: as for oscats_rnd_multinorm()
+ * @sigma_half: as for oscats_rnd_multinorm()
+ * @x: as for oscats_rnd_multinorm()
+ *
+ * Like oscats_rnd_multinorm(), but draws from @rng.
+ */
+void oscats_rng_multinorm(OscatsRng *rng, const GGslVector *mu,
+                          const GGslMatrix *sigma_half, GGslVector *x)
+{
+  int i, n;
+  g_return_if_fail(OSCATS_IS_RNG(rng));
+  g_return_if_fail(G_GSL_IS_VECTOR(mu) && G_GSL_IS_MATRIX(sigma_half) &&
+                   G_GSL_IS_VECTOR(x) && mu->v && sigma_half->v && x->v);
+  n = mu->v->size;
+  for (i=0; i < n; i++)
+    gsl_vector_set(x->v, i, gsl_ran_gaussian_ratio_method(rng->v, 1));
+  gsl_blas_dtrmv(CblasLower, CblasNoTrans, CblasNonUnit,
+                 sigma_half->v, x->v);  // x = Ax, A is lower triangular
+  gsl_vector_add(x->v, mu->v);
+}
+
 /**
  * oscats_rnd_multinorm:
  * @mu: mean
@@ -186,18 +891,82 @@ void oscats_rnd_multinorm_prep(const GGslMatrix *sigma, GGslMatrix *sigma_half)
 void oscats_rnd_multinorm(const GGslVector *mu, const GGslMatrix *sigma_half,
                           GGslVector *x)
 {
-  int i, n;
+  CHECK_INIT;
+  oscats_rng_multinorm(global_rng, mu, sigma_half, x);
+  DONE;
+}
+
+/**
+ * oscats_rng_multinorm_fill:
+ * @rng: an #OscatsRng
+ * @mu: as for oscats_rnd_multinorm_fill()
+ * @sigma_half: as for oscats_rnd_multinorm_fill()
+ * @x: as for oscats_rnd_multinorm_fill()
+ *
+ * Like oscats_rnd_multinorm_fill(), but draws from @rng.
+ */
+void oscats_rng_multinorm_fill(OscatsRng *rng, const GGslVector *mu,
+                               const GGslMatrix *sigma_half, GGslMatrix *x)
+{
+  gsize i;
+  g_return_if_fail(OSCATS_IS_RNG(rng));
   g_return_if_fail(G_GSL_IS_VECTOR(mu) && G_GSL_IS_MATRIX(sigma_half) &&
-                   G_GSL_IS_VECTOR(x) && mu->v && sigma_half->v && x->v);
+                   G_GSL_IS_MATRIX(x) && mu->v && sigma_half->v && x->v);
+  g_return_if_fail(x->v->size2 == mu->v->size &&
+                   sigma_half->v->size1 == mu->v->size &&
+                   sigma_half->v->size2 == mu->v->size);
+  normal_fill(rng, 1, x->v->data, x->v->size1, x->v->size2, x->v->tda);
+  // Each row z' becomes z'A' = (Az)'
+  gsl_blas_dtrmm(CblasRight, CblasLower, CblasTrans, CblasNonUnit, 1,
+                 sigma_half->v, x->v);
+  for (i=0; i < x->v->size1; i++)
+  {
+    gsl_vector_view row = gsl_matrix_row(x->v, i);
+    gsl_vector_add(&row.vector, mu->v);
+  }
+}
+
+/**
+ * oscats_rnd_multinorm_fill:
+ * @mu: mean
+ * @sigma_half: half of covariance matrix
+ * @x: return matrix, one random vector per row
+ *
+ * Fills each row of @x with an independent multivariate normal random
+ * vector, as for oscats_rnd_multinorm().  The standard normal draws for
+ * all rows are generated together and transformed with a single
+ * triangular matrix product, which is much faster than calling
+ * oscats_rnd_multinorm() for each row.
+ *
+ * Must have: @sigma_half lower-triangular with the same size as @mu, and
+ * as many columns in @x as elements in @mu.
+ */
+void oscats_rnd_multinorm_fill(const GGslVector *mu,
+                               const GGslMatrix *sigma_half, GGslMatrix *x)
+{
   CHECK_INIT;
-  n = mu->v->size;
-  for (i=0; i < n; i++)
-    gsl_vector_set(x->v, i, gsl_ran_gaussian_ratio_method(global_rng, 1));
-  gsl_blas_dtrmv(CblasLower, CblasNoTrans, CblasNonUnit,
-                 sigma_half->v, x->v);  // x = Ax, A is lower triangular
-  gsl_vector_add(x->v, mu->v);
+  oscats_rng_multinorm_fill(global_rng, mu, sigma_half, x);
+  DONE;
 }
                           
+/**
+ * oscats_rng_exp:
+ * @rng: an #OscatsRng
+ * @mu: as for oscats_rnd_exp()
+ *
+ * Like oscats_rnd_exp(), but draws from @rng.
+ *
+ * Returns: as for oscats_rnd_exp()
+ */
+gdouble oscats_rng_exp(OscatsRng *rng, gdouble mu)
+{
+  gdouble ret;
+  g_return_val_if_fail(OSCATS_IS_RNG(rng), 0);
+  g_return_val_if_fail(mu > 0, 0);
+  ret = gsl_ran_exponential(rng->v, mu);
+  return ret;
+}
+
 /**
  * oscats_ran_exp:
  * @mu: mean
@@ -211,9 +980,29 @@ void oscats_rnd_multinorm(const GGslVector *mu, const GGslMatrix *sigma_half,
  */
 gdouble oscats_rnd_exp(gdouble mu)
 {
-  g_return_val_if_fail(mu > 0, 0);
+  gdouble ret;
   CHECK_INIT;
-  return gsl_ran_exponential(global_rng, mu);
+  ret = oscats_rng_exp(global_rng, mu);
+  DONE;
+  return ret;
+}
+
+/**
+ * oscats_rng_gamma:
+ * @rng: an #OscatsRng
+ * @a: as for oscats_rnd_gamma()
+ * @b: as for oscats_rnd_gamma()
+ *
+ * Like oscats_rnd_gamma(), but draws from @rng.
+ *
+ * Returns: as for oscats_rnd_gamma()
+ */
+gdouble oscats_rng_gamma(OscatsRng *rng, gdouble a, gdouble b)
+{
+  gdouble ret;
+  g_return_val_if_fail(OSCATS_IS_RNG(rng), 0);
+  ret = gsl_ran_gamma(rng->v, a, b);
+  return ret;
 }
 
 /**
@@ -228,8 +1017,11 @@ gdouble oscats_rnd_exp(gdouble mu)
  */
 gdouble oscats_rnd_gamma(gdouble a, gdouble b)
 {
+  gdouble ret;
   CHECK_INIT;
-  return gsl_ran_gamma(global_rng, a, b);
+  ret = oscats_rng_gamma(global_rng, a, b);
+  DONE;
+  return ret;
 }
 
 /**
@@ -290,6 +1082,24 @@ gdouble oscats_rnd_t_p(gdouble x, gdouble nu)
   return gsl_cdf_tdist_Q(x, nu);
 }
 
+/**
+ * oscats_rng_beta:
+ * @rng: an #OscatsRng
+ * @a: as for oscats_rnd_beta()
+ * @b: as for oscats_rnd_beta()
+ *
+ * Like oscats_rnd_beta(), but draws from @rng.
+ *
+ * Returns: as for oscats_rnd_beta()
+ */
+gdouble oscats_rng_beta(OscatsRng *rng, gdouble a, gdouble b)
+{
+  gdouble ret;
+  g_return_val_if_fail(OSCATS_IS_RNG(rng), 0);
+  ret = gsl_ran_beta(rng->v, a, b);
+  return ret;
+}
+
 /**
  * oscats_ran_beta:
  * @a: shape parameter
@@ -303,8 +1113,28 @@ gdouble oscats_rnd_t_p(gdouble x, gdouble nu)
  */
 gdouble oscats_rnd_beta(gdouble a, gdouble b)
 {
+  gdouble ret;
   CHECK_INIT;
-  return gsl_ran_beta(global_rng, a, b);
+  ret = oscats_rng_beta(global_rng, a, b);
+  DONE;
+  return ret;
+}
+
+/**
+ * oscats_rng_dirichlet:
+ * @rng: an #OscatsRng
+ * @alpha: as for oscats_rnd_dirichlet()
+ * @x: as for oscats_rnd_dirichlet()
+ *
+ * Like oscats_rnd_dirichlet(), but draws from @rng.
+ */
+void oscats_rng_dirichlet(OscatsRng *rng, const GGslVector *alpha,
+                          GGslVector *x)
+{
+  g_return_if_fail(OSCATS_IS_RNG(rng));
+  g_return_if_fail(G_GSL_IS_VECTOR(alpha) && G_GSL_IS_VECTOR(x) &&
+                   alpha->v && x->v && alpha->v->size == x->v->size);
+  gsl_ran_dirichlet(rng->v, alpha->v->size, alpha->v->data, x->v->data);
 }
 
 /**
@@ -319,10 +1149,91 @@ gdouble oscats_rnd_beta(gdouble a, gdouble b)
  */
 void oscats_rnd_dirichlet(const GGslVector *alpha, GGslVector *x)
 {
-  g_return_if_fail(G_GSL_IS_VECTOR(alpha) && G_GSL_IS_VECTOR(x) &&
-                   alpha->v && x->v && alpha->v->size == x->v->size);
   CHECK_INIT;
-  gsl_ran_dirichlet(global_rng, alpha->v->size, alpha->v->data, x->v->data);
+  oscats_rng_dirichlet(global_rng, alpha, x);
+  DONE;
+}
+
+/**
+ * oscats_rng_dirichlet_fill:
+ * @rng: an #OscatsRng
+ * @alpha: as for oscats_rnd_dirichlet_fill()
+ * @x: as for oscats_rnd_dirichlet_fill()
+ *
+ * Like oscats_rnd_dirichlet_fill(), but draws from @rng.
+ */
+void oscats_rng_dirichlet_fill(OscatsRng *rng, const GGslVector *alpha,
+                               GGslMatrix *x)
+{
+  zig_words_t w;
+  gsize i, j, K;
+  gdouble sum, *row, *a, *d, *c;
+  g_return_if_fail(OSCATS_IS_RNG(rng));
+  g_return_if_fail(G_GSL_IS_VECTOR(alpha) && G_GSL_IS_MATRIX(x) &&
+                   alpha->v && x->v && alpha->v->size == x->v->size2);
+  g_return_if_fail(gsl_vector_min(alpha->v) > 0);
+  K = x->v->size2;
+  a = g_new(gdouble, 3*K);
+  d = a+K;
+  c = d+K;
+  for (j=0; j < K; j++)
+  {
+    a[j] = gsl_vector_get(alpha->v, j);
+    d[j] = (a[j] < 1 ? a[j]+1 : a[j]) - 1.0/3;
+    c[j] = 1/sqrt(9*d[j]);
+  }
+  zig_init();
+  w.state = rng->v->state;
+  w.pos = ZIG_BUF;
+  for (i=0; i < x->v->size1; i++)
+  {
+    row = x->v->data + i*x->v->tda;
+    sum = 0;
+    for (j=0; j < K; j++)
+      sum += row[j] = zig_gamma(&w, a[j], d[j], c[j]);
+    for (j=0; j < K; j++)
+      row[j] /= sum;
+  }
+  g_free(a);
+}
+
+/**
+ * oscats_rnd_dirichlet_fill:
+ * @alpha: parameter vector
+ * @x: return matrix, one random vector per row
+ *
+ * Fills each row of @x with an independent Dirichlet random vector, as
+ * for oscats_rnd_dirichlet().  The Gamma variates behind each row are
+ * drawn by the method of Marsaglia and Tsang from Ziggurat normals, in
+ * blocks, which is much faster than calling oscats_rnd_dirichlet() for
+ * each row, but does not give the same values.
+ *
+ * Must have: as many columns in @x as elements in @alpha, and every
+ * element of @alpha positive.
+ */
+void oscats_rnd_dirichlet_fill(const GGslVector *alpha, GGslMatrix *x)
+{
+  CHECK_INIT;
+  oscats_rng_dirichlet_fill(global_rng, alpha, x);
+  DONE;
+}
+
+/**
+ * oscats_rng_poisson:
+ * @rng: an #OscatsRng
+ * @mu: as for oscats_rnd_poisson()
+ *
+ * Like oscats_rnd_poisson(), but draws from @rng.
+ *
+ * Returns: as for oscats_rnd_poisson()
+ */
+guint oscats_rng_poisson(OscatsRng *rng, gdouble mu)
+{
+  guint ret;
+  g_return_val_if_fail(OSCATS_IS_RNG(rng), 0);
+  g_return_val_if_fail(mu > 0, 0);
+  ret = gsl_ran_poisson(rng->v, mu);
+  return ret;
 }
 
 /**
@@ -338,9 +1249,30 @@ void oscats_rnd_dirichlet(const GGslVector *alpha, GGslVector *x)
  */
 guint oscats_rnd_poisson(gdouble mu)
 {
-  g_return_val_if_fail(mu > 0, 0);
+  guint ret;
   CHECK_INIT;
-  return gsl_ran_poisson(global_rng, mu);
+  ret = oscats_rng_poisson(global_rng, mu);
+  DONE;
+  return ret;
+}
+
+/**
+ * oscats_rng_binomial:
+ * @rng: an #OscatsRng
+ * @n: as for oscats_rnd_binomial()
+ * @p: as for oscats_rnd_binomial()
+ *
+ * Like oscats_rnd_binomial(), but draws from @rng.
+ *
+ * Returns: as for oscats_rnd_binomial()
+ */
+guint oscats_rng_binomial(OscatsRng *rng, guint n, gdouble p)
+{
+  guint ret;
+  g_return_val_if_fail(OSCATS_IS_RNG(rng), 0);
+  g_return_val_if_fail(0 <= p && p <= 1 && n > 0, 0);
+  ret = gsl_ran_binomial(rng->v, p, n);
+  return ret;
 }
 
 /**
@@ -356,9 +1288,29 @@ guint oscats_rnd_poisson(gdouble mu)
  */
 guint oscats_rnd_binomial(guint n, gdouble p)
 {
-  g_return_val_if_fail(0 <= p && p <= 1 && n > 0, 0);
+  guint ret;
   CHECK_INIT;
-  return gsl_ran_binomial(global_rng, p, n);
+  ret = oscats_rng_binomial(global_rng, n, p);
+  DONE;
+  return ret;
+}
+
+/**
+ * oscats_rng_multinomial:
+ * @rng: an #OscatsRng
+ * @n: as for oscats_rnd_multinomial()
+ * @p: as for oscats_rnd_multinomial()
+ * @x: as for oscats_rnd_multinomial()
+ *
+ * Like oscats_rnd_multinomial(), but draws from @rng.
+ */
+void oscats_rng_multinomial(OscatsRng *rng, guint n, const GGslVector *p,
+                            GArray *x)
+{
+  g_return_if_fail(OSCATS_IS_RNG(rng));
+  g_return_if_fail(G_GSL_IS_VECTOR(p) && p->v && x);
+  if (p->v->size != x->len) g_array_set_size(x, p->v->size);
+  gsl_ran_multinomial(rng->v, x->len, n, p->v->data, (guint*)(x->data));
 }
 
 /**
@@ -373,11 +1325,29 @@ guint oscats_rnd_binomial(guint n, gdouble p)
  */
 void oscats_rnd_multinomial(guint n, const GGslVector *p, GArray *x)
 {
-  g_return_if_fail(G_GSL_IS_VECTOR(p) && p->v && x);
-  if (p->v->size != x->len) g_array_set_size(x, p->v->size);
   CHECK_INIT;
-  return gsl_ran_multinomial(global_rng, x->len, n, p->v->data,
-                             (guint*)(x->data));
+  oscats_rng_multinomial(global_rng, n, p, x);
+  DONE;
+}
+
+/**
+ * oscats_rng_hypergeometric:
+ * @rng: an #OscatsRng
+ * @n1: as for oscats_rnd_hypergeometric()
+ * @n2: as for oscats_rnd_hypergeometric()
+ * @N: as for oscats_rnd_hypergeometric()
+ *
+ * Like oscats_rnd_hypergeometric(), but draws from @rng.
+ *
+ * Returns: as for oscats_rnd_hypergeometric()
+ */
+guint oscats_rng_hypergeometric(OscatsRng *rng, guint n1, guint n2, guint N)
+{
+  guint ret;
+  g_return_val_if_fail(OSCATS_IS_RNG(rng), 0);
+  g_return_val_if_fail(N < n1+n2, 0);
+  ret = gsl_ran_hypergeometric(rng->v, n1, n2, N);
+  return ret;
 }
 
 /**
@@ -393,9 +1363,37 @@ void oscats_rnd_multinomial(guint n, const GGslVector *p, GArray *x)
  */
 guint oscats_rnd_hypergeometric(guint n1, guint n2, guint N)
 {
-  g_return_val_if_fail(N < n1+n2, 0);
+  guint ret;
   CHECK_INIT;
-  return gsl_ran_hypergeometric(global_rng, n1, n2, N);
+  ret = oscats_rng_hypergeometric(global_rng, n1, n2, N);
+  DONE;
+  return ret;
+}
+
+/**
+ * oscats_rng_sample:
+ * @rng: an #OscatsRng
+ * @population: as for oscats_rnd_sample()
+ * @num: as for oscats_rnd_sample()
+ * @sample: as for oscats_rnd_sample()
+ * @replace: as for oscats_rnd_sample()
+ *
+ * Like oscats_rnd_sample(), but draws from @rng.
+ */
+void oscats_rng_sample(OscatsRng *rng, const GPtrArray *population, guint num,
+                       GPtrArray *sample, gboolean replace)
+{
+  g_return_if_fail(OSCATS_IS_RNG(rng));
+  g_return_if_fail(population && sample);
+  g_return_if_fail((!replace && num <= population->len) ||
+                    (replace && population->len > 0) );
+  g_ptr_array_set_size(sample, num);
+  if (replace)
+    gsl_ran_sample(rng->v, sample->pdata, num,
+                   population->pdata, population->len, sizeof(gpointer));
+  else
+    gsl_ran_choose(rng->v, sample->pdata, num,
+                   population->pdata, population->len, sizeof(gpointer));
 }
 
 /**
@@ -411,15 +1409,7 @@ guint oscats_rnd_hypergeometric(guint n1, guint n2, guint N)
 void oscats_rnd_sample(const GPtrArray *population, guint num,
                        GPtrArray *sample, gboolean replace)
 {
-  g_return_if_fail(population && sample);
-  g_return_if_fail((!replace && population->len < num) ||
-                    (replace && population->len == 0) );
-  g_ptr_array_set_size(sample, num);
   CHECK_INIT;
-  if (replace)
-    gsl_ran_sample(global_rng, sample->pdata, num,
-                   population->pdata, population->len, sizeof(gpointer));
-  else
-    gsl_ran_choose(global_rng, sample->pdata, num,
-                   population->pdata, population->len, sizeof(gpointer));
+  oscats_rng_sample(global_rng, population, num, sample, replace);
+  DONE;
 }
@@ -18,26 +18,90 @@
 
 #ifndef _LIBOSCATS_RANDOM_H_
 #define _LIBOSCATS_RANDOM_H_
-#include <glib.h>
+#include <glib-object.h>
+#include <gsl/gsl_rng.h>
 #include "gsl.h"
 G_BEGIN_DECLS
 
+#define OSCATS_TYPE_RNG			(oscats_rng_get_type())
+#define OSCATS_RNG(obj)			(G_TYPE_CHECK_INSTANCE_CAST ((obj), OSCATS_TYPE_RNG, OscatsRng))
+#define OSCATS_IS_RNG(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), OSCATS_TYPE_RNG))
+#define OSCATS_RNG_CLASS(klass)		(G_TYPE_CHECK_CLASS_CAST ((klass), OSCATS_TYPE_RNG, OscatsRngClass))
+#define OSCATS_IS_RNG_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), OSCATS_TYPE_RNG))
+#define OSCATS_RNG_GET_CLASS(obj)	(G_TYPE_INSTANCE_GET_CLASS ((obj), OSCATS_TYPE_RNG, OscatsRngClass))
+
+typedef struct _OscatsRng OscatsRng;
+typedef struct _OscatsRngClass OscatsRngClass;
+
+struct _OscatsRng {
+  GObject parent_instance;
+  /*< private >*/
+  gsl_rng *v;
+  guint64 seed, stream;
+};
+
+struct _OscatsRngClass {
+  GObjectClass parent_class;
+};
+
+GType oscats_rng_get_type();
+
+OscatsRng * oscats_rng_new(guint64 seed);
+OscatsRng * oscats_rng_substream(const OscatsRng *rng, guint64 id);
+void oscats_rng_set_substream(OscatsRng *rng, const OscatsRng *parent,
+                              guint64 id);
+guint64 oscats_rng_hash_string(const gchar *str);
+
+guint32 oscats_rng_uniform_int(OscatsRng *rng);
+gint oscats_rng_uniform_int_range(OscatsRng *rng, gint min, gint max);
+gdouble oscats_rng_uniform(OscatsRng *rng);
+gdouble oscats_rng_uniform_range(OscatsRng *rng, gdouble min, gdouble max);
+void oscats_rng_uniform_fill(OscatsRng *rng, gdouble min, gdouble max,
+                             GGslVector *x);
+gdouble oscats_rng_normal(OscatsRng *rng, gdouble sd);
+void oscats_rng_normal_fill(OscatsRng *rng, gdouble sd, GGslVector *x);
+void oscats_rng_binorm(OscatsRng *rng, gdouble sdx, gdouble sdy, gdouble rho,
+                       gdouble *X, gdouble *Y);
+void oscats_rng_multinorm(OscatsRng *rng, const GGslVector *mu,
+                          const GGslMatrix *sigma_half, GGslVector *x);
+void oscats_rng_multinorm_fill(OscatsRng *rng, const GGslVector *mu,
+                               const GGslMatrix *sigma_half, GGslMatrix *x);
+gdouble oscats_rng_exp(OscatsRng *rng, gdouble mu);
+gdouble oscats_rng_gamma(OscatsRng *rng, gdouble a, gdouble b);
+gdouble oscats_rng_beta(OscatsRng *rng, gdouble a, gdouble b);
+void oscats_rng_dirichlet(OscatsRng *rng, const GGslVector *alpha,
+                          GGslVector *x);
+void oscats_rng_dirichlet_fill(OscatsRng *rng, const GGslVector *alpha,
+                               GGslMatrix *x);
+guint oscats_rng_poisson(OscatsRng *rng, gdouble mu);
+guint oscats_rng_binomial(OscatsRng *rng, guint n, gdouble p);
+void oscats_rng_multinomial(OscatsRng *rng, guint n, const GGslVector *p,
+                            GArray *x);
+guint oscats_rng_hypergeometric(OscatsRng *rng, guint n1, guint n2, guint N);
+void oscats_rng_sample(OscatsRng *rng, const GPtrArray *population,
+                       guint num, GPtrArray *sample, gboolean replace);
+
 guint32 oscats_rnd_uniform_int();
 gint oscats_rnd_uniform_int_range(gint min, gint max);
 gdouble oscats_rnd_uniform();
 gdouble oscats_rnd_uniform_range(gdouble min, gdouble max);
+void oscats_rnd_uniform_fill(gdouble min, gdouble max, GGslVector *x);
 
 gdouble oscats_rnd_normal(gdouble sd);
+void oscats_rnd_normal_fill(gdouble sd, GGslVector *x);
 void oscats_rnd_binorm(gdouble sdx, gdouble sdy, gdouble rho,
                        gdouble *X, gdouble *Y);
 void oscats_rnd_multinorm_prep(const GGslMatrix *sigma, GGslMatrix *sigma_half);
 void oscats_rnd_multinorm(const GGslVector *mu, const GGslMatrix *sigma_half,
                           GGslVector *x);
+void oscats_rnd_multinorm_fill(const GGslVector *mu,
+                               const GGslMatrix *sigma_half, GGslMatrix *x);
 gdouble oscats_rnd_exp(gdouble mu);
 gdouble oscats_rnd_gamma(gdouble a, gdouble b);
 gdouble oscats_rnd_beta(gdouble a, gdouble b);
 
 void oscats_rnd_dirichlet(const GGslVector *alpha, GGslVector *x);
+void oscats_rnd_dirichlet_fill(const GGslVector *alpha, GGslMatrix *x);
 guint oscats_rnd_poisson(gdouble mu);
 guint oscats_rnd_binomial(guint n, gdouble p);
 void oscats_rnd_multinomial(guint n, const GGslVector *p, GArray *x);
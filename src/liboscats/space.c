@@ -365,6 +365,32 @@ guint16 oscats_space_size(const OscatsSpace *space)
   return space->num_cont + space->num_bin + space->num_nat;
 }
 
+/**
+ * oscats_space_num_patterns:
+ * @space: an #OscatsSpace
+ *
+ * The discrete patterns of @space are the combinations of values of its
+ * binary and natural dimensions.  They are indexed so that the lowest
+ * numbered binary dimension varies fastest and the natural dimensions
+ * follow the binary dimensions (see oscats_point_next_pattern()).
+ *
+ * Returns: the number of discrete patterns (1 if @space has no discrete
+ * dimensions), or 0 if the number does not fit in a #guint
+ */
+guint oscats_space_num_patterns(const OscatsSpace *space)
+{
+  guint i, num;
+  g_return_val_if_fail(OSCATS_IS_SPACE(space), 0);
+  if (space->num_bin >= sizeof(guint)*8) return 0;
+  num = 1u << space->num_bin;
+  for (i=0; i < space->num_nat; i++)
+  {
+    if (num > G_MAXUINT/(space->max[i]+1u)) return 0;
+    num *= space->max[i]+1u;
+  }
+  return num;
+}
+
 /**
  * oscats_space_set_dim_name:
  * @space: an #OscatsSpace
@@ -90,6 +90,7 @@ struct _OscatsSpaceClass {
 GType oscats_space_get_type();
 
 guint16 oscats_space_size(const OscatsSpace *space);
+guint oscats_space_num_patterns(const OscatsSpace *space);
 void oscats_space_set_dim_name(OscatsSpace *space, OscatsDim dim, const gchar *name);
 gboolean oscats_space_has_dim(const OscatsSpace *space, GQuark name);
 gboolean oscats_space_has_dim_name(const OscatsSpace *space, const gchar *name);
@@ -22,11 +22,49 @@
  * @short_description: Computerized Adaptive Test Administration
  */
 
+#include <string.h>
 #include "test.h"
+#include "algorithm.h"
 #include "marshal.h"
 
 G_DEFINE_TYPE(OscatsTest, oscats_test, G_TYPE_OBJECT);
 
+// Pipeline stages for native handlers, in the order of the signals
+enum
+{
+  STAGE_INITIALIZE,
+  STAGE_FILTER_STATIC,
+  STAGE_FILTER,
+  STAGE_SELECT,
+  STAGE_APPROVE,
+  STAGE_ADMINISTER,
+  STAGE_ADMINISTERED,
+  STAGE_STOPCRIT,
+  STAGE_FINALIZE,
+  NUM_STAGES
+};
+
+static const gchar *stage_names[NUM_STAGES] = {
+  "initialize", "filter-static", "filter", "select", "approve",
+  "administer", "administered", "stopcrit", "finalize"
+};
+
+typedef struct {
+  GCallback handler;
+  gpointer data;
+  GClosureNotify destroy_data;
+} NativeHandler;
+
+// Iterates h over the native handlers connected to stage
+#define foreach_native(test, stage, h) \
+  for (h = (NativeHandler*)(test)->native[stage]->data; \
+       h < (NativeHandler*)(test)->native[stage]->data + \
+           (test)->native[stage]->len; h++)
+
+// Whether anything is connected to signal through the GSignal system
+#define have_signal(test, signal) \
+  g_signal_has_handler_pending(test, signal, 0, FALSE)
+
 enum
 {
   PROP_0,
@@ -35,6 +73,7 @@ enum
   PROP_LENGTH_HINT,
   PROP_ITERMAX_SELECT,
   PROP_ITERMAX_ITEMS,
+  PROP_NATIVE_HANDLERS,
 };
 
 static void oscats_test_dispose (GObject *object);
@@ -133,6 +172,21 @@ static void oscats_test_class_init (OscatsTestClass *klass)
                             G_PARAM_STATIC_BLURB);
   g_object_class_install_property(gobject_class, PROP_ITERMAX_ITEMS, pspec);
 
+/**
+ * OscatsTest:native-handlers:
+ *
+ * Whether oscats_test_connect_native() bypasses the #GSignal system.  If
+ * %FALSE, native handlers are connected to the signals as ordinary
+ * handlers, and every stage with a handler goes through signal emission.
+ */
+  pspec = g_param_spec_boolean("native-handlers", "Native Handlers",
+                               "Call built-in algorithm handlers directly",
+                               TRUE,
+                               G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                               G_PARAM_STATIC_NAME | G_PARAM_STATIC_NICK |
+                               G_PARAM_STATIC_BLURB);
+  g_object_class_install_property(gobject_class, PROP_NATIVE_HANDLERS, pspec);
+
 /**
  * OscatsTest::initialize:
  * @test: an #OscatsTest
@@ -171,6 +225,28 @@ static void oscats_test_class_init (OscatsTestClass *klass)
                                G_TYPE_NONE, 2,
                                OSCATS_TYPE_EXAMINEE, G_TYPE_BIT_ARRAY);
 
+/**
+ * OscatsTest::filter-static:
+ * @test: an #OscatsTest
+ * @e: an #OscatsExaminee
+ * @eligible: a #GBitArray indicating eligible items in the itembank
+ *
+ * Item filtration that depends only on the examinee and the test's
+ * eligibility hint, not on the items already administered.  The signal
+ * is emitted with @eligible set to the hint when examinee @e starts the
+ * test and again whenever the hint changes [see oscats_test_set_hint()].
+ * The result is cached, and on each selection the items @e has already
+ * seen are removed from it before #OscatsTest::filter is emitted.
+ * Algorithms connecting to #OscatsTest::filter-static should only clear
+ * bits in @eligible.
+ */
+  klass->filter_static = g_signal_new("filter-static",
+                               OSCATS_TYPE_TEST, G_SIGNAL_ACTION, 0,
+                               NULL, NULL,
+                               g_cclosure_user_marshal_VOID__OBJECT_OBJECT,
+                               G_TYPE_NONE, 2,
+                               OSCATS_TYPE_EXAMINEE, G_TYPE_BIT_ARRAY);
+
 /**
  * OscatsTest::select:
  * @test: an #OscatsTest
@@ -299,20 +375,44 @@ static void oscats_test_class_init (OscatsTestClass *klass)
 
 static void oscats_test_init (OscatsTest *self)
 {
+  guint i;
+  self->algorithms = g_ptr_array_new_with_free_func(g_object_unref);
+  self->native = g_new(GArray*, NUM_STAGES);
+  for (i=0; i < NUM_STAGES; i++)
+    self->native[i] = g_array_new(FALSE, FALSE, sizeof(NativeHandler));
 }
 
 static void oscats_test_dispose (GObject *object)
 {
   OscatsTest *self = OSCATS_TEST(object);
+  NativeHandler *h;
+  guint i;
   G_OBJECT_CLASS(oscats_test_parent_class)->dispose(object);
+  if (self->native)
+  {
+    for (i=0; i < NUM_STAGES; i++)
+    {
+      foreach_native(self, i, h)
+        if (h->destroy_data) h->destroy_data(h->data, NULL);
+      g_array_free(self->native[i], TRUE);
+    }
+    g_free(self->native);
+    self->native = NULL;
+  }
   if (self->itembank)
   {
     oscats_administrand_unfreeze(OSCATS_ADMINISTRAND(self->itembank));
     g_object_unref(self->itembank);
   }
   if (self->hint) g_object_unref(self->hint);
+  if (self->unseen) g_object_unref(self->unseen);
+  if (self->filtered) g_object_unref(self->filtered);
+  if (self->algorithms) g_ptr_array_free(self->algorithms, TRUE);
   self->itembank = NULL;
   self->hint = NULL;
+  self->unseen = NULL;
+  self->filtered = NULL;
+  self->algorithms = NULL;
 }
 
 static void oscats_test_set_property(GObject *object, guint prop_id,
@@ -350,6 +450,10 @@ static void oscats_test_set_property(GObject *object, guint prop_id,
       self->itermax_items = g_value_get_uint(value);
       break;
     
+    case PROP_NATIVE_HANDLERS:		// construction only
+      self->native_handlers = g_value_get_boolean(value);
+      break;
+    
     default:
       // Unknown property
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -383,6 +487,10 @@ static void oscats_test_get_property(GObject *object, guint prop_id,
       g_value_set_uint(value, self->itermax_items);
       break;
     
+    case PROP_NATIVE_HANDLERS:
+      g_value_set_boolean(value, self->native_handlers);
+      break;
+    
     default:
       // Unknown property
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -404,7 +512,7 @@ static void oscats_test_get_property(GObject *object, guint prop_id,
  * <orderedlist>
  *  <listitem><para>The examinee's item/response vectors are reset.</para></listitem>
  *  <listitem><para>The #OscatsTest::initialize signal is emitted.</para></listitem>
- *  <listitem><para>The item eligibility vector is initialized with the current hinted value (default: all items).</para></listitem>
+ *  <listitem><para>The item eligibility vector is initialized with the current hinted value (default: all items), filtered by #OscatsTest::filter-static if the hint has changed, minus the items already administered.</para></listitem>
  *  <listitem><para>The #OscatsTest::filter, #OscatsTest::select, and #OscatsTest::approve signals are emitted.</para></listitem>
  *  <listitem><para>If the approval handler returns %TRUE, goto 3 (not more than #OscatsTest:itermax_select times).</para></listitem>
  *  <listitem><para>The #OscatsTest::administer signal is emitted (which should add the item/response pair to @e as necessary).</para></listitem>
@@ -421,12 +529,13 @@ void oscats_test_administer(OscatsTest *test, OscatsExaminee *e)
 {
   OscatsTestClass *klass;
   GBitArray *eligible;
-  GArray *seen_items;
   OscatsItem *item;
+  NativeHandler *h;
   gint item_index;
-  guint8 resp;
-  gboolean reselect, stop = TRUE;
-  guint num_items, i, iter_select, iter_items = 0;
+  guint resp = 0;
+  OscatsResponse signal_resp;
+  gboolean reselect, ret, stop = TRUE;
+  guint num_items, iter_select, iter_items = 0;
   
   g_return_if_fail(OSCATS_IS_TEST(test) && OSCATS_IS_EXAMINEE(e));
   num_items = oscats_item_bank_num_items(test->itembank);
@@ -438,11 +547,20 @@ void oscats_test_administer(OscatsTest *test, OscatsExaminee *e)
     test->hint = g_bit_array_new(num_items);
     g_bit_array_reset(test->hint, TRUE);
   }
-  seen_items = g_array_sized_new(FALSE, FALSE, sizeof(guint),
-                                 test->length_hint);
+  if (!test->unseen)
+  {
+    test->unseen = g_bit_array_new(num_items);
+    test->filtered = g_bit_array_new(num_items);
+  } else if (g_bit_array_get_len(test->unseen) != num_items)
+    g_bit_array_resize(test->unseen, num_items);
+  g_bit_array_reset(test->unseen, TRUE);
+  test->hint_changed = TRUE;
   
   oscats_examinee_prep(e, test->length_hint);
-  g_signal_emit(test, klass->initialize, 0, e);
+  foreach_native(test, STAGE_INITIALIZE, h)
+    ((OscatsTestInitializeFunc)h->handler)(test, e, h->data);
+  if (have_signal(test, klass->initialize))
+    g_signal_emit(test, klass->initialize, 0, e);
   do
   {
     iter_select = 0;
@@ -456,17 +574,39 @@ void oscats_test_administer(OscatsTest *test, OscatsExaminee *e)
         goto bail;
       }
       item_index = -1;	// In case nothing is connected to ::select
-      g_bit_array_copy(eligible, test->hint);
-      for (i=0; i < seen_items->len; i++)
-        g_bit_array_clear_bit(eligible, g_array_index(seen_items, guint, i));
-      g_signal_emit(test, klass->filter, 0, e, eligible);
-      g_signal_emit(test, klass->select, 0, e, eligible, &item_index);
+      if (test->hint_changed)
+      {
+        test->hint_changed = FALSE;
+        g_bit_array_copy(test->filtered, test->hint);
+        foreach_native(test, STAGE_FILTER_STATIC, h)
+          ((OscatsTestFilterFunc)h->handler)(test, e, test->filtered, h->data);
+        if (have_signal(test, klass->filter_static))
+          g_signal_emit(test, klass->filter_static, 0, e, test->filtered);
+      }
+      g_bit_array_copy(eligible, test->filtered);
+      g_bit_array_and(eligible, test->unseen);
+      foreach_native(test, STAGE_FILTER, h)
+        ((OscatsTestFilterFunc)h->handler)(test, e, eligible, h->data);
+      if (have_signal(test, klass->filter))
+        g_signal_emit(test, klass->filter, 0, e, eligible);
+      foreach_native(test, STAGE_SELECT, h)
+        item_index = ((OscatsTestSelectFunc)h->handler)(test, e, eligible,
+                                                        h->data);
+      if (have_signal(test, klass->select))
+        g_signal_emit(test, klass->select, 0, e, eligible, &item_index);
       if (item_index < 0 || item_index >= num_items)
         item = NULL;
       else
         item = g_ptr_array_index(test->itembank->items, item_index);
       reselect = FALSE;
-      g_signal_emit(test, klass->approve, 0, e, item, &reselect);
+      foreach_native(test, STAGE_APPROVE, h)
+        reselect |= ((OscatsTestApproveFunc)h->handler)(test, e, item,
+                                                        h->data);
+      if (have_signal(test, klass->approve))
+      {
+        g_signal_emit(test, klass->approve, 0, e, item, &ret);
+        reselect |= ret;
+      }
     } while (reselect);
     if (!item)
     {			// Reached only if nothing connected to ::approve
@@ -474,19 +614,41 @@ void oscats_test_administer(OscatsTest *test, OscatsExaminee *e)
                 test->id, e->id);
       goto bail;
     }
-    g_signal_emit(test, klass->administer, 0, e, item, &resp);
-    g_array_append_val(seen_items, item_index);
-    g_signal_emit(test, klass->administered, 0, e, item, resp);
-    g_signal_emit(test, klass->stopcrit, 0, e, &stop);
+    foreach_native(test, STAGE_ADMINISTER, h)
+      resp = ((OscatsTestAdministerFunc)h->handler)(test, e, item, h->data);
+    if (have_signal(test, klass->administer))
+    {
+      signal_resp = resp;
+      g_signal_emit(test, klass->administer, 0, e, item, &signal_resp);
+      resp = signal_resp;
+    }
+    g_bit_array_clear_bit(test->unseen, item_index);
+    foreach_native(test, STAGE_ADMINISTERED, h)
+      ((OscatsTestAdministeredFunc)h->handler)(test, e, item, resp, h->data);
+    if (have_signal(test, klass->administered))
+      g_signal_emit(test, klass->administered, 0, e, item, resp);
+    if (test->native[STAGE_STOPCRIT]->len > 0)
+    {
+      stop = FALSE;
+      foreach_native(test, STAGE_STOPCRIT, h)
+        stop |= ((OscatsTestStopcritFunc)h->handler)(test, e, h->data);
+    }
+    if (have_signal(test, klass->stopcrit))
+    {
+      g_signal_emit(test, klass->stopcrit, 0, e, &ret);
+      stop = (test->native[STAGE_STOPCRIT]->len > 0 ? stop || ret : ret);
+    }
   } while(!stop && ++iter_items < test->itermax_items);
   if (iter_items == test->itermax_items)
     g_warning("Maximum number (%d) of items reached in test [%s] "
               "for examinee [%s].", iter_items, test->id, e->id);
 
 bail:
-  g_signal_emit(test, klass->finalize, 0, e);
+  foreach_native(test, STAGE_FINALIZE, h)
+    ((OscatsTestFinalizeFunc)h->handler)(test, e, h->data);
+  if (have_signal(test, klass->finalize))
+    g_signal_emit(test, klass->finalize, 0, e);
   g_object_unref(eligible);
-  g_array_free(seen_items, TRUE);
 }
 
 /**
@@ -497,7 +659,8 @@ bail:
  * Sets the item eligibility hint.  The length of @hint must be the same as
  * the number of items in #OscatsTest:itembank.  This is generally called in
  * handlers connected to #OscatsTest::initialize or
- * #OscatsTest::administered.
+ * #OscatsTest::administered.  #OscatsTest::filter-static is emitted again
+ * before the next item is selected.
  */
 void oscats_test_set_hint(OscatsTest *test, GBitArray *hint)
 {
@@ -507,4 +670,160 @@ void oscats_test_set_hint(OscatsTest *test, GBitArray *hint)
   if (!test->hint)
     test->hint = g_bit_array_new(g_bit_array_get_len(hint));
   g_bit_array_copy(test->hint, hint);
+  test->hint_changed = TRUE;
+}
+
+/**
+ * oscats_test_connect_native:
+ * @test: an #OscatsTest
+ * @signal: the name of the #OscatsTest signal, e.g. "select"
+ * @handler: the C handler, with the same signature as a handler for @signal
+ * @data: data to pass to @handler
+ * @destroy_data: (allow-none): called with @data (and a %NULL closure) when
+ * @test is disposed
+ *
+ * Connects @handler to the stage of oscats_test_administer() corresponding
+ * to @signal without going through the #GSignal system, so that no
+ * marshalling takes place when the stage runs.  This is how the built-in
+ * algorithms connect themselves in their registration functions.  The
+ * native handlers for a stage are called in the order in which they were
+ * connected, before any handlers connected to the signal itself; the
+ * signal is only emitted when such handlers exist.  For #OscatsTest::select
+ * and #OscatsTest::administer, the value returned by the last handler run
+ * is used.  Native handlers cannot be disconnected.
+ *
+ * All handlers still run in the order in which they were connected.  If a
+ * handler is already connected to @signal itself (for example, an
+ * #OscatsTest::initialize handler setting the starting ability, connected
+ * before the algorithms were registered), @handler is connected to
+ * @signal with g_signal_connect_data(), so that it runs after that
+ * handler.  The same is done for every handler if #OscatsTest:native-handlers
+ * is %FALSE.
+ */
+void oscats_test_connect_native(OscatsTest *test, const gchar *signal,
+                                GCallback handler, gpointer data,
+                                GClosureNotify destroy_data)
+{
+  NativeHandler h = { handler, data, destroy_data };
+  guint i;
+  g_return_if_fail(OSCATS_IS_TEST(test) && signal != NULL && handler != NULL);
+  for (i=0; i < NUM_STAGES; i++)
+    if (strcmp(signal, stage_names[i]) == 0) break;
+  if (i == NUM_STAGES)
+  {
+    g_critical("OscatsTest has no signal \"%s\".", signal);
+    return;
+  }
+  // Native handlers run first, so they must not overtake earlier handlers
+  if (!test->native_handlers ||
+      have_signal(test, g_signal_lookup(signal, OSCATS_TYPE_TEST)))
+    g_signal_connect_data(test, signal, handler, data, destroy_data, 0);
+  else
+    g_array_append_val(test->native[i], h);
+}
+
+typedef struct {
+  OscatsTest *test;
+  OscatsExaminee **e;
+  guint num;
+} BatchJob;
+
+static void batch_worker(gpointer data, gpointer user_data)
+{
+  BatchJob *job = data;
+  guint i;
+  for (i=0; i < job->num; i++)
+    oscats_test_administer(job->test, job->e[i]);
+}
+
+/**
+ * oscats_test_administer_batch:
+ * @test: the #OscatsTest to administer
+ * @e: (array length=num): the #OscatsExaminee objects taking the test
+ * @num: the number of examinees in @e
+ * @num_threads: the number of worker threads to use
+ *
+ * Administers @test to each of the @num examinees in @e, as by
+ * oscats_test_administer(), dividing the examinees among @num_threads
+ * worker threads.  Each worker runs its own copy of @test with a clone of
+ * every algorithm registered on @test [see oscats_algorithm_clone()], so
+ * the algorithms' working space is never shared between threads.  When all
+ * examinees have been tested, the statistics tabulated by each worker's
+ * algorithms (e.g. #OscatsAlgExposureCounter, #OscatsAlgClassRates) are
+ * merged into the algorithms registered on @test.
+ *
+ * Only algorithms registered with oscats_algorithm_register() are copied
+ * to the workers; handlers connected directly to the signals of @test are
+ * not invoked.  The examinees must be distinct objects and must not share
+ * latent points.  If @num_threads is 1, the examinees are tested in order
+ * in the calling thread using @test itself.
+ */
+void oscats_test_administer_batch(OscatsTest *test, OscatsExaminee **e,
+                                  guint num, guint num_threads)
+{
+  OscatsTest **workers;
+  BatchJob *jobs;
+  GThreadPool *pool;
+  GError *error = NULL;
+  guint i, j, start;
+
+  g_return_if_fail(OSCATS_IS_TEST(test) && num_threads > 0);
+  g_return_if_fail(num == 0 || e != NULL);
+  if (num_threads > num) num_threads = num;
+  if (num_threads <= 1)
+  {
+    for (i=0; i < num; i++)
+      oscats_test_administer(test, e[i]);
+    return;
+  }
+
+#if !GLIB_CHECK_VERSION(2,32,0)
+  if (!g_thread_supported()) g_thread_init(NULL);
+#endif
+
+  workers = g_new(OscatsTest*, num_threads);
+  jobs = g_new(BatchJob, num_threads);
+  for (i=0, start=0; i < num_threads; i++)
+  {
+    workers[i] = g_object_new(OSCATS_TYPE_TEST, "id", test->id,
+                              "itembank", test->itembank,
+                              "length-hint", test->length_hint,
+                              "itermax-select", test->itermax_select,
+                              "itermax-items", test->itermax_items,
+                              "native-handlers", test->native_handlers,
+                              NULL);
+    if (test->hint) oscats_test_set_hint(workers[i], test->hint);
+    for (j=0; j < test->algorithms->len; j++)
+      oscats_algorithm_register(
+        oscats_algorithm_clone(g_ptr_array_index(test->algorithms, j)),
+        workers[i]);
+    jobs[i].test = workers[i];
+    jobs[i].e = e + start;
+    jobs[i].num = (num - start) / (num_threads - i);
+    start += jobs[i].num;
+  }
+
+  pool = g_thread_pool_new(batch_worker, NULL, num_threads, TRUE, &error);
+  if (error)
+  {
+    g_warning("Unable to start worker threads for test [%s]: %s",
+              test->id, error->message);
+    g_error_free(error);
+    for (i=0; i < num_threads; i++)
+      batch_worker(jobs+i, NULL);
+  } else {
+    for (i=0; i < num_threads; i++)
+      g_thread_pool_push(pool, jobs+i, NULL);
+    g_thread_pool_free(pool, FALSE, TRUE);
+  }
+
+  for (i=0; i < num_threads; i++)
+  {
+    for (j=0; j < test->algorithms->len; j++)
+      oscats_algorithm_merge(g_ptr_array_index(test->algorithms, j),
+                             g_ptr_array_index(workers[i]->algorithms, j));
+    g_object_unref(workers[i]);
+  }
+  g_free(workers);
+  g_free(jobs);
 }
@@ -41,6 +41,12 @@ struct _OscatsTest {
   GBitArray *hint;
   guint length_hint;
   guint itermax_select, itermax_items;
+  gboolean native_handlers;
+  /*< private >*/
+  GPtrArray *algorithms;
+  GBitArray *unseen, *filtered;
+  gboolean hint_changed;
+  GArray **native;
 };
 
 struct _OscatsTestClass {
@@ -48,6 +54,7 @@ struct _OscatsTestClass {
   // Signals
   guint initialize;
   guint filter;
+  guint filter_static;
   guint select;
   guint approve;
   guint administer;
@@ -56,7 +63,6 @@ struct _OscatsTestClass {
   guint finalize;
 };
 
-/*
 typedef void (*OscatsTestInitializeFunc) (OscatsTest*, OscatsExaminee*, gpointer);
 typedef void (*OscatsTestFilterFunc) (OscatsTest*, OscatsExaminee*, GBitArray*, gpointer);
 typedef gint (*OscatsTestSelectFunc) (OscatsTest*, OscatsExaminee*, GBitArray*, gpointer);
@@ -64,13 +70,17 @@ typedef gboolean (*OscatsTestApproveFunc) (OscatsTest*, OscatsExaminee*, OscatsI
 typedef guint (*OscatsTestAdministerFunc) (OscatsTest*, OscatsExaminee*, OscatsItem*, gpointer);
 typedef void (*OscatsTestAdministeredFunc) (OscatsTest*, OscatsExaminee*, OscatsItem*, guint, gpointer);
 typedef gboolean (*OscatsTestStopcritFunc) (OscatsTest*, OscatsExaminee*, gpointer);
-typedef void (*OscatsTestFinalizeFunc) (OscatsTest*, OscatsExamine*, gpointer);
-*/
+typedef void (*OscatsTestFinalizeFunc) (OscatsTest*, OscatsExaminee*, gpointer);
 
 GType oscats_test_get_type();
 
 void oscats_test_administer(OscatsTest *test, OscatsExaminee *e);
+void oscats_test_administer_batch(OscatsTest *test, OscatsExaminee **e,
+                                  guint num, guint num_threads);
 void oscats_test_set_hint(OscatsTest *test, GBitArray *hint);
+void oscats_test_connect_native(OscatsTest *test, const gchar *signal,
+                                GCallback handler, gpointer data,
+                                GClosureNotify destroy_data);
 
 G_END_DECLS
 #endif